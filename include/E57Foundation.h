@@ -97,6 +97,28 @@ const ReadChecksumPolicy CHECKSUM_POLICY_SPARSE = 25; //! Only verify 25% of the
 const ReadChecksumPolicy CHECKSUM_POLICY_HALF = 50;   //! Only verify 50% of the checksums. The last block is always verified.
 const ReadChecksumPolicy CHECKSUM_POLICY_ALL = 100;   //! Verify all checksums. This is the default. (slow)
 
+//! @brief Options for opening an ImageFile, see ImageFile::ImageFile(const ustring&, const ustring&, const ImageFileOptions&).
+struct ImageFileOptions {
+    ReadChecksumPolicy  checksumPolicy = CHECKSUM_POLICY_ALL;  //!< The percentage of checksums verified when reading.
+    bool                memoryMapped = false;   //!< Read mode only: map the file into memory instead of reading it with system calls. Falls back to system calls if the file can't be mapped.
+    bool                validateXml = true;     //!< Read mode only: let Xerces validate the XML section against a schema it names. Files written by this library don't name one, so aren't validated either way.
+    bool                nodeArena = false;      //!< Read mode only: allocate the nodes read from the XML section from large blocks instead of one at a time. Opening files with many nodes is faster and takes less memory, but the blocks are only freed once every node read from the file is destroyed.
+};
+
+//! @brief Options for reading a CompressedVectorNode, see CompressedVectorNode::reader(const std::vector<SourceDestBuffer>&, const CompressedVectorReaderOptions&).
+struct CompressedVectorReaderOptions {
+    unsigned            cachePacketCount = 32;  //!< Number of data packets the reader keeps in memory, at least 1. Each packet takes up to 64 KiB.
+    size_t              cacheByteSize = 0;      //!< If non-zero, overrides cachePacketCount with the number of whole 64 KiB packets that fit in this many bytes (at least 1).
+    unsigned            readAheadPacketCount = 0;   //!< If non-zero, a background thread reads and checks this many packets ahead of the decoders. Ignored for files opened for writing.
+};
+
+//! @brief Options for writing a CompressedVectorNode, see CompressedVectorNode::writer(std::vector<SourceDestBuffer>&, const CompressedVectorWriterOptions&).
+struct CompressedVectorWriterOptions {
+    unsigned            encoderThreadCount = 1; //!< Number of threads encoding the bytestreams of each data packet, including the calling thread. 1 encodes on the calling thread only, 0 uses one thread per core.
+    bool                backgroundWrite = false;    //!< Checksum and write each finished data packet on a background thread, while the next one is encoded. Nothing else may write to the ImageFile (e.g. BlobNode::write) until the writer is closed.
+    bool                writeIndex = false;         //!< Write index packets, so CompressedVectorReader::seek decodes at most a few packets. Makes the file slightly bigger.
+};
+
 
 //! @brief The major version number of the Foundation API
 const int E57_FOUNDATION_API_MAJOR = 0;
@@ -168,6 +190,8 @@ class IntegerNode;
 class IntegerNodeImpl;
 class Node;
 class NodeImpl;
+class NodePath;
+class NodePathImpl;
 class ScaledIntegerNode;
 class ScaledIntegerNodeImpl;
 class SourceDestBuffer;
@@ -211,8 +235,10 @@ public:
 
     int64_t     childCount() const;
     bool        isDefined(const ustring& pathName) const;
+    bool        isDefined(const NodePath& path) const;
     Node        get(int64_t index) const;
     Node        get(const ustring& pathName) const;
+    Node        get(const NodePath& path) const;
     void        set(const ustring& pathName, Node n);
 
     // Up/Down cast conversion
@@ -253,8 +279,10 @@ public:
 
     int64_t     childCount() const;
     bool        isDefined(const ustring& pathName) const;
+    bool        isDefined(const NodePath& path) const;
     Node        get(int64_t index) const;
     Node        get(const ustring& pathName) const;
+    Node        get(const NodePath& path) const;
     void        append(Node n);
 
     // Up/Down cast conversion
@@ -285,6 +313,25 @@ protected:
 //! \endcond
 };
 
+class NodePath {
+public:
+                NodePath(ImageFile destImageFile, const ustring& pathName);
+
+    ustring     pathName() const;
+    bool        isRelative() const;
+
+    // Diagnostic functions:
+    void        dump(int indent = 0, std::ostream& os = std::cout) const;
+
+//! \cond documentNonPublic   The following isn't part of the API, and isn't documented.
+private:
+                NodePath() = delete;
+protected:
+
+    E57_OBJECT_IMPLEMENTATION(NodePath)  // Internal implementation details, not part of API, must be last in object
+//! \endcond
+};
+
 class SourceDestBuffer {
 public:
     SourceDestBuffer(ImageFile destImageFile, const ustring pathName, int8_t* b,   const size_t capacity,
@@ -321,6 +368,9 @@ public:
     void            checkInvariant(bool doRecurse = true);
 
 //! \cond documentNonPublic   The following isn't part of the API, and isn't documented.
+#ifdef E57_INTERNAL_IMPLEMENTATION_ENABLE
+    explicit        SourceDestBuffer(std::shared_ptr<SourceDestBufferImpl> ni);  // internal use only
+#endif
 private:
                     SourceDestBuffer() = delete;
 
@@ -334,7 +384,8 @@ class CompressedVectorReader {
 public:
     unsigned    read();
     unsigned    read(std::vector<SourceDestBuffer>& dbufs);
-    void        seek(int64_t recordNumber); // !!! not implemented yet
+    uint64_t    readAll(std::vector<SourceDestBuffer>& dbufs, unsigned threadCount = 0);
+    void        seek(int64_t recordNumber);
     void        close();
     bool        isOpen();
     CompressedVectorNode compressedVectorNode() const;
@@ -387,7 +438,9 @@ public:
 
     // Iterators
     CompressedVectorWriter writer(std::vector<SourceDestBuffer>& sbufs);
+    CompressedVectorWriter writer(std::vector<SourceDestBuffer>& sbufs, const CompressedVectorWriterOptions& options);
     CompressedVectorReader reader(const std::vector<SourceDestBuffer>& dbufs);
+    CompressedVectorReader reader(const std::vector<SourceDestBuffer>& dbufs, const CompressedVectorReaderOptions& options);
 
     // Up/Down cast conversion
                 operator Node() const;
@@ -614,6 +667,7 @@ protected:
 class ImageFile {
 public:
                     ImageFile(const ustring& fname, const ustring& mode, ReadChecksumPolicy checksumPolicy = CHECKSUM_POLICY_ALL );
+                    ImageFile(const ustring& fname, const ustring& mode, const ImageFileOptions& options);
     StructureNode   root() const;
     void            close();
     void            cancel();
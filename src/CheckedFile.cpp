@@ -39,10 +39,12 @@
 #elif defined(LINUX)
 #define _LARGEFILE64_SOURCE
 #define __LARGE64_FILES
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #elif defined(MACOS)
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
 #else
@@ -56,6 +58,19 @@
 #include "CRC.h"
 
 #include "CheckedFile.h"
+#include "FloatFormat.h"
+
+/// On x86-64 the CRC32C of pages can use the SSE4.2 crc32 instruction, chosen at run time if the CPU has it.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define E57_CRC32C_SSE42
+#define E57_TARGET_SSE42 __attribute__((target("sse4.2,pclmul")))
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#elif defined(_M_X64) && defined(_MSC_VER)
+#define E57_CRC32C_SSE42
+#define E57_TARGET_SSE42
+#include <intrin.h>
+#endif
 
 //#define E57_CHECK_FILE_DEBUG
 #ifdef E57_CHECK_FILE_DEBUG
@@ -79,23 +94,35 @@ const size_t   CheckedFile::physicalPageSize = 1 << physicalPageSizeLog2;
 const uint64_t CheckedFile::physicalPageSizeMask = physicalPageSize-1;
 const size_t   CheckedFile::logicalPageSize = physicalPageSize - 4;
 
+/// Most physical pages fetched by one system call in readLogical(), bounds the size of its temp buffer
+#define E57_MAX_PAGES_PER_READ  256
+
 CheckedFile::CheckedFile( ustring fileName, Mode mode, ReadChecksumPolicy policy ) :
    fileName_(fileName),
    physicalLength_( 0 ),
    checkSumPolicy_( policy ),
-   fd_(-1)
+   fd_(-1),
+   map_( nullptr ),
+   cursor_( 0 ),
+   writePageNumber_( UINT64_MAX ),
+   writePageDirty_( false )
 {
    switch (mode)
    {
       case ReadOnly:
+      case ReadOnlyMapped:
          fd_ = open64(fileName_, O_RDONLY|O_BINARY, 0);
 
          readOnly_ = true;
 
          physicalLength_ = lseek64(0LL, SEEK_END);
-         lseek64( 0, SEEK_SET );
 
          logicalLength_ = physicalToLogical( physicalLength_ );
+
+         if ( mode == ReadOnlyMapped )
+         {
+            mapFile();
+         }
          break;
 
       case WriteCreate:
@@ -103,12 +130,15 @@ CheckedFile::CheckedFile( ustring fileName, Mode mode, ReadChecksumPolicy policy
          fd_ = open64(fileName_, O_RDWR|O_CREAT|O_TRUNC|O_BINARY, S_IWRITE|S_IREAD);
          readOnly_ = false;
          logicalLength_ = 0;
+         writePage_.resize( physicalPageSize );
          break;
 
       case WriteExisting:
          fd_ = open64(fileName_, O_RDWR|O_BINARY, 0);
          readOnly_ = false;
-         logicalLength_ = physicalToLogical(length(Physical)); //???
+         physicalLength_ = lseek64(0LL, SEEK_END);
+         logicalLength_ = physicalToLogical(physicalLength_); //???
+         writePage_.resize( physicalPageSize );
          break;
    }
 }
@@ -153,65 +183,114 @@ CheckedFile::~CheckedFile()
 }
 
 void CheckedFile::read(char* buf, size_t nRead, size_t /*bufSize*/)
+{
+   //??? check bufSize OK
+
+   const uint64_t start = position( Logical );
+
+   readLogical( start, buf, nRead );
+
+   /// When done, leave cursor just past end of last byte read
+   seek(start + nRead, Logical);
+}
+
+/// Read from a given logical offset without using or moving the file cursor.
+/// Safe to call from several threads at once (e.g. multiple CompressedVectorReaders on one file), if the file is open for reading.
+/// A file open for writing may flush its write page here, which isn't thread safe.
+void CheckedFile::readAt(uint64_t logicalOffset, char* buf, size_t nRead)
+{
+   readLogical( logicalOffset, buf, nRead );
+}
+
+void CheckedFile::readLogical(uint64_t logicalOffset, char* buf, size_t nRead)
 {
    //??? what if read past logical end?, or physical end?
    //??? need to keep track of logical length?
-   //??? check bufSize OK
 
-   const uint64_t end = position( Logical ) + nRead;
+   const uint64_t end = logicalOffset + nRead;
    const uint64_t logicalLength = length( Logical );
 
+   /// Make sure file has latest contents of page in write buffer
+   if ( writePageDirty_ )
+   {
+      writePageFlush();
+   }
+
    if (end > logicalLength)
    {
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "fileName=" + fileName_ + " end=" + toString(end) + " length=" + toString(logicalLength));
    }
 
-   uint64_t page = 0;
-   size_t   pageOffset = 0;
-
-   getCurrentPageAndOffset(page, pageOffset);
+   uint64_t page = logicalOffset / logicalPageSize;
+   size_t   pageOffset = static_cast<size_t>(logicalOffset - page * logicalPageSize);
 
-   size_t n = min( nRead, logicalPageSize - pageOffset );
+   /// One past last physical page holding requested bytes
+   const uint64_t endPage = (end + logicalPageSize - 1) / logicalPageSize;
 
-   /// Allocate temp page buffer
-   vector<char> page_buffer_v( physicalPageSize );
-   char* page_buffer = &page_buffer_v[0];
+   /// Allocate temp buffer for a run of physical pages, each run is fetched with one system call.
+   /// Not needed if file is mapped, pages are used where they are.
+   vector<char> page_buffer_v;
+   if ( map_ == nullptr )
+   {
+      page_buffer_v.resize( static_cast<size_t>(min(endPage - page, static_cast<uint64_t>(E57_MAX_PAGES_PER_READ))) * physicalPageSize );
+   }
+   else if ( endPage*physicalPageSize > physicalLength_ )
+   {
+      /// Mapping ends part way through a page, a read would fail the same way
+      throw E57_EXCEPTION2(E57_ERROR_READ_FAILED, "fileName=" + fileName_
+                           + " endPage=" + toString(endPage)
+                           + " length=" + toString(physicalLength_));
+   }
 
    const unsigned int   checksumMod = static_cast<unsigned int>( std::nearbyint( 100.0 / checkSumPolicy_ ) );
 
    while ( nRead > 0 )
    {
-      readPhysicalPage( page_buffer, page );
+      const size_t pageCount = static_cast<size_t>( min(endPage - page, static_cast<uint64_t>(E57_MAX_PAGES_PER_READ)) );
+
+      const char* pages;
+      if ( map_ == nullptr )
+      {
+         readPhysicalPages( &page_buffer_v[0], page, pageCount );
+         pages = &page_buffer_v[0];
+      }
+      else
+      {
+         pages = &map_[page * physicalPageSize];
+      }
 
-      switch ( checkSumPolicy_ )
+      /// Check and strip checksum of each page in run
+      for ( size_t i = 0; i < pageCount; i++ )
       {
-         case CHECKSUM_POLICY_NONE:
-            break;
+         const char* page_buffer = &pages[i * physicalPageSize];
 
-         case CHECKSUM_POLICY_ALL:
-            verifyChecksum( page_buffer, page );
-            break;
+         switch ( checkSumPolicy_ )
+         {
+            case CHECKSUM_POLICY_NONE:
+               break;
 
-         default:
-            if ( !(page % checksumMod) || (nRead < physicalPageSize) )
-            {
+            case CHECKSUM_POLICY_ALL:
                verifyChecksum( page_buffer, page );
-            }
-            break;
-      }
+               break;
 
-      memcpy( buf, page_buffer+pageOffset, n );
+            default:
+               if ( !(page % checksumMod) || (nRead < physicalPageSize) )
+               {
+                  verifyChecksum( page_buffer, page );
+               }
+               break;
+         }
 
-      buf += n;
-      nRead -= n;
-      pageOffset = 0;
-      page++;
+         const size_t n = min( nRead, logicalPageSize - pageOffset );
 
-      n = min( nRead, logicalPageSize );
-   }
+         memcpy( buf, page_buffer+pageOffset, n );
 
-   /// When done, leave cursor just past end of last byte read
-   seek(end, Logical);
+         buf += n;
+         nRead -= n;
+         pageOffset = 0;
+         page++;
+      }
+   }
 }
 
 void CheckedFile::write(const char* buf, size_t nWrite)
@@ -224,149 +303,98 @@ void CheckedFile::write(const char* buf, size_t nWrite)
 
    uint64_t end = position(Logical) + nWrite;
 
+   writeBuffered(buf, nWrite);
+
+   if (end > logicalLength_)
+      logicalLength_ = end;
+
+   /// When done, leave cursor just past end of buf
+   seek(end, Logical);
+}
+
+/// Copy nWrite bytes from buf (or zeros if buf is NULL) to file at cursor, through the write-back page buffer.
+/// Doesn't move cursor or update logicalLength_.
+void CheckedFile::writeBuffered(const char* buf, size_t nWrite)
+{
    uint64_t page;
    size_t   pageOffset;
    getCurrentPageAndOffset(page, pageOffset);
 
    size_t n = min(nWrite, logicalPageSize - pageOffset);
 
-   /// Allocate temp page buffer
-   vector<char> page_buffer_v(physicalPageSize);
-   char* page_buffer = &page_buffer_v[0];
+   bool firstPageOfWrite = true;
 
    while (nWrite > 0)
    {
-      const uint64_t physicalLength = length( Physical );
+      writePageLoad(page, firstPageOfWrite);
 
-      if ( page*physicalPageSize < physicalLength )
+#ifdef E57_MAX_VERBOSE
+      // cout << "copy " << n << "bytes to page=" << page << " pageOffset=" << pageOffset << endl; //???
+#endif
+      if (buf != NULL)
       {
-         readPhysicalPage( page_buffer, page );
+         memcpy(&writePage_[pageOffset], buf, n);
+         buf += n;
       }
+      else
+      {
+         memset(&writePage_[pageOffset], 0, n);
+      }
+      writePageDirty_ = true;
 
-#ifdef E57_MAX_VERBOSE
-      // cout << "  page_buffer[0] read: '" << page_buffer[0] << "'" << endl;
-      // cout << "copy " << n << "bytes to page=" << page << " pageOffset=" << pageOffset << " buf='"; //???
-      for (size_t i=0; i < n; i++)
-         // cout << buf[i];
-         // cout << "'" << endl;
-#endif
-         memcpy(page_buffer+pageOffset, buf, n);
-      writePhysicalPage(page_buffer, page);
-#ifdef E57_MAX_VERBOSE
-      // cout << "  page_buffer[0] after write: '" << page_buffer[0] << "'" << endl; //???
-#endif
-      buf += n;
       nWrite -= n;
       pageOffset = 0;
       page++;
       n = min(nWrite, logicalPageSize);
+      firstPageOfWrite = false;
    }
-
-   if (end > logicalLength_)
-      logicalLength_ = end;
-
-   /// When done, leave cursor just past end of buf
-   seek(end, Logical);
 }
 
-CheckedFile& CheckedFile::operator<<(const ustring& s)
+/// Make writePage_ hold given page, writing out the page it held before if that was changed.
+void CheckedFile::writePageLoad(uint64_t page, bool firstPageOfWrite)
 {
-   write(s.c_str(), s.length()); //??? should be times size of uchar?
-   return(*this);
-}
+   if (page == writePageNumber_)
+      return;
 
-CheckedFile& CheckedFile::operator<<(int64_t i)
-{
-   stringstream ss;
-   ss << i;
-   return(*this << ss.str());
-}
+   writePageFlush();
 
-CheckedFile& CheckedFile::operator<<(uint64_t i)
-{
-   stringstream ss;
-   ss << i;
-   return(*this << ss.str());
-}
+   if ( page*physicalPageSize < physicalLength_ )
+   {
+      readPhysicalPage( &writePage_[0], page );
+   }
+   else if ( firstPageOfWrite )
+   {
+      memset( &writePage_[0], 0, physicalPageSize );
+   }
+   /// else a new page continuing a write starts with a copy of the page before, as it always has.
+   /// The unused tail of the last page of file is not zeroed, and is kept the same so files are byte-identical to earlier versions.
 
-CheckedFile& CheckedFile::operator<<(float f)
-{
-   //??? is 7 digits right number?
-   return(writeFloatingPoint(f, 7));
-}
+   writePageNumber_ = page;
 
-CheckedFile& CheckedFile::operator<<(double d)
-{
-   //??? is 17 digits right number?
-   return(writeFloatingPoint(d, 17));
+   /// Page is part of file from now on, even before it is written
+   physicalLength_ = max( physicalLength_, (page+1)*physicalPageSize );
 }
 
-template<class FTYPE> CheckedFile& CheckedFile::writeFloatingPoint(FTYPE value, int precision)
+/// Write page in write-back buffer to file, if it has changed.  It stays in buffer.
+void CheckedFile::writePageFlush()
 {
-#ifdef E57_MAX_VERBOSE
-   cout << "CheckedFile::writeFloatingPoint, value=" << value << " precision=" << precision << endl;
-#endif
-
-   stringstream ss;
-   ss << scientific << setprecision(precision) << value;
-
-   /// Try to remove trailing zeroes and decimal point
-   /// E.g. 1.23456000000000000e+005  ==> 1.23456e+005
-   /// E.g. 2.00000000000000000e+005  ==> 2e+005
-
-   ustring s = ss.str();
-   size_t len = s.length();
-
-#ifdef E57_MAX_DEBUG
-   ustring old_s = s;
-#endif
-
-   /// Split into mantissa and exponent
-   /// E.g. 1.23456000000000000e+005  ==> "1.23456000000000000" + "e+005"
-   ustring mantissa = s.substr(0, len-5);
-   ustring exponent = s.substr(len-5, 5);
-
-   /// Double check that we understand the formatting
-   if (exponent[0] == 'e') {
-      /// Trim of any trailing zeros in mantissa
-      while (mantissa[mantissa.length()-1] == '0')
-         mantissa = mantissa.substr(0, mantissa.length()-1);
-
-      /// Make one attempt to trim off trailing decimal point
-      if (mantissa[mantissa.length()-1] == '.')
-         mantissa = mantissa.substr(0, mantissa.length()-1);
-
-      /// Reassemble whole floating point number
-      /// Check if can drop exponent.
-      if (exponent.compare("e+000") == 0)
-         s = mantissa;
-      else
-         s = mantissa + exponent;
-   }
-
-   // Disable these checks because they compare floats using "!=" which is invalid
-#if 0 //E57_MAX_DEBUG
-   /// Double check same value
-   FTYPE old_value = static_cast<FTYPE>(atof(old_s.c_str()));
-   FTYPE new_value = static_cast<FTYPE>(atof(s.c_str()));
-   if (old_value != new_value)
-      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "fileName=" + fileName_ + " oldValue=" + toString(old_value) + " newValue=" + toString(new_value));
-   if (new_value != value)
-      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "fileName=" + fileName_ + " newValue=" + toString(new_value) + " value=" + toString(value));
-#endif
-
-   return(*this << s);
+   if ( writePageDirty_ )
+   {
+      writePhysicalPage( &writePage_[0], writePageNumber_ );
+      writePageDirty_ = false;
+   }
 }
 
 void CheckedFile::seek(uint64_t offset, OffsetMode omode)
 {
    //??? check for seek beyond logicalLength_
-   int64_t pos = static_cast<int64_t>(omode==Physical ? offset : logicalToPhysical(offset));
+   uint64_t pos = omode==Physical ? offset : logicalToPhysical(offset);
 
 #ifdef E57_MAX_VERBOSE
    // cout << "seek offset=" << offset << " omode=" << omode << " pos=" << pos << endl; //???
 #endif
-   lseek64(pos, SEEK_SET);
+   /// OS cursor is only moved just before a read or write that uses it
+   cursor_ = pos;
 }
 
 uint64_t CheckedFile::lseek64(int64_t offset, int whence)
@@ -403,7 +431,7 @@ uint64_t CheckedFile::lseek64(int64_t offset, int whence)
 uint64_t CheckedFile::position(OffsetMode omode)
 {
    /// Get current file cursor position
-   uint64_t pos = lseek64(0LL, SEEK_CUR);
+   uint64_t pos = cursor_;
 
    if (omode==Physical)
       return(pos);
@@ -415,21 +443,8 @@ uint64_t CheckedFile::length( OffsetMode omode )
 {
    if ( omode == Physical )
    {
-      if ( readOnly_ )
-      {
-         return physicalLength_;
-      }
-
-      // Current file position
-      uint64_t original_pos = lseek64( 0LL, SEEK_CUR );
-
-      // End file position
-      uint64_t end_pos = lseek64( 0LL, SEEK_END );
-
-      // Restore original position
-      lseek64( original_pos, SEEK_SET );
-
-      return end_pos;
+      /// Includes page in write-back buffer, even if not written to file yet
+      return physicalLength_;
    }
    else
    {
@@ -467,46 +482,10 @@ void CheckedFile::extend(uint64_t newLength, OffsetMode omode)
    /// Seek to current end of file
    seek(currentLogicalLength, Logical);
 
-   uint64_t page;
-   size_t   pageOffset;
-   getCurrentPageAndOffset(page, pageOffset);
-
-   /// Calc first write size (may be partial page)
-   /// Watch out for different int sizes here.
-   size_t n;
-   if (nWrite < logicalPageSize - pageOffset)
-      n = static_cast<size_t>(nWrite);
-   else
-      n = logicalPageSize - pageOffset;
-
-   /// Allocate temp page buffer
-   vector<char> page_buffer_v(physicalPageSize);
-   char* page_buffer = &page_buffer_v[0];
-
-   while (nWrite > 0)
-   {
-      const uint64_t physicalLength = length( Physical );
-
-      if ( page*physicalPageSize < physicalLength )
-      {
-         readPhysicalPage( page_buffer, page );
-      }
-
 #ifdef E57_MAX_VERBOSE
-      // cout << "extend " << n << "bytes on page=" << page << " pageOffset=" << pageOffset << endl; //???
+   // cout << "extend " << nWrite << "bytes" << endl; //???
 #endif
-      memset(page_buffer+pageOffset, 0, n);
-      writePhysicalPage(page_buffer, page);
-
-      nWrite -= n;
-      pageOffset = 0;
-      page++;
-
-      if (nWrite < logicalPageSize)
-         n = static_cast<size_t>(nWrite);
-      else
-         n = logicalPageSize;
-   }
+   writeBuffered(NULL, static_cast<size_t>(nWrite));
 
    //??? what if loop above throws, logicalLength_ may be wrong
    logicalLength_ = newLogicalLength;
@@ -517,12 +496,17 @@ void CheckedFile::extend(uint64_t newLength, OffsetMode omode)
 
 void CheckedFile::flush()
 {
-   /// Nothing to do
+   writePageFlush();
 }
 
 void CheckedFile::close()
 {
+   unmapFile();
+
    if (fd_ >= 0) {
+      /// Write out last changed page
+      writePageFlush();
+
 #if defined(_MSC_VER)
       int result = ::_close(fd_);
 #elif defined(__GNUC__)
@@ -538,6 +522,9 @@ void CheckedFile::close()
 
 void CheckedFile::unlink()
 {
+   /// File is going away, don't bother writing buffered page
+   writePageDirty_ = false;
+
    if (fd_ >= 0) {
 #if defined(_MSC_VER)
       int result = ::_close(fd_);
@@ -559,29 +546,131 @@ void CheckedFile::unlink()
 #endif
 }
 
+namespace {
+   /// Portable CRC32C, one table lookup per byte
+   uint32_t crc32cTable(const char* buf, size_t size)
+   {
+      static const CRC::Parameters<crcpp_uint32, 32> sCRCParams{
+         0x1EDC6F41,
+         0xFFFFFFFF,
+         0xFFFFFFFF,
+         true,
+         true
+      };
+
+      static const CRC::Table<crcpp_uint32, 32>   sCRCTable = sCRCParams.MakeTable();
+
+      return CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+   }
+
+#ifdef E57_CRC32C_SSE42
+   /// Bytes in each of the three streams that are run through the crc32 instruction side by side.
+   /// Three streams cover the latency of the instruction, 3*336 bytes fit in one logical page.
+   const size_t crc32cStripeSize = 336;
+
+   /// CRC32C polynomial, bit reflected
+   const uint32_t crc32cPolynomial = 0x82F63B78;
+
+   /// Bit reflected x^n mod P
+   uint32_t crc32cPowerOfX(size_t n)
+   {
+      uint32_t value = 0x80000000;  /// x^0
+      for (size_t i = 0; i < n; i++)
+         value = (value >> 1) ^ ((value & 1) ? crc32cPolynomial : 0);
+      return value;
+   }
+
+   /// Multiply crc by x^(8*crc32cStripeSize) mod P, which is what running crc32cStripeSize zero bytes through the CRC would do.
+   /// A carry-less multiply by x^(8*crc32cStripeSize-33), followed by a crc32 of the 64 bit product, which adds back x^33 and reduces.
+   E57_TARGET_SSE42 uint32_t crc32cShiftStripeClmul(uint32_t crc)
+   {
+      static const uint32_t sK = crc32cPowerOfX(8*crc32cStripeSize - 33);
+
+      __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)), _mm_cvtsi32_si128(static_cast<int>(sK)), 0x00);
+      return static_cast<uint32_t>(_mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(product))));
+   }
+
+   /// CRC32C using the crc32 instruction, before the final inversion
+   E57_TARGET_SSE42 uint32_t crc32cUpdateSse42(uint32_t crc, const char* buf, size_t size, bool haveClmul)
+   {
+      uint64_t crc0 = crc;
+
+      /// Interleave three independent streams, then join them as if they had been one
+      if (haveClmul) {
+         while (size >= 3*crc32cStripeSize) {
+            uint64_t crc1 = 0;
+            uint64_t crc2 = 0;
+            for (size_t i = 0; i < crc32cStripeSize; i += sizeof(uint64_t)) {
+               uint64_t w0, w1, w2;
+               memcpy(&w0, &buf[i], sizeof(w0));
+               memcpy(&w1, &buf[i + crc32cStripeSize], sizeof(w1));
+               memcpy(&w2, &buf[i + 2*crc32cStripeSize], sizeof(w2));
+               crc0 = _mm_crc32_u64(crc0, w0);
+               crc1 = _mm_crc32_u64(crc1, w1);
+               crc2 = _mm_crc32_u64(crc2, w2);
+            }
+            crc0 = crc32cShiftStripeClmul(static_cast<uint32_t>(crc0)) ^ crc1;
+            crc0 = crc32cShiftStripeClmul(static_cast<uint32_t>(crc0)) ^ crc2;
+
+            buf  += 3*crc32cStripeSize;
+            size -= 3*crc32cStripeSize;
+         }
+      }
+
+      /// Rest of buffer one stream, a word at a time, then a byte at a time
+      for (; size >= sizeof(uint64_t); buf += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+         uint64_t w;
+         memcpy(&w, buf, sizeof(w));
+         crc0 = _mm_crc32_u64(crc0, w);
+      }
+      uint32_t crc32 = static_cast<uint32_t>(crc0);
+      for (; size > 0; buf++, size--)
+         crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(*buf));
+
+      return crc32;
+   }
+
+   uint32_t crc32cSse42(const char* buf, size_t size)
+   {
+      return ~crc32cUpdateSse42(0xFFFFFFFF, buf, size, false);
+   }
+
+   uint32_t crc32cSse42Clmul(const char* buf, size_t size)
+   {
+      return ~crc32cUpdateSse42(0xFFFFFFFF, buf, size, true);
+   }
+#endif
+
+   typedef uint32_t (*Crc32cFunction)(const char* buf, size_t size);
+
+   /// Pick fastest CRC32C the CPU supports
+   Crc32cFunction crc32cSelect()
+   {
+#ifdef E57_CRC32C_SSE42
+      if (cpuFeatures().sse42 && cpuFeatures().pclmul)
+         return crc32cSse42Clmul;
+      if (cpuFeatures().sse42)
+         return crc32cSse42;
+#endif
+      return crc32cTable;
+   }
+}
+
 /// Calc CRC32C of given data
-uint32_t CheckedFile::checksum(char* buf, size_t size) const
+uint32_t CheckedFile::checksum(const char* buf, size_t size) const
 {
-   static const CRC::Parameters<crcpp_uint32, 32> sCRCParams{
-      0x1EDC6F41,
-      0xFFFFFFFF,
-      0xFFFFFFFF,
-      true,
-      true
-   };
+   static const Crc32cFunction sCrc32c = crc32cSelect();
 
-   static const CRC::Table<crcpp_uint32, 32>   sCRCTable = sCRCParams.MakeTable();
-
-   uint32_t crc = CRC::Calculate<crcpp_uint32, 32>( buf, size, sCRCTable );
+   uint32_t crc = sCrc32c( buf, size );
 
    swab( crc ); //!!! inside BIGENDIAN?
    return crc;
 }
 
-void CheckedFile::verifyChecksum( char *page_buffer, size_t page )
+void CheckedFile::verifyChecksum( const char *page_buffer, size_t page )
 {
    const uint32_t check_sum = checksum( page_buffer, logicalPageSize );
-   const uint32_t check_sum_in_page = *reinterpret_cast<uint32_t*>(&page_buffer[logicalPageSize]);
+   const uint32_t check_sum_in_page = *reinterpret_cast<const uint32_t*>(&page_buffer[logicalPageSize]);
 
    if ( check_sum_in_page != check_sum )
    {
@@ -608,31 +697,90 @@ void CheckedFile::getCurrentPageAndOffset(uint64_t& page, size_t& pageOffset, Of
    }
 }
 
+/// Map whole file into memory for reading.  If that isn't possible, map_ stays nullptr and reads use fd_.
+void CheckedFile::mapFile()
+{
+#if defined(LINUX) || defined(MACOS)
+   if ( physicalLength_ == 0 || physicalLength_ > static_cast<uint64_t>(SIZE_MAX) )
+   {
+      return;
+   }
+
+   void* p = ::mmap( nullptr, static_cast<size_t>(physicalLength_), PROT_READ, MAP_SHARED, fd_, 0 );
+   if ( p == MAP_FAILED )
+   {
+      return;
+   }
+
+   map_ = static_cast<const char*>( p );
+#endif
+}
+
+void CheckedFile::unmapFile()
+{
+#if defined(LINUX) || defined(MACOS)
+   if ( map_ != nullptr )
+   {
+      ::munmap( const_cast<char*>(map_), static_cast<size_t>(physicalLength_) );
+   }
+#endif
+   map_ = nullptr;
+}
+
 void CheckedFile::readPhysicalPage(char* page_buffer, uint64_t page)
+{
+   readPhysicalPages( page_buffer, page, 1 );
+}
+
+/// Read pageCount consecutive physical pages into page_buffer, in as few system calls as the OS allows.
+void CheckedFile::readPhysicalPages(char* page_buffer, uint64_t page, size_t pageCount)
 {
 #ifdef E57_MAX_VERBOSE
-   // cout << "readPhysicalPage, page:" << page << endl;
+   // cout << "readPhysicalPages, page:" << page << " pageCount:" << pageCount << endl;
 #endif
 
 #ifdef E57_CHECK_FILE_DEBUG
    const uint64_t physicalLength = length( Physical );
 
-   assert( page*physicalPageSize < physicalLength );
+   assert( (page+pageCount)*physicalPageSize <= physicalLength );
 #endif
 
-   /// Seek to start of physical page
-   seek( page*physicalPageSize, Physical );
+   uint64_t physicalOffset = page*physicalPageSize;
+   size_t   nRead = pageCount*physicalPageSize;
 
-#if defined(_MSC_VER)
-   int result = ::_read( fd_, page_buffer, physicalPageSize );
+#if !defined(LINUX) && !defined(MACOS)
+   std::lock_guard<std::mutex> guard( cursorMutex_ );
+
+   /// Seek to start of first physical page
+   lseek64( static_cast<int64_t>(physicalOffset), SEEK_SET );
+#endif
+
+   /// Loop in case the OS returns less than asked for
+   while ( nRead > 0 )
+   {
+      /// Use a positional read where we have one, so concurrent readers don't fight over the file cursor
+#if defined(LINUX)
+      ssize_t result = ::pread64( fd_, page_buffer, nRead, static_cast<off64_t>(physicalOffset) );
+#elif defined(MACOS)
+      ssize_t result = ::pread( fd_, page_buffer, nRead, static_cast<off_t>(physicalOffset) );
+#elif defined(_MSC_VER)
+      int result = ::_read( fd_, page_buffer, static_cast<unsigned>(nRead) );
 #elif defined(__GNUC__)
-   ssize_t result = ::read( fd_, page_buffer, physicalPageSize );
+      ssize_t result = ::read( fd_, page_buffer, nRead );
 #else
 #  error "no supported compiler defined"
 #endif
-   if ( result < 0 || static_cast<size_t>(result) != physicalPageSize )
-   {
-      throw E57_EXCEPTION2(E57_ERROR_READ_FAILED, "fileName=" + fileName_ + " result=" + toString(result));
+      if ( result <= 0 )
+      {
+         throw E57_EXCEPTION2(E57_ERROR_READ_FAILED, "fileName=" + fileName_
+                              + " result=" + toString(result)
+                              + " page=" + toString(page)
+                              + " pageCount=" + toString(pageCount));
+      }
+
+      page_buffer += result;
+      physicalOffset += static_cast<uint64_t>(result);
+      nRead -= static_cast<size_t>(result);
    }
 }
 
@@ -646,19 +794,113 @@ void CheckedFile::writePhysicalPage(char* page_buffer, uint64_t page)
    uint32_t check_sum = checksum(page_buffer, logicalPageSize);
    *reinterpret_cast<uint32_t*>(&page_buffer[logicalPageSize]) = check_sum;  //??? little endian dependency
 
+#if defined(LINUX)
+   ssize_t result = ::pwrite64(fd_, page_buffer, physicalPageSize, static_cast<off64_t>(page*physicalPageSize));
+#elif defined(MACOS)
+   ssize_t result = ::pwrite(fd_, page_buffer, physicalPageSize, static_cast<off_t>(page*physicalPageSize));
+#else
+   std::lock_guard<std::mutex> guard( cursorMutex_ );
+
    /// Seek to start of physical page
-   seek(page*physicalPageSize, Physical);
+   lseek64(static_cast<int64_t>(page*physicalPageSize), SEEK_SET);
 
-#if defined(_MSC_VER)
+#  if defined(_MSC_VER)
    int result = ::_write(fd_, page_buffer, physicalPageSize);
-#elif defined(__GNUC__)
+#  elif defined(__GNUC__)
    ssize_t result = ::write(fd_, page_buffer, physicalPageSize);
-#else
-#  error "no supported compiler defined"
+#  else
+#    error "no supported compiler defined"
+#  endif
 #endif
 
-   if (result < 0)
+   if (result < 0 || static_cast<size_t>(result) != physicalPageSize)
    {
       throw E57_EXCEPTION2(E57_ERROR_WRITE_FAILED, "fileName=" + fileName_ + " result=" + toString(result));
    }
 }
+
+///================================================================
+
+/// Text is written to the file when this much has been collected
+#define E57_WRITER_BUFFER_SIZE  (1024*1024)
+
+BufferedWriter::BufferedWriter(CheckedFile* cf)
+: cf_(cf)
+{
+}
+
+BufferedWriter& BufferedWriter::operator<<(const ustring& s)
+{
+   append(s.data(), s.length());
+   return(*this);
+}
+
+BufferedWriter& BufferedWriter::operator<<(const char* s)
+{
+   append(s, strlen(s));
+   return(*this);
+}
+
+BufferedWriter& BufferedWriter::operator<<(int64_t i)
+{
+   /// Negate as unsigned, so INT64_MIN works
+   if (i < 0)
+      appendInteger(0 - static_cast<uint64_t>(i), true);
+   else
+      appendInteger(static_cast<uint64_t>(i), false);
+   return(*this);
+}
+
+BufferedWriter& BufferedWriter::operator<<(uint64_t i)
+{
+   appendInteger(i, false);
+   return(*this);
+}
+
+BufferedWriter& BufferedWriter::operator<<(float f)
+{
+   char s[shortestStringSize];
+   append(s, formatShortest(f, s));
+   return(*this);
+}
+
+BufferedWriter& BufferedWriter::operator<<(double d)
+{
+   char s[shortestStringSize];
+   append(s, formatShortest(d, s));
+   return(*this);
+}
+
+uint64_t BufferedWriter::position()
+{
+   return(cf_->position(CheckedFile::Logical) + buffer_.length());
+}
+
+void BufferedWriter::flush()
+{
+   if (!buffer_.empty()) {
+      cf_->write(buffer_.data(), buffer_.length());
+      buffer_.clear();
+   }
+}
+
+void BufferedWriter::append(const char* s, size_t n)
+{
+   buffer_.append(s, n);
+   if (buffer_.length() >= E57_WRITER_BUFFER_SIZE)
+      flush();
+}
+
+void BufferedWriter::appendInteger(uint64_t magnitude, bool negative)
+{
+   /// Digits come out least significant first, so fill from end
+   char s[24];
+   char* first = s + sizeof(s);
+   do {
+      *--first = static_cast<char>('0' + magnitude % 10);
+      magnitude /= 10;
+   } while (magnitude > 0);
+   if (negative)
+      *--first = '-';
+   append(first, s + sizeof(s) - first);
+}
@@ -28,6 +28,8 @@
  */
 
 #include <algorithm>
+#include <mutex>
+#include <vector>
 
 #include "Common.h"
 
@@ -38,6 +40,7 @@ namespace e57 {
       public:
          enum Mode {
             ReadOnly,
+            ReadOnlyMapped,     /// ReadOnly, reading from file mapped into memory if possible
             WriteCreate,
             WriteExisting
          };
@@ -56,12 +59,8 @@ namespace e57 {
          ~CheckedFile();
 
          void            read(char* buf, size_t nRead, size_t bufSize = 0);
+         void            readAt(uint64_t logicalOffset, char* buf, size_t nRead);
          void            write(const char* buf, size_t nWrite);
-         CheckedFile&    operator<<(const e57::ustring& s);
-         CheckedFile&    operator<<(int64_t i);
-         CheckedFile&    operator<<(uint64_t i);
-         CheckedFile&    operator<<(float f);
-         CheckedFile&    operator<<(double d);
          void            seek(uint64_t offset, OffsetMode omode = Logical);
          uint64_t        position(OffsetMode omode = Logical);
          uint64_t        length(OffsetMode omode = Logical);
@@ -70,16 +69,14 @@ namespace e57 {
          void            flush();
          void            close();
          void            unlink();
+         bool            isMapped() const {return(map_ != nullptr);}
 
          static inline uint64_t logicalToPhysical(uint64_t logicalOffset);
          static inline uint64_t physicalToLogical(uint64_t physicalOffset);
 
       private:
-         uint32_t    checksum(char* buf, size_t size) const;
-         void        verifyChecksum( char *page_buffer, size_t page );
-
-         template<class FTYPE>
-         CheckedFile&    writeFloatingPoint(FTYPE value, int precision);
+         uint32_t    checksum(const char* buf, size_t size) const;
+         void        verifyChecksum( const char *page_buffer, size_t page );
 
          e57::ustring    fileName_;
          uint64_t        logicalLength_;
@@ -90,9 +87,30 @@ namespace e57 {
          int             fd_;
          bool            readOnly_;
 
+         /// Whole file mapped into memory in ReadOnlyMapped mode, or nullptr if reads use fd_
+         const char*     map_;
+
+         /// Physical offset of the cursor, kept here rather than in the OS so moving it is not a system call
+         uint64_t        cursor_;
+
+         /// Write-back buffer for one physical page, so that small writes to a page don't each read it, checksum it and write it
+         std::vector<char> writePage_;
+         uint64_t        writePageNumber_;   /// page held in writePage_, or UINT64_MAX if none
+         bool            writePageDirty_;    /// writePage_ has changes not yet written to file
+
+         /// Serializes seek+read pairs on platforms without a positional read
+         std::mutex      cursorMutex_;
+
          void        getCurrentPageAndOffset(uint64_t& page, size_t& pageOffset, OffsetMode omode = Logical);
+         void        readLogical(uint64_t logicalOffset, char* buf, size_t nRead);
          void        readPhysicalPage(char* page_buffer, uint64_t page);
+         void        readPhysicalPages(char* page_buffer, uint64_t page, size_t pageCount);
          void        writePhysicalPage(char* page_buffer, uint64_t page);
+         void        writeBuffered(const char* buf, size_t nWrite);
+         void        writePageLoad(uint64_t page, bool firstPageOfWrite);
+         void        writePageFlush();
+         void        mapFile();
+         void        unmapFile();
          int         open64(e57::ustring fileName, int flags, int mode);
          uint64_t    lseek64(int64_t offset, int whence);
    };
@@ -112,6 +130,33 @@ namespace e57 {
       return(page*logicalPageSize + std::min(remainder, logicalPageSize));
    }
 
+   /// Text output to a CheckedFile (the XML section), collected in memory and written in large blocks.
+   /// Numbers are formatted straight into the buffer, floating point values as the shortest string that reads back the same.
+   class BufferedWriter
+   {
+      public:
+         BufferedWriter(CheckedFile* cf);
+
+         BufferedWriter& operator<<(const e57::ustring& s);
+         BufferedWriter& operator<<(const char* s);
+         BufferedWriter& operator<<(int64_t i);
+         BufferedWriter& operator<<(uint64_t i);
+         BufferedWriter& operator<<(float f);
+         BufferedWriter& operator<<(double d);
+
+         /// Logical file position of the next char written, including what is still buffered
+         uint64_t        position();
+
+         /// Write buffered text to the file, must be called before the file is used directly again
+         void            flush();
+
+      private:
+         void            append(const char* s, size_t n);
+         void            appendInteger(uint64_t magnitude, bool negative);
+
+         CheckedFile*    cf_;
+         std::string     buffer_;
+   };
 }
 
 #endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <cstdlib>
+
+#include "Common.h"
+
+/// CPUID is only read on x86-64, other CPUs get none of the features
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define E57_HAVE_CPUID
+#elif defined(_M_X64) && defined(_MSC_VER)
+#define E57_HAVE_CPUID
+#include <intrin.h>
+#endif
+
+using namespace e57;
+
+namespace {
+    /// Turns off the features named in the environment variable E57_DISABLE_CPU_FEATURES, a comma separated list
+    /// of sse2, sse41, sse42, pclmul, avx2 or all.  Used by the tests to run the portable code on CPUs that have the extensions.
+    void cpuFeaturesMask(CpuFeatures& features)
+    {
+        const char* disable = std::getenv("E57_DISABLE_CPU_FEATURES");
+        if (disable == nullptr)
+            return;
+
+        std::istringstream names(disable);
+        std::string name;
+        while (std::getline(names, name, ',')) {
+            const bool all = (name == "all");
+            if (all || name == "sse2")
+                features.sse2 = false;
+            if (all || name == "sse41")
+                features.sse41 = false;
+            if (all || name == "sse42")
+                features.sse42 = false;
+            if (all || name == "pclmul")
+                features.pclmul = false;
+            if (all || name == "avx2")
+                features.avx2 = false;
+        }
+    }
+
+    CpuFeatures cpuFeaturesDetect()
+    {
+        CpuFeatures features;
+        features.sse2   = false;
+        features.sse41  = false;
+        features.sse42  = false;
+        features.pclmul = false;
+        features.avx2   = false;
+#ifdef E57_HAVE_CPUID
+        features.sse2   = true;
+#endif
+#if defined(E57_HAVE_CPUID) && defined(_MSC_VER)
+        /// Leaf 1 ECX: SSE4.1 bit 19, SSE4.2 bit 20, PCLMULQDQ bit 1, OSXSAVE bit 27.  Leaf 7 EBX: AVX2 bit 5.
+        /// AVX2 also needs the OS to save the AVX registers (XCR0 bits 1 and 2).
+        int regs[4];
+        __cpuid(regs, 0);
+        const int maxLeaf = regs[0];
+        __cpuid(regs, 1);
+        const unsigned ecx = static_cast<unsigned>(regs[2]);
+        features.sse41  = (ecx & (1U << 19)) != 0;
+        features.sse42  = (ecx & (1U << 20)) != 0;
+        features.pclmul = (ecx & (1U << 1)) != 0;
+        if (maxLeaf >= 7 && (ecx & (1U << 27)) && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(regs, 7, 0);
+            features.avx2 = (static_cast<unsigned>(regs[1]) & (1U << 5)) != 0;
+        }
+#elif defined(E57_HAVE_CPUID)
+        /// The compiler's tests include whether the OS saves the AVX registers
+        __builtin_cpu_init();
+        features.sse41  = __builtin_cpu_supports("sse4.1") != 0;
+        features.sse42  = __builtin_cpu_supports("sse4.2") != 0;
+        features.pclmul = __builtin_cpu_supports("pclmul") != 0;
+        features.avx2   = __builtin_cpu_supports("avx2") != 0;
+#endif
+        cpuFeaturesMask(features);
+        return(features);
+    }
+}
+
+const CpuFeatures& e57::cpuFeatures()
+{
+    static const CpuFeatures features = cpuFeaturesDetect();
+    return(features);
+}
@@ -90,6 +90,19 @@ inline std::string binaryString(int32_t x) {return(binaryString(static_cast<uint
 inline std::string binaryString(int16_t x) {return(binaryString(static_cast<uint16_t>(x)));}
 inline std::string binaryString(int8_t x)  {return(binaryString(static_cast<uint8_t>(x)));}
 
+/// Instruction set extensions of the CPU, used to pick the fastest versions of the bit packing and checksum routines.
+/// Detected once, on first call.  All false on CPUs other than x86-64.
+/// Features can be turned off with the environment variable E57_DISABLE_CPU_FEATURES, see Common.cpp.
+struct CpuFeatures {
+    bool sse2;      /// Always there on x86-64
+    bool sse41;
+    bool sse42;
+    bool pclmul;
+    bool avx2;      /// Also requires the OS to save the AVX registers
+};
+
+const CpuFeatures& cpuFeatures();
+
 /// Version numbers of ASTM standard that this library supports
 const uint32_t E57_FORMAT_MAJOR = 1;
 const uint32_t E57_FORMAT_MINOR = 0;
@@ -29,9 +29,226 @@
 #include "Decoder.h"
 #include "E57FoundationImpl.h"
 
+/// On x86-64 bit unpacking can use SSE4.1 or AVX2, chosen at run time by what the CPU has.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define E57_UNPACK_SIMD
+#define E57_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define E57_TARGET_AVX2  __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_M_X64) && defined(_MSC_VER)
+#define E57_UNPACK_SIMD
+#define E57_TARGET_SSE41
+#define E57_TARGET_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
 using namespace e57;
 using namespace std;
 
+/// Number of values BitpackIntegerDecoder unpacks at a time into a scratch array before storing them in the dest buffer.
+#define E57_UNPACK_BLOCK_SIZE   256
+
+namespace
+{
+   /// Unpack count values of bitsPerRecord bits (1 to 32) from a little endian bitstream starting at firstBit of inbuf.
+   /// May read up to 8 bytes past the byte holding the last bit, BitpackDecoder keeps spare bytes at the end of inBuffer_ for this.
+   typedef void (*UnpackFunction)(const char* inbuf, size_t firstBit, unsigned bitsPerRecord, size_t count, uint32_t* out);
+
+   void unpackPortable(const char* inbuf, size_t firstBit, unsigned bitsPerRecord, size_t count, uint32_t* out)
+   {
+      const uint64_t mask = (1ULL << bitsPerRecord) - 1;
+      size_t bit = firstBit;
+
+      /// A value is at most 32 bits starting somewhere in its first byte, so one unaligned 64 bit load always holds it
+      for (size_t i = 0; i < count; i++, bit += bitsPerRecord) {
+         uint64_t w;
+         memcpy(&w, &inbuf[bit >> 3], sizeof(w));
+         out[i] = static_cast<uint32_t>((w >> (bit & 7)) & mask);
+      }
+   }
+
+#ifdef E57_UNPACK_SIMD
+   /// Four values at a time, for bitsPerRecord <= 25 so four values fit in one 16 byte load, and each value with its shift fits in a lane.
+   /// A shuffle moves the four bytes holding each value into its lane.
+   /// No variable shift before AVX2, so each lane is shifted left by 7-shift with a multiply, then all lanes right by 7.
+   E57_TARGET_SSE41 void unpackSse41(const char* inbuf, size_t firstBit, unsigned bitsPerRecord, size_t count, uint32_t* out)
+   {
+      size_t i = 0;
+      if (bitsPerRecord <= 25) {
+         const __m128i mask = _mm_set1_epi32(static_cast<int>((1U << bitsPerRecord) - 1));
+
+         /// Bit positions within a block of four values repeat every two blocks, so set up a shuffle and multipliers for each
+         __m128i shuffle[2];
+         __m128i multiplier[2];
+         for (unsigned k = 0; k < 2; k++) {
+            const size_t blockBit = firstBit + 4*k*bitsPerRecord;
+            uint8_t  s[16];
+            uint32_t m[4];
+            for (unsigned j = 0; j < 4; j++) {
+               const size_t bit = blockBit + j*bitsPerRecord;
+               for (unsigned n = 0; n < 4; n++)
+                  s[4*j + n] = static_cast<uint8_t>((bit >> 3) - (blockBit >> 3) + n);
+               m[j] = 1U << (7 - (bit & 7));
+            }
+            shuffle[k]    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+            multiplier[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m));
+         }
+
+         /// Stop while the 16 byte load stays within 8 bytes past the end of the input
+         const size_t endByte = (firstBit + count*bitsPerRecord + 7) / 8;
+         size_t bit = firstBit;
+         for (unsigned k = 0; i + 4 <= count && (bit >> 3) + 16 <= endByte + 8; i += 4, k ^= 1) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&inbuf[bit >> 3]));
+            v = _mm_shuffle_epi8(v, shuffle[k]);
+            v = _mm_and_si128(_mm_srli_epi32(_mm_mullo_epi32(v, multiplier[k]), 7), mask);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), v);
+            bit += 4*bitsPerRecord;
+         }
+      }
+      unpackPortable(inbuf, firstBit + i*bitsPerRecord, bitsPerRecord, count - i, &out[i]);
+   }
+
+   /// Eight values at a time with 32 bit gathers for bitsPerRecord <= 25, four at a time with 64 bit gathers for wider values.
+   E57_TARGET_AVX2 void unpackAvx2(const char* inbuf, size_t firstBit, unsigned bitsPerRecord, size_t count, uint32_t* out)
+   {
+      size_t i = 0;
+
+      /// Gather indexes are 32 bit, input comes from a packet so is far smaller than that
+      if (firstBit + count*bitsPerRecord < (1U << 31)) {
+         const int b = static_cast<int>(bitsPerRecord);
+         if (bitsPerRecord <= 25) {
+            const __m256i mask  = _mm256_set1_epi32(static_cast<int>((1U << bitsPerRecord) - 1));
+            const __m256i seven = _mm256_set1_epi32(7);
+            const __m256i step  = _mm256_set1_epi32(8*b);
+            __m256i bit = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(firstBit)),
+                                           _mm256_setr_epi32(0, b, 2*b, 3*b, 4*b, 5*b, 6*b, 7*b));
+            for (; i + 8 <= count; i += 8) {
+               __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int*>(inbuf), _mm256_srli_epi32(bit, 3), 1);
+               v = _mm256_and_si256(_mm256_srlv_epi32(v, _mm256_and_si256(bit, seven)), mask);
+               _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out[i]), v);
+               bit = _mm256_add_epi32(bit, step);
+            }
+         } else {
+            const __m256i mask  = _mm256_set1_epi64x(static_cast<long long>((1ULL << bitsPerRecord) - 1));
+            const __m128i seven = _mm_set1_epi32(7);
+            const __m128i step  = _mm_set1_epi32(4*b);
+            const __m256i lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+            __m128i bit = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(firstBit)), _mm_setr_epi32(0, b, 2*b, 3*b));
+            for (; i + 4 <= count; i += 4) {
+               __m256i v = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(inbuf), _mm_srli_epi32(bit, 3), 1);
+               v = _mm256_and_si256(_mm256_srlv_epi64(v, _mm256_cvtepu32_epi64(_mm_and_si128(bit, seven))), mask);
+               v = _mm256_permutevar8x32_epi32(v, lowHalves);
+               _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), _mm256_castsi256_si128(v));
+               bit = _mm_add_epi32(bit, step);
+            }
+         }
+      }
+      unpackPortable(inbuf, firstBit + i*bitsPerRecord, bitsPerRecord, count - i, &out[i]);
+   }
+#endif
+
+   /// Pick fastest unpacker the CPU supports
+   UnpackFunction unpackSelect()
+   {
+#ifdef E57_UNPACK_SIMD
+      if (cpuFeatures().avx2)
+         return unpackAvx2;
+      if (cpuFeatures().sse41)
+         return unpackSse41;
+#endif
+      return unpackPortable;
+   }
+
+   /// Add minimum to unpacked values and store them in a contiguous array of T.  Caller has checked every value fits in T.
+   template <typename T>
+   void storeUnpacked(char* dest, const uint32_t* raw, size_t count, int64_t minimum, double /*scale*/, double /*offset*/)
+   {
+      T* d = reinterpret_cast<T*>(dest);
+      for (size_t i = 0; i < count; i++)
+         d[i] = static_cast<T>(minimum + static_cast<int64_t>(raw[i]));
+   }
+
+   /// Store (minimum + unpacked value)*scale + offset in a contiguous array of floating point type T.
+   /// Caller has checked that every result is in range of T.
+   template <typename T>
+   void storeUnpackedScaled(char* dest, const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset)
+   {
+      T* d = reinterpret_cast<T*>(dest);
+      for (size_t i = 0; i < count; i++)
+         d[i] = static_cast<T>(static_cast<double>(minimum + static_cast<int64_t>(raw[i]))*scale + offset);
+   }
+
+   typedef void (*StoreFunction)(char* dest, const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset);
+
+#ifdef E57_UNPACK_SIMD
+   /// Vector versions of storeUnpackedScaled.  Raw values are flipped to signed for the int32 to double conversion,
+   /// and the 2^31 this takes off is folded into base = minimum + 2^31.  Caller checks |minimum| <= 2^52, so minimum + raw
+   /// is exact in double, and the multiply and add round exactly as in storeUnpackedScaled.
+   inline void storeLanes(double* d, __m128d lo, __m128d hi) { _mm_storeu_pd(d, lo); _mm_storeu_pd(d + 2, hi); }
+   inline void storeLanes(float* d, __m128d lo, __m128d hi) { _mm_storeu_ps(d, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi))); }
+
+   /// SSE2 is part of x86-64, this needs no CPU check
+   template <typename T>
+   void storeScaledSse2(char* dest, const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset)
+   {
+      T* d = reinterpret_cast<T*>(dest);
+      const __m128i flip = _mm_set1_epi32(static_cast<int32_t>(0x80000000U));
+      const __m128d base = _mm_set1_pd(static_cast<double>(minimum) + 2147483648.0);
+      const __m128d s    = _mm_set1_pd(scale);
+      const __m128d o    = _mm_set1_pd(offset);
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4) {
+         const __m128i r  = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&raw[i])), flip);
+         const __m128d lo = _mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_cvtepi32_pd(r), base), s), o);
+         const __m128d hi = _mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_cvtepi32_pd(_mm_srli_si128(r, 8)), base), s), o);
+         storeLanes(&d[i], lo, hi);
+      }
+      storeUnpackedScaled<T>(reinterpret_cast<char*>(&d[i]), &raw[i], count - i, minimum, scale, offset);
+   }
+
+   E57_TARGET_AVX2 inline void storeLanes(double* d, __m256d lo, __m256d hi) { _mm256_storeu_pd(d, lo); _mm256_storeu_pd(d + 4, hi); }
+   E57_TARGET_AVX2 inline void storeLanes(float* d, __m256d lo, __m256d hi)
+   {
+      _mm256_storeu_ps(d, _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1));
+   }
+
+   template <typename T>
+   E57_TARGET_AVX2 void storeScaledAvx2(char* dest, const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset)
+   {
+      T* d = reinterpret_cast<T*>(dest);
+      const __m256i flip = _mm256_set1_epi32(static_cast<int32_t>(0x80000000U));
+      const __m256d base = _mm256_set1_pd(static_cast<double>(minimum) + 2147483648.0);
+      const __m256d s    = _mm256_set1_pd(scale);
+      const __m256d o    = _mm256_set1_pd(offset);
+      size_t i = 0;
+      for (; i + 8 <= count; i += 8) {
+         const __m256i r  = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&raw[i])), flip);
+         const __m256d lo = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(r)), base), s), o);
+         const __m256d hi = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(r, 1)), base), s), o);
+         storeLanes(&d[i], lo, hi);
+      }
+      storeUnpackedScaled<T>(reinterpret_cast<char*>(&d[i]), &raw[i], count - i, minimum, scale, offset);
+   }
+#endif
+
+   /// Pick fastest store of scaled values of type T the CPU supports, for a field with the given minimum
+   template <typename T>
+   StoreFunction scaledStoreSelect(int64_t minimum)
+   {
+#ifdef E57_UNPACK_SIMD
+      const int64_t exactLimit = 1LL << 52;
+      if (-exactLimit <= minimum && minimum <= exactLimit) {
+         if (cpuFeatures().avx2)
+            return storeScaledAvx2<T>;
+         if (cpuFeatures().sse2)
+            return storeScaledSse2<T>;
+      }
+#endif
+      return storeUnpackedScaled<T>;
+   }
+}
+
 
 shared_ptr<Decoder> Decoder::DecoderFactory(unsigned bytestreamNumber, //!!! name ok?
                                             shared_ptr<CompressedVectorNodeImpl> cVector,
@@ -175,10 +392,13 @@ Decoder::Decoder(unsigned bytestreamNumber)
 {
 }
 
+/// Decoders may read the whole word following the last word holding input, so inBuffer_ has this many extra bytes past the part that is filled.
+#define E57_IN_BUFFER_SPARE_BYTES   sizeof(uint64_t)
+
 BitpackDecoder::BitpackDecoder(unsigned bytestreamNumber, SourceDestBuffer& dbuf, unsigned alignmentSize, uint64_t maxRecordCount)
    : Decoder(bytestreamNumber),
      destBuffer_(dbuf.impl()),
-     inBuffer_(1024)            //!!! need to pick smarter channel buffer sizes
+     inBuffer_(1024 + E57_IN_BUFFER_SPARE_BYTES)            //!!! need to pick smarter channel buffer sizes
 {
    currentRecordIndex_     = 0;
    maxRecordCount_         = maxRecordCount;
@@ -194,6 +414,7 @@ void BitpackDecoder::destBufferSetNew(vector<SourceDestBuffer>& dbufs)
    if (dbufs.size() != 1)
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "dbufsSize=" + toString(dbufs.size()));
    destBuffer_ = dbufs.at(0).impl();
+   destBufferChanged();
 }
 
 size_t BitpackDecoder::inputProcess(const char* source, const size_t availableByteCount)
@@ -204,7 +425,41 @@ size_t BitpackDecoder::inputProcess(const char* source, const size_t availableBy
    size_t bytesUnsaved = availableByteCount;
    size_t bitsEaten = 0;
    do {
-      size_t byteCount = min(bytesUnsaved, inBuffer_.size() - static_cast<size_t>(inBufferEndByte_));
+      /// With nothing buffered, decode in place from caller's memory (e.g. the packet in the cache) without copying.
+      /// inBufferFirstBit_ is then the bit offset into the first byte of source.
+      /// Only whole words ending at least E57_IN_BUFFER_SPARE_BYTES before the end of source are offered,
+      /// so reading the following word, or the spare bytes past the last bit, stays inside source.
+      if (inBufferEndByte_ == 0 && bytesUnsaved > E57_IN_BUFFER_SPARE_BYTES + bytesPerWord_) {
+         size_t wordCount = (bytesUnsaved - E57_IN_BUFFER_SPARE_BYTES) / bytesPerWord_;
+         bitsEaten = inputProcessAligned(source, inBufferFirstBit_, wordCount * bitsPerWord_);
+#ifdef E57_MAX_VERBOSE
+         cout << "  in place bitsEaten=" << bitsEaten << " wordCount=" << wordCount << endl;
+#endif
+         /// Step over whole bytes eaten, keep bit offset into next byte.  Decoders don't need inbuf aligned to a word.
+         size_t nextBit   = inBufferFirstBit_ + bitsEaten;
+         size_t byteCount = nextBit / 8;
+         inBufferFirstBit_ = nextBit % 8;
+         source       += byteCount;
+         bytesUnsaved -= byteCount;
+
+         if (bitsEaten > 0)
+            continue;
+
+         /// Nothing eaten because destBuffer is full: leave the rest in source, caller feeds it again after the next read.
+         if (destBuffer_->nextIndex() == destBuffer_->capacity())
+            break;
+
+         /// Otherwise fall through and save the rest of source in inBuffer_, as when decoding from a copy
+      }
+
+      /// Nothing buffered and nothing offered: inBufferFirstBit_ is an offset into the next source, nothing to decode yet.
+      if (inBufferEndByte_ == 0 && bytesUnsaved == 0)
+         break;
+
+      /// Bytes already in inBuffer_ before this copy
+      size_t bufferedByteCount = inBufferEndByte_;
+
+      size_t byteCount = min(bytesUnsaved, inBuffer_.size() - E57_IN_BUFFER_SPARE_BYTES - static_cast<size_t>(inBufferEndByte_));
 
       /// Copy input bytes from caller, if any
       if (byteCount > 0) {
@@ -232,7 +487,7 @@ size_t BitpackDecoder::inputProcess(const char* source, const size_t availableBy
       /// Now that we have input stored in an aligned buffer, call derived class to try to eat some
       /// Note that end of filled buffer may not be at a natural boundary.
       /// The subclass may transfer this partial word in a full word transfer, but it must be carefull to only use the defined bits.
-      /// inBuffer_ is a multiple of largest word size, so this full word transfer off the end will always be in defined memory.
+      /// inBuffer_ has a spare word past the part that is filled, so this full word transfer off the end will always be in defined memory.
 
       size_t firstWord = inBufferFirstBit_ / bitsPerWord_;
       size_t firstNaturalBit = firstWord * bitsPerWord_;
@@ -254,6 +509,22 @@ size_t BitpackDecoder::inputProcess(const char* source, const size_t availableBy
 #endif
       inBufferFirstBit_ += bitsEaten;
 
+      /// Once decoding has passed the bytes that were buffered before this copy, the rest is still in source.
+      /// Forget the copy of it and go back to decoding in place, if there is enough of source left.
+      size_t copiedBit = 8 * bufferedByteCount;
+      if (bitsEaten > 0 && inBufferFirstBit_ >= copiedBit) {
+         size_t sourceBit    = inBufferFirstBit_ - copiedBit;
+         size_t sourceBytes  = sourceBit / 8;
+         size_t leftInSource = byteCount - sourceBytes + bytesUnsaved;
+         if (leftInSource > E57_IN_BUFFER_SPARE_BYTES + bytesPerWord_) {
+            source       -= byteCount - sourceBytes;
+            bytesUnsaved  = leftInSource;
+            inBufferFirstBit_ = sourceBit % 8;
+            inBufferEndByte_  = 0;
+            continue;
+         }
+      }
+
       /// Shift uneaten data to beginning of inBuffer_, keep on natural word boundaries.
       inBufferShiftDown();
 
@@ -270,6 +541,13 @@ void BitpackDecoder::stateReset()
    inBufferEndByte_  = 0;
 }
 
+void BitpackDecoder::recordIndexReset(uint64_t recordIndex)
+{
+   /// Throw away any buffered input, the next bytes fed in will be the start of recordIndex
+   stateReset();
+   currentRecordIndex_ = recordIndex;
+}
+
 void BitpackDecoder::inBufferShiftDown()
 {
    /// Move uneaten data down to beginning of inBuffer_.
@@ -321,6 +599,19 @@ BitpackFloatDecoder::BitpackFloatDecoder(unsigned bytestreamNumber, SourceDestBu
    : BitpackDecoder(bytestreamNumber, dbuf, (precision==E57_SINGLE) ? sizeof(float) : sizeof(double), maxRecordCount),
      precision_(precision)
 {
+   destBufferChanged();
+}
+
+void BitpackFloatDecoder::destBufferChanged()
+{
+   /// Values can be copied straight from the bytestream if dest is a plain array of the same type, and no swabbing is needed
+#ifdef E57_BIGENDIAN
+   directCopy_ = false;
+#else
+   const MemoryRepresentation sameType = (precision_ == E57_SINGLE) ? E57_REAL32 : E57_REAL64;
+   const size_t typeSize = (precision_ == E57_SINGLE) ? sizeof(float) : sizeof(double);
+   directCopy_ = destBuffer_->memoryRepresentation() == sameType && destBuffer_->stride() == typeSize;
+#endif
 }
 
 size_t BitpackFloatDecoder::inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit)
@@ -365,33 +656,44 @@ size_t BitpackFloatDecoder::inputProcessAligned(const char* inbuf, const size_t
    cout << "  n:" << n << endl; //???
 #endif
 
-   if (precision_ == E57_SINGLE) {
-      /// Form the starting address for first data location in inBuffer
-      const float* inp = reinterpret_cast<const float*>(inbuf);
-
-      /// Copy floats from inbuf to destBuffer_
-      for (unsigned i=0; i < n; i++) {
-         float value = *inp;
-         SWAB(&value);  /// swab if neccesary
+   if (directCopy_) {
+      /// Dest buffer was checked for room above, copy whole run of values
+      memcpy(&destBuffer_->base_[destBuffer_->nextIndex_ * typeSize], inbuf, n*typeSize);
+      destBuffer_->nextIndex_ += n;
+   } else if (precision_ == E57_SINGLE) {
+      /// Copy floats from inbuf to destBuffer_ a block at a time
+      float block[E57_TRANSFER_BLOCK_SIZE];
+      for (size_t done = 0; done < n; ) {
+         size_t count = min(n - done, static_cast<size_t>(E57_TRANSFER_BLOCK_SIZE));
+         memcpy(block, &inbuf[done*sizeof(float)], count*sizeof(float));
+#if defined(E57_BIGENDIAN) || defined(E57_MAX_VERBOSE)
+         /// Only needs a pass over the values if they have to be swabbed, or printed
+         for (size_t i = 0; i < count; i++) {
+            SWAB(&block[i]);  /// swab if neccesary
 #ifdef E57_MAX_VERBOSE
-         cout << "  got float value=" << value << endl;
+            cout << "  got float value=" << block[i] << endl;
 #endif
-         destBuffer_->setNextFloat(value);
-         inp++;
+         }
+#endif
+         destBuffer_->setNextBlock(block, count);
+         done += count;
       }
    } else {  /// E57_DOUBLE precision
-      /// Form the starting address for first data location in inBuffer
-      const double* inp = reinterpret_cast<const double*>(inbuf);
-
-      /// Copy doubles from inbuf to destBuffer_
-      for (unsigned i=0; i < n; i++) {
-         double value = *inp;
-         SWAB(&value);  /// swab if neccesary
+      /// Copy doubles from inbuf to destBuffer_ a block at a time
+      double block[E57_TRANSFER_BLOCK_SIZE];
+      for (size_t done = 0; done < n; ) {
+         size_t count = min(n - done, static_cast<size_t>(E57_TRANSFER_BLOCK_SIZE));
+         memcpy(block, &inbuf[done*sizeof(double)], count*sizeof(double));
+#if defined(E57_BIGENDIAN) || defined(E57_MAX_VERBOSE)
+         for (size_t i = 0; i < count; i++) {
+            SWAB(&block[i]);  /// swab if neccesary
 #ifdef E57_MAX_VERBOSE
-         cout << "  got double value=" << value << endl;
+            cout << "  got double value=" << block[i] << endl;
+#endif
+         }
 #endif
-         destBuffer_->setNextDouble(value);
-         inp++;
+         destBuffer_->setNextBlock(block, count);
+         done += count;
       }
    }
 
@@ -402,6 +704,15 @@ size_t BitpackFloatDecoder::inputProcessAligned(const char* inbuf, const size_t
    return(n*8*typeSize);
 }
 
+bool BitpackFloatDecoder::recordPosition(uint64_t recordNumber, uint64_t& startRecordNumber, uint64_t& byteOffset)
+{
+   /// Every record is one float or double, so can start at any record
+   size_t typeSize = (precision_ == E57_SINGLE) ? sizeof(float) : sizeof(double);
+   startRecordNumber = recordNumber;
+   byteOffset        = recordNumber * typeSize;
+   return(true);
+}
+
 #ifdef E57_DEBUG
 void BitpackFloatDecoder::dump(int indent, std::ostream& os)
 {
@@ -445,8 +756,8 @@ size_t BitpackStringDecoder::inputProcessAligned(const char* inbuf, const size_t
    size_t nBytesAvailable = (endBit - firstBit) >> 3;
    size_t nBytesRead = 0;
 
-   /// Loop until we've finished all the records, or ran out of input currently available
-   while (currentRecordIndex_ < maxRecordCount_ && nBytesRead < nBytesAvailable) {
+   /// Loop until we've finished all the records, filled the dest buffer, or ran out of input currently available
+   while (currentRecordIndex_ < maxRecordCount_ && destBuffer_->nextIndex() < destBuffer_->capacity() && nBytesRead < nBytesAvailable) {
 #ifdef E57_MAX_VERBOSE
       cout << "read string loop1: readingPrefix=" << readingPrefix_ << " prefixLength=" << prefixLength_ << " nBytesPrefixRead="
            << nBytesPrefixRead_ << " nBytesStringRead=" << nBytesStringRead_ << endl;
@@ -542,6 +853,26 @@ size_t BitpackStringDecoder::inputProcessAligned(const char* inbuf, const size_t
    return(nBytesRead*8);
 }
 
+bool BitpackStringDecoder::recordPosition(uint64_t /*recordNumber*/, uint64_t& /*startRecordNumber*/, uint64_t& /*byteOffset*/)
+{
+   /// Strings are variable length, so can't tell where a record is without reading all the ones before it
+   return(false);
+}
+
+void BitpackStringDecoder::stateReset()
+{
+   BitpackDecoder::stateReset();
+
+   /// Forget any partially read string, get ready to read next prefix
+   readingPrefix_      = true;
+   prefixLength_       = 1;
+   memset(prefixBytes_, 0, sizeof(prefixBytes_));
+   nBytesPrefixRead_   = 0;
+   stringLength_       = 0;
+   currentString_      = "";
+   nBytesStringRead_   = 0;
+}
+
 #ifdef E57_DEBUG
 void BitpackStringDecoder::dump(int indent, std::ostream& os)
 {
@@ -579,6 +910,94 @@ BitpackIntegerDecoder<RegisterT>::BitpackIntegerDecoder(bool isScaledInteger, un
    offset_             = offset;
    bitsPerRecord_      = imf->bitsNeeded(minimum_, maximum_);
    destBitMask_        = (bitsPerRecord_==64) ? ~0 : (1ULL<<bitsPerRecord_)-1;
+
+   destBufferChanged();
+}
+
+template <typename RegisterT>
+void BitpackIntegerDecoder<RegisterT>::destBufferChanged()
+{
+   /// Pick the block store for this combination of field and dest buffer, or none if the values need a per value check or conversion.
+   blockStore_ = nullptr;
+   blockStoreElementSize_ = 0;
+   if (bitsPerRecord_ > 32)
+      return;
+
+   /// Every value is in [minimum_, minimum_ + destBitMask_], check once that the whole range fits in the dest type.
+   const bool scaling = isScaledInteger_ && destBuffer_->doScaling();
+   const int64_t low  = minimum_;
+   const int64_t high = minimum_ + static_cast<int64_t>(destBitMask_);
+   BlockStoreFunction store = nullptr;
+   size_t elementSize = 0;
+   switch (destBuffer_->memoryRepresentation()) {
+      case E57_INT8:
+         if (!scaling && E57_INT8_MIN <= low && high <= E57_INT8_MAX) {
+            store = storeUnpacked<int8_t>;
+            elementSize = sizeof(int8_t);
+         }
+         break;
+      case E57_UINT8:
+         if (!scaling && E57_UINT8_MIN <= low && high <= E57_UINT8_MAX) {
+            store = storeUnpacked<uint8_t>;
+            elementSize = sizeof(uint8_t);
+         }
+         break;
+      case E57_INT16:
+         if (!scaling && E57_INT16_MIN <= low && high <= E57_INT16_MAX) {
+            store = storeUnpacked<int16_t>;
+            elementSize = sizeof(int16_t);
+         }
+         break;
+      case E57_UINT16:
+         if (!scaling && E57_UINT16_MIN <= low && high <= E57_UINT16_MAX) {
+            store = storeUnpacked<uint16_t>;
+            elementSize = sizeof(uint16_t);
+         }
+         break;
+      case E57_INT32:
+         if (!scaling && E57_INT32_MIN <= low && high <= E57_INT32_MAX) {
+            store = storeUnpacked<int32_t>;
+            elementSize = sizeof(int32_t);
+         }
+         break;
+      case E57_UINT32:
+         if (!scaling && E57_UINT32_MIN <= low && high <= E57_UINT32_MAX) {
+            store = storeUnpacked<uint32_t>;
+            elementSize = sizeof(uint32_t);
+         }
+         break;
+      case E57_INT64:
+         if (!scaling) {
+            store = storeUnpacked<int64_t>;
+            elementSize = sizeof(int64_t);
+         }
+         break;
+      case E57_REAL32:
+         /// Integers are stored as floating point only if user asked for conversion.
+         /// Scaling is monotonic, so the scaled ends of the range bound every scaled value.
+         if (destBuffer_->doConversion()) {
+            const double a = scaling ? low*scale_ + offset_ : static_cast<double>(low);
+            const double b = scaling ? high*scale_ + offset_ : static_cast<double>(high);
+            if (E57_DOUBLE_MIN <= min(a, b) && max(a, b) <= E57_DOUBLE_MAX) {
+               store = scaling ? scaledStoreSelect<float>(minimum_) : storeUnpacked<float>;
+               elementSize = sizeof(float);
+            }
+         }
+         break;
+      case E57_REAL64:
+         if (destBuffer_->doConversion()) {
+            store = scaling ? scaledStoreSelect<double>(minimum_) : storeUnpacked<double>;
+            elementSize = sizeof(double);
+         }
+         break;
+      default:
+         break;
+   }
+   if (store == nullptr || destBuffer_->stride() != elementSize)
+      return;
+
+   blockStore_ = store;
+   blockStoreElementSize_ = elementSize;
 }
 
 template <typename RegisterT>
@@ -621,7 +1040,15 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned(const char* inbuf,
    cout << "  recordCount=" << recordCount << endl; //???
 #endif
 
-   const RegisterT* inp = reinterpret_cast<const RegisterT*>(inbuf);
+#ifndef E57_BIGENDIAN
+   /// Common case of narrow values going into a plain integer array is done in blocks by the unpack kernels
+   if (inputProcessBlocks(inbuf, firstBit, recordCount)) {
+      currentRecordIndex_ += recordCount;
+      return(recordCount * bitsPerRecord_);
+   }
+#endif
+
+   /// Words are loaded with memcpy, inbuf may be in a packet and not aligned to RegisterT.
    unsigned wordPosition = 0;      /// The index in inbuf of the word we are currently working on.
 
    ///  For example on little endian machine:
@@ -636,13 +1063,19 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned(const char* inbuf,
 
    size_t bitOffset = firstBit;
 
+   /// Values are collected in a block, and handed to destBuffer_ when it is full
+   int64_t block[E57_TRANSFER_BLOCK_SIZE];
+   size_t blockCount = 0;
+
    for (size_t i = 0; i < recordCount; i++) {
       /// Get lower word (contains at least the LSbit of the value),
-      RegisterT low = inp[wordPosition];
+      RegisterT low;
+      memcpy(&low, &inbuf[wordPosition*sizeof(RegisterT)], sizeof(low));
       SWAB(&low);  // swab if necessary
 
       /// Get upper word (may or may not contain interesting bits),
-      RegisterT high = inp[wordPosition+1];
+      RegisterT high;
+      memcpy(&high, &inbuf[(wordPosition+1)*sizeof(RegisterT)], sizeof(high));
       SWAB(&high);  // swab if necessary
 
       RegisterT w;
@@ -671,13 +1104,16 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned(const char* inbuf,
       cout << "  Storing value=" << value << endl;
 #endif
 
-      /// The parameter isScaledInteger_ determines which version of setNextInt64 gets called
-      if (isScaledInteger_)
-         destBuffer_->setNextInt64(value, scale_, offset_);
-      else
-         destBuffer_->setNextInt64(value);
-
-      /// Store the result in next avaiable position in the user's dest buffer
+      /// Store the result in next avaiable position in the block, flush to user's dest buffer when full
+      block[blockCount++] = value;
+      if (blockCount == E57_TRANSFER_BLOCK_SIZE || i + 1 == recordCount) {
+         /// The parameter isScaledInteger_ determines which version of setNextBlock gets called
+         if (isScaledInteger_)
+            destBuffer_->setNextBlock(block, blockCount, scale_, offset_);
+         else
+            destBuffer_->setNextBlock(block, blockCount);
+         blockCount = 0;
+      }
 
       /// Calc next bit alignment and which word it starts in
       bitOffset += bitsPerRecord_;
@@ -698,6 +1134,52 @@ size_t BitpackIntegerDecoder<RegisterT>::inputProcessAligned(const char* inbuf,
    return(recordCount * bitsPerRecord_);
 }
 
+template <typename RegisterT>
+bool BitpackIntegerDecoder<RegisterT>::inputProcessBlocks(const char* inbuf, const size_t firstBit, const size_t recordCount)
+{
+   /// Returns false, having done nothing, if no block store was picked for the dest buffer.
+   if (blockStore_ == nullptr)
+      return(false);
+
+   static const UnpackFunction sUnpack = unpackSelect();
+
+   /// Dest buffer was checked for room by caller
+   char* dest = &destBuffer_->base_[destBuffer_->nextIndex_ * blockStoreElementSize_];
+   uint32_t raw[E57_UNPACK_BLOCK_SIZE];
+   size_t bit = firstBit;
+   for (size_t done = 0; done < recordCount; ) {
+      size_t count = min(recordCount - done, static_cast<size_t>(E57_UNPACK_BLOCK_SIZE));
+      sUnpack(inbuf, bit, bitsPerRecord_, count, raw);
+      blockStore_(dest, raw, count, minimum_, scale_, offset_);
+      dest += count * blockStoreElementSize_;
+      bit  += count * bitsPerRecord_;
+      done += count;
+   }
+   destBuffer_->nextIndex_ += recordCount;
+
+   return(true);
+}
+
+template <typename RegisterT>
+bool BitpackIntegerDecoder<RegisterT>::recordPosition(uint64_t recordNumber, uint64_t& startRecordNumber, uint64_t& byteOffset)
+{
+   /// Records are packed end to end in RegisterT words, so decoding has to start at a record that begins on a word boundary.
+   /// That happens every registerBits/gcd(bitsPerRecord_, registerBits) records.
+   unsigned registerBits = 8*sizeof(RegisterT);
+   unsigned a = bitsPerRecord_;
+   unsigned b = registerBits;
+   while (b != 0) {
+      unsigned t = a % b;
+      a = b;
+      b = t;
+   }
+   uint64_t alignment = registerBits / a;
+
+   startRecordNumber = (recordNumber / alignment) * alignment;
+   byteOffset        = startRecordNumber * bitsPerRecord_ / 8;
+   return(true);
+}
+
 #ifdef E57_DEBUG
 template <typename RegisterT>
 void BitpackIntegerDecoder<RegisterT>::dump(int indent, std::ostream& os)
@@ -749,12 +1231,16 @@ size_t ConstantIntegerDecoder::inputProcess(const char* source, const size_t ava
    if (static_cast<uint64_t>(count) > remainingRecordCount)
       count = static_cast<unsigned>(remainingRecordCount);
 
-   if (isScaledInteger_) {
-      for (unsigned i = 0; i < count; i++)
-         destBuffer_->setNextInt64(minimum_, scale_, offset_);
-   } else {
-      for (unsigned i = 0; i < count; i++)
-         destBuffer_->setNextInt64(minimum_);
+   /// Hand a block of copies of minimum_ to destBuffer_ at a time
+   int64_t block[E57_TRANSFER_BLOCK_SIZE];
+   fill(block, block + min(count, static_cast<size_t>(E57_TRANSFER_BLOCK_SIZE)), minimum_);
+   for (size_t done = 0; done < count; ) {
+      size_t n = min(count - done, static_cast<size_t>(E57_TRANSFER_BLOCK_SIZE));
+      if (isScaledInteger_)
+         destBuffer_->setNextBlock(block, n, scale_, offset_);
+      else
+         destBuffer_->setNextBlock(block, n);
+      done += n;
    }
    currentRecordIndex_ += count;
    return(count);
@@ -764,6 +1250,19 @@ void ConstantIntegerDecoder::stateReset()
 {
 }
 
+void ConstantIntegerDecoder::recordIndexReset(uint64_t recordIndex)
+{
+   currentRecordIndex_ = recordIndex;
+}
+
+bool ConstantIntegerDecoder::recordPosition(uint64_t recordNumber, uint64_t& startRecordNumber, uint64_t& byteOffset)
+{
+   /// We don't use any input bytes
+   startRecordNumber = recordNumber;
+   byteOffset        = 0;
+   return(true);
+}
+
 #ifdef E57_DEBUG
 void ConstantIntegerDecoder::dump(int indent, std::ostream& os)
 {
@@ -44,6 +44,9 @@ namespace e57 {
          virtual uint64_t    totalRecordsCompleted() = 0;
          virtual size_t      inputProcess(const char* source, const size_t count) = 0;
          virtual void        stateReset() = 0;
+         virtual void        recordIndexReset(uint64_t recordIndex) = 0;      /// discard state, next input starts at recordIndex
+         virtual void        maxRecordCountSet(uint64_t maxRecordCount) = 0;
+         virtual bool        recordPosition(uint64_t recordNumber, uint64_t& startRecordNumber, uint64_t& byteOffset) = 0;
          unsigned            bytestreamNumber() {return(bytestreamNumber_);}
 #ifdef E57_DEBUG
          virtual void        dump(int indent = 0, std::ostream& os = std::cout) = 0;
@@ -70,6 +73,8 @@ namespace e57 {
          virtual size_t      inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit) = 0;
 
          virtual void        stateReset();
+         virtual void        recordIndexReset(uint64_t recordIndex);
+         virtual void        maxRecordCountSet(uint64_t maxRecordCount) {maxRecordCount_ = maxRecordCount;}
 
 #ifdef E57_DEBUG
          virtual void        dump(int indent = 0, std::ostream& os = std::cout);
@@ -79,12 +84,15 @@ namespace e57 {
 
          void                inBufferShiftDown();
 
+         /// Called when destBuffer_ is replaced, so a subclass can pick how it stores into the new buffer
+         virtual void        destBufferChanged() {}
+
          uint64_t            currentRecordIndex_;
          uint64_t            maxRecordCount_;
 
          std::shared_ptr<SourceDestBufferImpl> destBuffer_;
 
-         std::vector<char>   inBuffer_;
+         std::vector<char>   inBuffer_;                 /// input bytes, plus one spare word at end that is never filled
          size_t              inBufferFirstBit_;
          size_t              inBufferEndByte_;
          unsigned            inBufferAlignmentSize_;
@@ -100,11 +108,16 @@ namespace e57 {
 
          virtual size_t      inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit);
 
+         virtual bool        recordPosition(uint64_t recordNumber, uint64_t& startRecordNumber, uint64_t& byteOffset);
+
 #ifdef E57_DEBUG
          virtual void        dump(int indent = 0, std::ostream& os = std::cout);
 #endif
       protected:
+         virtual void        destBufferChanged();
+
          FloatPrecision      precision_;
+         bool                directCopy_;        /// dest buffer is a plain array of the same type, so values are copied with memcpy
    };
 
 
@@ -115,6 +128,9 @@ namespace e57 {
 
          virtual size_t      inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit);
 
+         virtual void        stateReset();
+         virtual bool        recordPosition(uint64_t recordNumber, uint64_t& startRecordNumber, uint64_t& byteOffset);
+
 #ifdef E57_DEBUG
          virtual void        dump(int indent = 0, std::ostream& os = std::cout);
 #endif
@@ -138,10 +154,18 @@ namespace e57 {
 
          virtual size_t      inputProcessAligned(const char* inbuf, const size_t firstBit, const size_t endBit);
 
+         virtual bool        recordPosition(uint64_t recordNumber, uint64_t& startRecordNumber, uint64_t& byteOffset);
+
 #ifdef E57_DEBUG
          virtual void        dump(int indent = 0, std::ostream& os = std::cout);
 #endif
       protected:
+         /// Stores a block of unpacked values in a plain dest array
+         typedef void (*BlockStoreFunction)(char* dest, const uint32_t* raw, size_t count, int64_t minimum, double scale, double offset);
+
+         virtual void        destBufferChanged();
+         bool        inputProcessBlocks(const char* inbuf, const size_t firstBit, const size_t recordCount);
+
          bool        isScaledInteger_;
          int64_t     minimum_;
          int64_t     maximum_;
@@ -149,6 +173,9 @@ namespace e57 {
          double      offset_;
          unsigned    bitsPerRecord_;
          RegisterT   destBitMask_;
+
+         BlockStoreFunction blockStore_;            /// picked by destBufferChanged() for dest buffer, nullptr if values need the per value loop
+         size_t      blockStoreElementSize_;
    };
 
 
@@ -161,6 +188,9 @@ namespace e57 {
          virtual uint64_t    totalRecordsCompleted() {return(currentRecordIndex_);}
          virtual size_t      inputProcess(const char* source, const size_t byteCount);
          virtual void        stateReset();
+         virtual void        recordIndexReset(uint64_t recordIndex);
+         virtual void        maxRecordCountSet(uint64_t maxRecordCount) {maxRecordCount_ = maxRecordCount;}
+         virtual bool        recordPosition(uint64_t recordNumber, uint64_t& startRecordNumber, uint64_t& byteOffset);
 #ifdef E57_DEBUG
          virtual void        dump(int indent = 0, std::ostream& os = std::cout);
 #endif
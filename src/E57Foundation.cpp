@@ -1905,6 +1905,25 @@ bool StructureNode::isDefined(const ustring& pathName) const
     return impl_->isDefined(pathName);
 }
 
+/*!
+@brief   Is the given pre-parsed path defined relative to this node.
+@param   [in] path   The absolute path, or path relative to this object, to check.
+@details
+Same as StructureNode::isDefined(const ustring&) const, without parsing the path name again.
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre     The @a path must have been created for the destination ImageFile of this StructureNode.
+@post    No visible state is modified.
+@return  true if path is currently defined.
+@throw   ::E57_ERROR_DIFFERENT_DEST_IMAGEFILE
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     NodePath, StructureNode::get(const NodePath&) const
+*/
+bool StructureNode::isDefined(const NodePath& path) const
+{
+    return impl_->isDefined(*path.impl());
+}
+
 /*!
 @brief   Get a child element by positional index.
 @param   [in] index   The index of child element to get, starting at 0.
@@ -1946,6 +1965,28 @@ Node StructureNode::get(const ustring& pathName) const
     return Node(impl_->get(pathName));
 }
 
+/*!
+@brief   Get a child by pre-parsed path.
+@param   [in] path   The absolute path, or path relative to this object, of the object to get.
+@details
+Same as StructureNode::get(const ustring&) const, without parsing the path name again.
+The node found is remembered in @a path, so getting it again from the same StructureNode (or, for an absolute path, from any node in the same tree) doesn't search the tree.
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre     The @a path must have been created for the destination ImageFile of this StructureNode.
+@pre     The @a path must be defined (i.e. isDefined(path)).
+@post    No visible state is modified.
+@return  A smart Node handle referencing the child node.
+@throw   ::E57_ERROR_PATH_UNDEFINED
+@throw   ::E57_ERROR_DIFFERENT_DEST_IMAGEFILE
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     NodePath, StructureNode::get(const ustring&) const
+*/
+Node StructureNode::get(const NodePath& path) const
+{
+    return Node(impl_->get(*path.impl()));
+}
+
 /*!
 @brief   Add a new child at a given path
     @param   [in] pathName  The absolute pathname, or pathname relative to this object, that the child object @a n will be given.
@@ -2188,6 +2229,25 @@ bool VectorNode::isDefined(const ustring& pathName) const
     return impl_->isDefined(pathName);
 }
 
+/*!
+@brief   Is the given pre-parsed path defined relative to this node.
+@param   [in] path   The absolute path, or path relative to this object, to check.
+@details
+Same as VectorNode::isDefined(const ustring&) const, without parsing the path name again.
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre     The @a path must have been created for the destination ImageFile of this VectorNode.
+@post    No visible state is modified.
+@return  true if path is currently defined.
+@throw   ::E57_ERROR_DIFFERENT_DEST_IMAGEFILE
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     NodePath, StructureNode::isDefined(const NodePath&) const
+*/
+bool VectorNode::isDefined(const NodePath& path) const
+{
+    return impl_->isDefined(*path.impl());
+}
+
 /*!
 @brief   Get a child element by positional index.
 @param   [in] index   The index of child element to get, starting at 0.
@@ -2229,6 +2289,27 @@ Node VectorNode::get(const ustring& pathName) const
     return Node(impl_->get(pathName));
 }
 
+/*!
+@brief   Get a child element by pre-parsed path.
+@param   [in] path   The absolute path, or path relative to this object, of the object to get.
+@details
+Same as VectorNode::get(const ustring&) const, without parsing the path name again.
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre     The @a path must have been created for the destination ImageFile of this VectorNode.
+@pre     The @a path must be defined (i.e. isDefined(path)).
+@post    No visible state is modified.
+@return  A smart Node handle referencing the child node.
+@throw   ::E57_ERROR_PATH_UNDEFINED
+@throw   ::E57_ERROR_DIFFERENT_DEST_IMAGEFILE
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     NodePath, StructureNode::get(const NodePath&) const
+*/
+Node VectorNode::get(const NodePath& path) const
+{
+    return Node(impl_->get(*path.impl()));
+}
+
 /*!
 @brief   Append a child element to end of VectorNode.
 @param   [in] n   The node to be added as a child at end of the VectorNode.
@@ -2307,6 +2388,79 @@ VectorNode::VectorNode(shared_ptr<VectorNodeImpl> ni)
 {}
 //! @endcond
 
+//=====================================================================================
+/*!
+@class NodePath
+@brief   A path name that has been parsed and checked once, for repeated lookups.
+@details
+StructureNode::get(const ustring&) const and StructureNode::isDefined(const ustring&) const parse and check the path name on every call.
+A NodePath does this once, when it is created, and can then be used with StructureNode::get(const NodePath&) const, StructureNode::isDefined(const NodePath&) const and the VectorNode equivalents, on any node of the ImageFile it was created for.
+This helps loops that get the same fields out of many nodes, for example the pose of each child of "/data3D".
+
+A relative NodePath is looked up from the node it is used with, an absolute NodePath from the root of the tree containing that node.
+Since nodes can't be removed or replaced once set, the NodePath remembers the node it found from each of the last few starting nodes.
+Using it again from one of these returns the remembered node without searching, so an absolute NodePath is only searched for once per tree.
+A relative NodePath used from many different nodes in turn (e.g. each child of "/data3D") mostly searches, and only saves the parsing of the path name.
+A NodePath may be used from several threads at the same time.
+
+@see     StructureNode, VectorNode
+*/
+
+/*!
+@brief   Parse and check a path name for later lookups in an ImageFile.
+@param   [in] destImageFile   The ImageFile whose nodes the path will be looked up in.
+@param   [in] pathName        The absolute pathname (starting with a "/"), or a relative pathname.
+@details
+The element names in @a pathName are checked to be legal, including that any prefixes are declared extensions in @a destImageFile.
+It is not checked that @a pathName is defined, this is done when the NodePath is used.
+@pre     The @a destImageFile must be open (i.e. destImageFile.isOpen()).
+@post    No visible state is modified.
+@throw   ::E57_ERROR_BAD_PATH_NAME
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     StructureNode::get(const NodePath&) const, VectorNode::get(const NodePath&) const
+*/
+NodePath::NodePath(ImageFile destImageFile, const ustring& pathName)
+: impl_(new NodePathImpl(destImageFile.impl(), pathName))
+{
+}
+
+/*!
+@brief   Get the path name this NodePath was created with.
+@post    No visible state is modified.
+@return  The path name given to the constructor.
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     NodePath::isRelative
+*/
+ustring NodePath::pathName() const
+{
+    return impl_->pathName();
+}
+
+/*!
+@brief   Is this NodePath looked up relative to the node it is used with.
+@post    No visible state is modified.
+@return  false if the path name starts with "/", true otherwise.
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     NodePath::pathName
+*/
+bool NodePath::isRelative() const
+{
+    return impl_->isRelative();
+}
+
+//! @brief   Diagnostic function to print internal state of object to output stream in an indented format.
+//! @copydetails Node::dump()
+#ifdef E57_DEBUG
+void NodePath::dump(int indent, std::ostream& os) const
+{
+    impl_->dump(indent, os);
+}
+#else
+void NodePath::dump(int indent, std::ostream& os) const
+{}
+#endif
+
 //=====================================================================================
 /*!
 @class SourceDestBuffer
@@ -2470,6 +2624,12 @@ SourceDestBuffer::SourceDestBuffer(ImageFile destImageFile, const ustring pathNa
 {
 }
 
+//! @cond documentNonPublic   The following isn't part of the API, and isn't documented.
+SourceDestBuffer::SourceDestBuffer(shared_ptr<SourceDestBufferImpl> ni)
+: impl_(ni)
+{}
+//! @endcond
+
 /*!
 @brief   Get path name in prototype that this SourceDestBuffer will transfer data to/from.
 @details
@@ -2728,6 +2888,52 @@ unsigned CompressedVectorReader::read(std::vector<SourceDestBuffer>& dbufs)
     return impl_->read(dbufs);
 }
 
+/*!
+@brief   Transfer every record of the CompressedVectorNode into given destination buffers, using several threads.
+@param   [in] dbufs         Vector of memory buffers that will receive data read from a CompressedVectorNode.
+@param   [in] threadCount   Most threads to decode with, or 0 to use one per hardware thread.
+@details
+Each SourceDestBuffer within @a dbufs must have a capacity of at least childCount() of the CompressedVectorNode.
+The @a dbufs may name a different set of fields than the SourceDestBuffers designated for this CompressedVectorReader.
+
+The records are split into consecutive slices, and each slice is decoded by its own thread directly into its part of the @a dbufs.
+Each thread positions itself with a seek (see CompressedVectorReader::seek), so the file need not have index packets.
+Slices are at least 65536 records, so small vectors are read by fewer threads.
+String fields have to be decoded from the first record, and are read in one additional thread for the whole vector.
+If the ImageFile was opened in write mode, everything is read on the calling thread (see CompressedVectorNode::reader).
+
+The position of this CompressedVectorReader and its designated SourceDestBuffers are not changed.
+If an error occurs in any thread, all threads are finished before the first error is rethrown, and the contents of @a dbufs are undefined.
+
+The API user is responsible for ensuring that the underlying memory buffers represented in the SourceDestBuffers still exist when this function is called.
+The E57 Foundation Implementation cannot detect that a memory buffer been destroyed.
+
+@pre     The associated ImageFile must be open.
+@pre     This CompressedVectorReader must be open (i.e isOpen())
+@return  The number of records read, childCount() of the CompressedVectorNode.
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_READER_NOT_OPEN
+@throw   ::E57_ERROR_PATH_UNDEFINED
+@throw   ::E57_ERROR_BUFFER_DUPLICATE_PATHNAME
+@throw   ::E57_ERROR_CONVERSION_REQUIRED
+@throw   ::E57_ERROR_VALUE_NOT_REPRESENTABLE
+@throw   ::E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE
+@throw   ::E57_ERROR_REAL64_TOO_LARGE
+@throw   ::E57_ERROR_EXPECTING_NUMERIC
+@throw   ::E57_ERROR_EXPECTING_USTRING
+@throw   ::E57_ERROR_BAD_CV_PACKET      Associated ImageFile in undocumented state
+@throw   ::E57_ERROR_LSEEK_FAILED       Associated ImageFile in undocumented state
+@throw   ::E57_ERROR_READ_FAILED        Associated ImageFile in undocumented state
+@throw   ::E57_ERROR_BAD_CHECKSUM       Associated ImageFile in undocumented state
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     CompressedVectorReader::read(std::vector<SourceDestBuffer>&), CompressedVectorReader::seek, CompressedVectorNode::reader, SourceDestBuffer
+*/
+uint64_t CompressedVectorReader::readAll(std::vector<SourceDestBuffer>& dbufs, unsigned threadCount)
+{
+    return impl_->readAll(dbufs, threadCount);
+}
+
 /*!
 @brief   Set record number of CompressedVectorNode where next read will start.
 @param   [in] recordNumber   The index of record in ComressedVectorNode where next read using this CompressedVectorReader will start.
@@ -2735,6 +2941,9 @@ unsigned CompressedVectorReader::read(std::vector<SourceDestBuffer>& dbufs)
 This function may be called at any time (as long as ImageFile and CompressedVectorReader are open).
 The next read will start at the given recordNumber.
 It is not an error to seek to recordNumber = childCount() (i.e. to one record past end of CompressedVectorNode).
+If the file has index packets (see CompressedVectorWriterOptions::writeIndex), the seek uses them to find the chunk of data packets holding recordNumber, then decodes forward from the start of that chunk.
+If the file has no index packets, the first seek scans the headers of all data packets of the CompressedVectorNode, and keeps the result for later seeks by any reader of it.
+Fixed size fields (integers and floats) can then start decoding at or just before recordNumber, but string fields must be decoded from the first record.
 
 @pre     @a recordNumber <= childCount() of CompressedVectorNode.
 @pre     The associated ImageFile must be open.
@@ -3252,7 +3461,50 @@ It is an error to call this function if the CompressedVectorNode already has any
 */
 CompressedVectorWriter CompressedVectorNode::writer(std::vector<SourceDestBuffer>& sbufs)
 {
-    return CompressedVectorWriter(impl_->writer(sbufs));
+    return CompressedVectorWriter(impl_->writer(sbufs, CompressedVectorWriterOptions()));
+}
+
+/*!
+@brief   Create an iterator object for writing a CompressedVectorNode, with control over how the bytestreams are encoded.
+@param   [in] sbufs     Vector of memory buffers that will hold data to be written to a CompressedVectorNode.
+@param   [in] options   How the writer is set up, see CompressedVectorWriterOptions.
+@details
+This function is the same as CompressedVectorNode::writer(std::vector<SourceDestBuffer>&), except the bytestreams can be encoded by several threads.
+Each field of the prototype is encoded into its own bytestream, independently of the others, until the bytestreams are assembled into a data packet.
+If CompressedVectorWriterOptions::encoderThreadCount is not 1, the writer starts a pool of threads, and each CompressedVectorWriter::write call encodes the bytestreams for a data packet on the pool.
+This pays off when the prototype has many fields (e.g. cartesian coordinates, intensity, color, row and column indices, time stamps).
+The file written is the same as with a single thread.
+The threads only read the @a sbufs, and only during a call to CompressedVectorWriter::write.
+
+If CompressedVectorWriterOptions::writeIndex is true, the data packets are written in chunks of about eight packets, each starting at a record boundary in every bytestream, and index packets pointing to the chunks are written at the end of the binary section.
+CompressedVectorReader::seek can then start decoding at the chunk holding the record, instead of near it in each bytestream (or at the first record, for strings).
+The last packet of each chunk is usually short, so the file is slightly bigger.
+Versions of this library before 2.0 still read these files, since they stop after the last data packet and never reach the index packets.
+
+@pre     @a sbufs can't be empty (i.e. sbufs.length() > 0).
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre     The @a destImageFile must have been opened in write mode (i.e. destImageFile.isWritable()).
+@pre     The destination ImageFile can't have any readers or writers open (destImageFile().readerCount()==0 && destImageFile().writerCount()==0)
+@pre     This CompressedVectorNode must be attached (i.e. isAttached()).
+@pre     This CompressedVectorNode must have no records (i.e. childCount() == 0).
+@return  A smart CompressedVectorWriter handle referencing the underlying iterator object.
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_FILE_IS_READ_ONLY
+@throw   ::E57_ERROR_SET_TWICE
+@throw   ::E57_ERROR_TOO_MANY_WRITERS
+@throw   ::E57_ERROR_TOO_MANY_READERS
+@throw   ::E57_ERROR_NODE_UNATTACHED
+@throw   ::E57_ERROR_PATH_UNDEFINED
+@throw   ::E57_ERROR_BUFFER_SIZE_MISMATCH
+@throw   ::E57_ERROR_BUFFER_DUPLICATE_PATHNAME
+@throw   ::E57_ERROR_NO_BUFFER_FOR_ELEMENT
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     CompressedVectorNode::writer(std::vector<SourceDestBuffer>&), CompressedVectorWriterOptions
+*/
+CompressedVectorWriter CompressedVectorNode::writer(std::vector<SourceDestBuffer>& sbufs, const CompressedVectorWriterOptions& options)
+{
+    return CompressedVectorWriter(impl_->writer(sbufs, options));
 }
 
 /*!
@@ -3263,14 +3515,20 @@ The pathNames in the @a dbufs must identify terminal nodes (i.e. node that can h
 It is an error for two SourceDestBuffers in @a dbufs to identify the same terminal node in the prototype.
 It is not an error to create a CompressedVectorReader for an empty CompressedVectorNode.
 
+Any number of CompressedVectorReaders may be open on the same ImageFile at the same time (e.g. one per Data3D scan), if the ImageFile was opened in read mode.
+Each CompressedVectorReader may be driven from its own thread, but a single CompressedVectorReader must not be used from two threads at once.
+An ImageFile opened in write mode allows only one CompressedVectorReader at a time, since reading it flushes pending writes to the file.
+
 @pre     @a dbufs can't be empty
 @pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
 @pre     The destination ImageFile can't have any writers open (destImageFile().writerCount()==0)
+@pre     If the destination ImageFile is in write mode, it can't have any readers open (destImageFile().readerCount()==0)
 @pre     This CompressedVectorNode must be attached (i.e. isAttached()).
 @return  A smart CompressedVectorReader handle referencing the underlying iterator object.
 @throw   ::E57_ERROR_BAD_API_ARGUMENT
 @throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
 @throw   ::E57_ERROR_TOO_MANY_WRITERS
+@throw   ::E57_ERROR_TOO_MANY_READERS
 @throw   ::E57_ERROR_NODE_UNATTACHED
 @throw   ::E57_ERROR_PATH_UNDEFINED
 @throw   ::E57_ERROR_BUFFER_SIZE_MISMATCH
@@ -3281,7 +3539,42 @@ It is not an error to create a CompressedVectorReader for an empty CompressedVec
 */
 CompressedVectorReader CompressedVectorNode::reader(const std::vector<SourceDestBuffer>& dbufs)
 {
-    return CompressedVectorReader(impl_->reader(dbufs));
+    return CompressedVectorReader(impl_->reader(dbufs, CompressedVectorReaderOptions()));
+}
+
+/*!
+@brief   Create an iterator object for reading a CompressedVectorNode, with control over how much data it caches.
+@param   [in] dbufs     Vector of memory buffers that will receive data read from a CompressedVectorNode.
+@param   [in] options   How the reader is set up, see CompressedVectorReaderOptions.
+@details
+This function is the same as CompressedVectorNode::reader(const std::vector<SourceDestBuffer>&), except the size of the reader's packet cache can be chosen.
+The cache holds recently read data packets, so that fields of the same record stored in different packets are not read from the file twice.
+A reader whose fields are spread unevenly over the packets, or which seeks back and forth, may benefit from a bigger cache.
+A small cache saves memory when many readers are open at once.
+If CompressedVectorReaderOptions::readAheadPacketCount is non-zero, the reader starts a background thread that reads and checks the packets following the ones being decoded, which hides file latency (e.g. on network drives) behind decoding.
+Readers created by CompressedVectorReader::readAll use the same options.
+
+@pre     @a dbufs can't be empty
+@pre     The destination ImageFile must be open (i.e. destImageFile().isOpen()).
+@pre     The destination ImageFile can't have any writers open (destImageFile().writerCount()==0)
+@pre     If the destination ImageFile is in write mode, it can't have any readers open (destImageFile().readerCount()==0)
+@pre     This CompressedVectorNode must be attached (i.e. isAttached()).
+@return  A smart CompressedVectorReader handle referencing the underlying iterator object.
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_IMAGEFILE_NOT_OPEN
+@throw   ::E57_ERROR_TOO_MANY_WRITERS
+@throw   ::E57_ERROR_TOO_MANY_READERS
+@throw   ::E57_ERROR_NODE_UNATTACHED
+@throw   ::E57_ERROR_PATH_UNDEFINED
+@throw   ::E57_ERROR_BUFFER_SIZE_MISMATCH
+@throw   ::E57_ERROR_BUFFER_DUPLICATE_PATHNAME
+@throw   ::E57_ERROR_BAD_CV_HEADER
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     CompressedVectorNode::reader(const std::vector<SourceDestBuffer>&), CompressedVectorReaderOptions
+*/
+CompressedVectorReader CompressedVectorNode::reader(const std::vector<SourceDestBuffer>& dbufs, const CompressedVectorReaderOptions& options)
+{
+    return CompressedVectorReader(impl_->reader(dbufs, options));
 }
 
 //=====================================================================================
@@ -4542,6 +4835,60 @@ ImageFile::ImageFile(const ustring& fname, const ustring& mode, ReadChecksumPoli
     impl_->construct2(fname, mode);
 }
 
+/*!
+@brief   Open an ASTM E57 imaging data file for reading/writing, with given options.
+@param   [in] fname     File name to open.
+@param   [in] mode      Either "w" for writing or "r" for reading.
+@param   [in] options   How the file is accessed, see ImageFileOptions.
+@details
+Same as ImageFile::ImageFile(const ustring&, const ustring&, ReadChecksumPolicy), with extra choices in @a options.
+
+If ImageFileOptions::memoryMapped is set in read mode, the whole file is mapped into memory.
+Reads then verify checksums and copy data straight out of the mapping, with no system calls.
+If the file can't be mapped (e.g. the platform has no support), the file is read with system calls as usual.
+The file must not be truncated by another process while mapped, the effect of reading the missing part is system dependent.
+ImageFileOptions::memoryMapped is ignored in write mode.
+
+If ImageFileOptions::validateXml is set (the default) in read mode, Xerces validates the XML section only if it names a schema (e.g. with an xsi:schemaLocation attribute), which is what earlier versions did.
+Files written by this library don't name a schema, so they aren't validated, and the option makes no difference for them.
+If ImageFileOptions::validateXml is cleared, no XML section is validated, and no schema it names is loaded.
+The XML must still be well formed, and the E57 element structure and attribute values are still checked as they are read.
+ImageFileOptions::validateXml is ignored in write mode.
+If the library is built with the E57_BUILTIN_XML_PARSER CMake option, the XML section is read by a built-in parser instead of Xerces.
+It checks that the XML is well formed, but never validates against the schema, so ImageFileOptions::validateXml has no effect.
+The XML must be valid UTF-8 holding only characters XML 1.0 allows (character references included), and must not have a document type declaration.
+
+If ImageFileOptions::nodeArena is set in read mode, the nodes read from the XML section are allocated (together with their reference counts) from large blocks of memory, rather than one at a time.
+This makes opening files with hundreds of thousands of nodes faster and takes less memory.
+The blocks are freed when the last of these nodes is destroyed, which may be after the ImageFile is closed if the API user still holds Node handles.
+Nodes created later with the API are allocated as usual.
+ImageFileOptions::nodeArena is ignored in write mode.
+
+@post    Resulting ImageFile is in @c open state if constructor succeeds (no exception thrown).
+@return  A smart ImageFile handle referencing the underlying object.
+@throw   ::E57_ERROR_BAD_API_ARGUMENT
+@throw   ::E57_ERROR_OPEN_FAILED
+@throw   ::E57_ERROR_LSEEK_FAILED
+@throw   ::E57_ERROR_READ_FAILED
+@throw   ::E57_ERROR_WRITE_FAILED
+@throw   ::E57_ERROR_BAD_CHECKSUM
+@throw   ::E57_ERROR_BAD_FILE_SIGNATURE
+@throw   ::E57_ERROR_UNKNOWN_FILE_VERSION
+@throw   ::E57_ERROR_BAD_FILE_LENGTH
+@throw   ::E57_ERROR_XML_PARSER_INIT
+@throw   ::E57_ERROR_XML_PARSER
+@throw   ::E57_ERROR_BAD_XML_FORMAT
+@throw   ::E57_ERROR_BAD_CONFIGURATION
+@throw   ::E57_ERROR_INTERNAL           All objects in undocumented state
+@see     ImageFile::ImageFile(const ustring&, const ustring&, ReadChecksumPolicy), ImageFileOptions
+*/
+ImageFile::ImageFile(const ustring& fname, const ustring& mode, const ImageFileOptions& options)
+: impl_( new ImageFileImpl( options ) )
+{
+    /// Do second phase of construction, now that ImageFile object is complete.
+    impl_->construct2(fname, mode);
+}
+
 /*!
 @brief   Get the pre-established root StructureNode of the E57 ImageFile.
 @details The root node of an ImageFile always exists and is always type StructureNode.
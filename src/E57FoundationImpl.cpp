@@ -27,10 +27,16 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <climits>
 #include <cmath>
+#include <exception>
+#include <limits>
+#include <thread>
 
+#ifndef E57_BUILTIN_XML_PARSER
 #include <xercesc/sax2/XMLReaderFactory.hpp>
 XERCES_CPP_NAMESPACE_USE
+#endif
 
 #include "E57FoundationImpl.h"
 
@@ -171,11 +177,11 @@ ustring NodeImpl::pathName() const
 
         if (p->isRoot())
         {
-            return("/" + elementName_);
+            return("/" + *elementName_);
         }
         else
         {
-            return(p->pathName() + "/" + elementName_);
+            return(p->pathName() + "/" + *elementName_);
         }
     }
 }
@@ -193,9 +199,9 @@ ustring NodeImpl::relativePathName(shared_ptr<NodeImpl> origin, ustring childPat
         /// Assemble relativePathName from right to left, recursively
         shared_ptr<NodeImpl> p(parent_);
         if (childPathName == "")
-            return(p->relativePathName(origin, elementName_));
+            return(p->relativePathName(origin, *elementName_));
         else
-            return(p->relativePathName(origin, elementName_ + "/" + childPathName));
+            return(p->relativePathName(origin, *elementName_ + "/" + childPathName));
     }
 }
 
@@ -203,7 +209,8 @@ ustring NodeImpl::elementName() const
 {
     checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__);
 
-    return elementName_;
+    /// Root and unattached nodes have no element name
+    return elementName_ ? *elementName_ : ustring();
 }
 
 shared_ptr<ImageFileImpl> NodeImpl::destImageFile()
@@ -251,7 +258,7 @@ void NodeImpl::setParent(shared_ptr<NodeImpl> parent, const ustring& elementName
     }
 
     parent_      = parent;
-    elementName_ = elementName;
+    elementName_ = destImageFile()->internElementName(elementName);
 
     /// If parent is attached then we are attached (and all of our children)
     if (parent->isAttached())
@@ -468,7 +475,7 @@ bool NodeImpl::findTerminalPosition(shared_ptr<NodeImpl> target, uint64_t& count
 void NodeImpl::dump(int indent, ostream& os)
 {
     /// don't checkImageFileOpen
-    os << space(indent) << "elementName: " << elementName_ << endl;
+    os << space(indent) << "elementName: " << (elementName_ ? *elementName_ : ustring()) << endl;
     os << space(indent) << "isAttached:  " << isAttached_ << endl;
     os << space(indent) << "path:        " << pathName() << endl;
 }
@@ -570,49 +577,114 @@ shared_ptr<NodeImpl> StructureNodeImpl::get(const ustring& pathName)
     return(ni);
 }
 
+shared_ptr<NodeImpl> StructureNodeImpl::get(NodePathImpl& path)
+{
+    checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__);
+    shared_ptr<NodeImpl> ni(path.lookup(shared_from_this()));
+    if (!ni)
+        throw E57_EXCEPTION2(E57_ERROR_PATH_UNDEFINED, "this->pathName=" + this->pathName() + " pathName=" + path.pathName());
+    return(ni);
+}
+
+bool StructureNodeImpl::isDefined(NodePathImpl& path)
+{
+    checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__);
+    shared_ptr<NodeImpl> ni(path.lookup(shared_from_this()));
+    return(ni != nullptr);
+}
+
 shared_ptr<NodeImpl> StructureNodeImpl::lookup(const ustring& pathName)
 {
     /// don't checkImageFileOpen
-    //??? use lookup(fields, level) instead, for speed.
     bool isRelative;
     vector<ustring> fields;
     shared_ptr<ImageFileImpl> imf(destImageFile_);
     imf->pathNameParse(pathName, isRelative, fields);  // throws if bad pathName
 
-    if (isRelative || isRoot()) {
-        if (fields.size() == 0)
-            if (isRelative) {
-                return(shared_ptr<NodeImpl>());  /// empty pointer
-            } else {
-                shared_ptr<NodeImpl> root(getRoot());
-                return(root);
-            }
-        else {
-            /// Find child with elementName that matches first field in path
-            unsigned i;
-            for (i = 0; i < children_.size(); i++) {
-                if (fields.at(0) == children_.at(i)->elementName())
-                    break;
-            }
-            if (i == children_.size())
-                return(shared_ptr<NodeImpl>());  /// empty pointer
-            if (fields.size() == 1) {
-                return(children_.at(i));
-            } else {
-                //??? use level here rather than unparse
-                /// Remove first field in path
-                fields.erase(fields.begin());
+    if (fields.size() == 0) {
+        if (isRelative)
+            return(shared_ptr<NodeImpl>());  /// empty pointer
+        else
+            return(getRoot());
+    }
 
-                /// Call lookup on child object with remaining fields in path name
-                return(children_.at(i)->lookup(imf->pathNameUnparse(true, fields)));
-            }
+    if (isRelative) {
+        return(lookup(fields, 0));
+    } else {
+        /// Absolute pathname, start at root of the tree (which may be this)
+        return(getRoot()->lookup(fields, 0));
+    }
+}
+
+shared_ptr<NodeImpl> StructureNodeImpl::lookup(const vector<ustring>& fields, unsigned level)
+{
+    /// don't checkImageFileOpen
+
+    /// pathNameParse leaves an empty field for a trailing '/', e.g. "foo/".
+    /// That is a bad path name (not a missing child) once the walk gets to it here.
+    if (fields.at(level).empty())
+        throw E57_EXCEPTION2(E57_ERROR_BAD_PATH_NAME, "this->pathName=" + this->pathName() + " level=" + toString(level));
+
+    /// Find child with elementName that matches field at this level in path
+    size_t i = childIndex(fields.at(level));
+    if (i == children_.size())
+        return(shared_ptr<NodeImpl>());  /// empty pointer
+
+    if (level == fields.size()-1)
+        return(children_[i]);
+
+    /// Call lookup on child object with remaining fields in path name
+    return(children_[i]->lookup(fields, level+1));
+}
+
+size_t StructureNodeImpl::childIndex(const ustring& elementName) const
+{
+    /// Returns children_.size() if no child has elementName
+
+    /// Children of a Vector are named by their index, e.g. "14", so convert back rather than search.
+    /// Only the canonical decimal form can match (no sign, no leading zeros).
+    if (type() == E57_VECTOR) {
+        size_t len = elementName.size();
+        if (len > 0 && len <= 19 && (len == 1 || elementName[0] != '0')) {
+            uint64_t index = 0;
+            size_t j;
+            for (j = 0; j < len && elementName[j] >= '0' && elementName[j] <= '9'; j++)
+                index = 10*index + (elementName[j] - '0');
+            if (j == len && index < children_.size() && *children_[static_cast<size_t>(index)]->elementName_ == elementName)
+                return(static_cast<size_t>(index));
+        }
+        //??? can a Vector child be named other than by its index?  Fall back to serial search to be safe.
+    }
+
+    /// Small Structures (and Vector misses): serial search is as fast as hashing
+    if (!childIndex_) {
+        size_t i;
+        for (i = 0; i < children_.size(); i++) {
+            if (*children_[i]->elementName_ == elementName)
+                break;
         }
-    } else {  /// Absolute pathname and we aren't at the root
-        /// Find root of the tree
-        shared_ptr<NodeImpl> root(getRoot());
+        return(i);
+    }
+
+    unordered_map<ustring, size_t>::const_iterator it = childIndex_->find(elementName);
+    return(it != childIndex_->end() ? it->second : children_.size());
+}
+
+void StructureNodeImpl::addChild(shared_ptr<NodeImpl> ni)
+{
+    /// Caller has already called ni->setParent() with the element name
+    children_.push_back(ni);
 
-        /// Call lookup on root
-        return(root->lookup(pathName));
+    /// Keep index of element names once Structure gets big.  Maintained here (not lazily in lookup) so
+    /// lookups stay read-only and can be done from several CompressedVectorReader threads at once.
+    if (type() == E57_STRUCTURE && children_.size() >= E57_STRUCTURE_INDEX_MIN_CHILDREN) {
+        if (!childIndex_) {
+            childIndex_.reset(new unordered_map<ustring, size_t>());
+            childIndex_->reserve(2*children_.size());
+            for (size_t i = 0; i < children_.size(); i++)
+                (*childIndex_)[*children_[i]->elementName_] = i;
+        } else
+            (*childIndex_)[*ni->elementName_] = children_.size()-1;
     }
 }
 
@@ -645,16 +717,13 @@ void StructureNodeImpl::set(int64_t index64, shared_ptr<NodeImpl> ni)
                              + " ni->destImageFile" + niDest->fileName());
     }
 
-    /// Field name is string version of index value, e.g. "14"
-    stringstream elementName;
-    elementName << index;
-
     /// If this struct is type constrained, can't add new child
     if (isTypeConstrained())
         throw E57_EXCEPTION2(E57_ERROR_HOMOGENEOUS_VIOLATION, "this->pathName=" + this->pathName());
 
-    ni->setParent(shared_from_this(), elementName.str());
-    children_.push_back(ni);
+    /// Field name is string version of index value, e.g. "14"
+    ni->setParent(shared_from_this(), std::to_string(index));
+    addChild(ni);
 }
 
 void StructureNodeImpl::set(const ustring& pathName, shared_ptr<NodeImpl> ni, bool autoPathCreate)
@@ -697,18 +766,17 @@ void StructureNodeImpl::set(const vector<ustring>& fields, unsigned level, share
     if (level == 0 && fields.size() == 0)
         throw E57_EXCEPTION2(E57_ERROR_SET_TWICE, "this->pathName=" + this->pathName() + " element=/");
 
-    /// Serial search for matching field name, if find match, have error since can't set twice
-    for (unsigned i = 0; i < children_.size(); i++) {
-        if (fields.at(level) == children_.at(i)->elementName()) {
-            if (level == fields.size()-1) {
-                /// Enforce "set once" policy, don't allow reset
-                throw E57_EXCEPTION2(E57_ERROR_SET_TWICE, "this->pathName=" + this->pathName() + " element=" + fields[level]);
-            } else {
-                /// Recurse on child
-                children_.at(i)->set(fields, level+1, ni);
-            }
-            return;
+    /// Search for matching field name, if find match, have error since can't set twice
+    size_t i = childIndex(fields.at(level));
+    if (i < children_.size()) {
+        if (level == fields.size()-1) {
+            /// Enforce "set once" policy, don't allow reset
+            throw E57_EXCEPTION2(E57_ERROR_SET_TWICE, "this->pathName=" + this->pathName() + " element=" + fields[level]);
+        } else {
+            /// Recurse on child
+            children_.at(i)->set(fields, level+1, ni);
         }
+        return;
     }
     /// Didn't find matching field name, so have a new child.
 
@@ -720,7 +788,7 @@ void StructureNodeImpl::set(const vector<ustring>& fields, unsigned level, share
     if (level == fields.size()-1){
         /// At bottom, so append node at end of children
         ni->setParent(shared_from_this(), fields.at(level));
-        children_.push_back(ni);
+        addChild(ni);
     } else {
         /// Not at bottom level, if not autoPathCreate have an error
         if (!autoPathCreate) {
@@ -759,7 +827,7 @@ void StructureNodeImpl::checkLeavesInSet(const std::set<ustring>& pathNames, sha
 }
 
 //??? use visitor?
-void StructureNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName)
+void StructureNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName)
 {
     /// don't checkImageFileOpen
 
@@ -767,7 +835,7 @@ void StructureNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile
     if (forcedFieldName != nullptr)
         fieldName = forcedFieldName;
     else
-        fieldName = elementName_;
+        fieldName = *elementName_;
 
     cf << space(indent) << "<" << fieldName << " type=\"Structure\"";
 
@@ -884,7 +952,7 @@ void VectorNodeImpl::set(int64_t index64, shared_ptr<NodeImpl> ni)
     StructureNodeImpl::set(index64, ni);
 }
 
-void VectorNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName)
+void VectorNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName)
 {
     /// don't checkImageFileOpen
 
@@ -892,7 +960,7 @@ void VectorNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& c
     if (forcedFieldName != nullptr)
         fieldName = forcedFieldName;
     else
-        fieldName = elementName_;
+        fieldName = *elementName_;
 
     cf << space(indent) << "<" << fieldName << " type=\"Vector\" allowHeterogeneousChildren=\"" << static_cast<int64_t>(allowHeteroChildren_) << "\">\n";
     for (unsigned i = 0; i < children_.size(); i++)
@@ -914,6 +982,73 @@ void VectorNodeImpl::dump(int indent, ostream& os)
 }
 #endif
 
+//=====================================================================================
+NodePathImpl::NodePathImpl(weak_ptr<ImageFileImpl> destImageFile, const ustring& pathName)
+: destImageFile_(destImageFile), pathName_(pathName), isRelative_(true), cacheNext_(0)
+{
+    shared_ptr<ImageFileImpl> imf(destImageFile);
+    if (!imf->isOpen())
+        throw E57_EXCEPTION2(E57_ERROR_IMAGEFILE_NOT_OPEN, "fileName=" + imf->fileName());
+
+    /// Parse and check the element names once, here, rather than on every lookup
+    imf->pathNameParse(pathName, isRelative_, fields_);  // throws if bad pathName
+}
+
+shared_ptr<NodeImpl> NodePathImpl::lookup(shared_ptr<NodeImpl> origin)
+{
+    /// don't checkImageFileOpen, caller does it
+
+    /// Element name prefixes were checked against the extensions declared in our ImageFile
+    shared_ptr<ImageFileImpl> thisDest(destImageFile());
+    shared_ptr<ImageFileImpl> originDest(origin->destImageFile());
+    if (thisDest != originDest) {
+        throw E57_EXCEPTION2(E57_ERROR_DIFFERENT_DEST_IMAGEFILE,
+                             "this->destImageFile" + thisDest->fileName()
+                             + " origin->destImageFile" + originDest->fileName());
+    }
+
+    /// Absolute path starts at the root of the tree origin is in (which changes if that tree gets attached to another)
+    shared_ptr<NodeImpl> start(isRelative_ ? origin : origin->getRoot());
+    if (fields_.size() == 0)
+        return(start);  /// pathName is "/"
+
+    /// Nodes can't be removed or replaced once set, so a path found from start will always find the same node.
+    /// Only successful lookups are remembered, a missing path may be set later.
+    /// An absolute path always starts at the root, so one entry serves every lookup in the tree.
+    {
+        lock_guard<mutex> lock(cacheMutex_);
+        for (const CacheEntry& entry : cache_) {
+            if (entry.startKey == start.get() && entry.start.lock() == start) {
+                shared_ptr<NodeImpl> ni(entry.node.lock());
+                if (ni)
+                    return(ni);
+            }
+        }
+    }
+
+    shared_ptr<NodeImpl> ni(start->lookup(fields_, 0));
+    if (ni) {
+        lock_guard<mutex> lock(cacheMutex_);
+        CacheEntry& entry = cache_[cacheNext_];
+        cacheNext_ = (cacheNext_ + 1) % E57_NODE_PATH_CACHE_SIZE;
+        entry.startKey = start.get();
+        entry.start    = start;
+        entry.node     = ni;
+    }
+    return(ni);
+}
+
+#ifdef E57_DEBUG
+void NodePathImpl::dump(int indent, ostream& os)
+{
+    /// don't checkImageFileOpen
+    os << space(indent) << "pathName:   " << pathName_ << endl;
+    os << space(indent) << "isRelative: " << isRelative_ << endl;
+    for (unsigned i = 0; i < fields_.size(); i++)
+        os << space(indent) << "field[" << i << "]:   " << fields_.at(i) << endl;
+}
+#endif
+
 //=====================================================================================
 SourceDestBufferImpl::SourceDestBufferImpl(weak_ptr<ImageFileImpl> destImageFile, const ustring pathName, int8_t* base, const size_t capacity, bool doConversion, bool doScaling, size_t stride)
 : destImageFile_(destImageFile), pathName_(pathName), memoryRepresentation_(E57_INT8), base_(reinterpret_cast<char*>(base)),
@@ -1041,653 +1176,688 @@ int64_t SourceDestBufferImpl::getNextInt64()
 {
     /// don't checkImageFileOpen
 
+    /// Conversions are done by the block transfer, so both give the same results
+    int64_t value;
+    getNextBlock(&value, 1);
+    return(value);
+}
+
+int64_t SourceDestBufferImpl::getNextInt64(double scale, double offset)
+{
+    /// don't checkImageFileOpen
+
+    int64_t value;
+    getNextBlock(&value, 1, scale, offset);
+    return(value);
+}
+
+float SourceDestBufferImpl::getNextFloat()
+{
+    /// don't checkImageFileOpen
+
+    float value;
+    getNextBlock(&value, 1);
+    return(value);
+}
+
+double SourceDestBufferImpl::getNextDouble()
+{
+    /// don't checkImageFileOpen
+
+    double value;
+    getNextBlock(&value, 1);
+    return(value);
+}
+
+ustring SourceDestBufferImpl::getNextString()
+{
+    /// don't checkImageFileOpen
+
+    /// Check have correct type buffer
+    if (memoryRepresentation_ != E57_USTRING)
+        throw E57_EXCEPTION2(E57_ERROR_EXPECTING_USTRING, "pathName=" + pathName_);
+
     /// Verify index is within bounds
     if (nextIndex_ >= capacity_)
         throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
 
-    /// Fetch value from source buffer.
-    /// Convert from non-integer formats if requested.
-    char* p = &base_[nextIndex_*stride_];
-    int64_t value;
+    /// Get ustring from vector
+    return((*ustrings_)[nextIndex_++]);
+}
+
+void  SourceDestBufferImpl::setNextInt64(int64_t value)
+{
+    /// don't checkImageFileOpen
+
+    /// Conversions are done by the block transfer, so both give the same results
+    setNextBlock(&value, 1);
+}
+
+void  SourceDestBufferImpl::setNextInt64(int64_t value, double scale, double offset)
+{
+    /// don't checkImageFileOpen
+
+    setNextBlock(&value, 1, scale, offset);
+}
+
+void SourceDestBufferImpl::setNextFloat(float value)
+{
+    /// don't checkImageFileOpen
+
+    setNextBlock(&value, 1);
+}
+
+void SourceDestBufferImpl::setNextDouble(double value)
+{
+    /// don't checkImageFileOpen
+
+    setNextBlock(&value, 1);
+}
+
+void SourceDestBufferImpl::setNextString(const ustring& value)
+{
+    /// don't checkImageFileOpen
+
+    if (memoryRepresentation_ != E57_USTRING)
+        throw E57_EXCEPTION2(E57_ERROR_EXPECTING_USTRING, "pathName=" + pathName_);
+
+    /// Verify have room.
+    if (nextIndex_ >= capacity_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+
+    /// Assign to already initialized element in vector
+    (*ustrings_)[nextIndex_] = value;
+    nextIndex_++;
+}
+
+namespace
+{
+    /// Helpers for the block transfers of SourceDestBufferImpl.
+    /// User's array is addressed through a char pointer and stride, like the per value routines.
+    /// A contiguous array gets its own plain loop, which the compiler can vectorize.
+
+    /// Return number of leading values in strided array that are in [lo, hi].  NaN counts as in range, as in the per value routines.
+    template <typename T>
+    size_t countInRange(const char* p, size_t stride, size_t count, T lo, T hi)
+    {
+        /// Check whole block without an early exit first, the common case is that all are in range
+        bool inRange = true;
+        for (size_t i = 0; i < count; i++) {
+            T value = *reinterpret_cast<const T*>(p + i*stride);
+            inRange &= !(value < lo || hi < value);
+        }
+        if (inRange)
+            return(count);
+
+        size_t n = 0;
+        while (n < count) {
+            T value = *reinterpret_cast<const T*>(p + n*stride);
+            if (value < lo || hi < value)
+                break;
+            n++;
+        }
+        return(n);
+    }
+
+    template <typename DestT, typename SourceT>
+    void loadBlock(const char* p, size_t stride, DestT* values, size_t count)
+    {
+        if (stride == sizeof(SourceT)) {
+            const SourceT* s = reinterpret_cast<const SourceT*>(p);
+            for (size_t i = 0; i < count; i++)
+                values[i] = static_cast<DestT>(s[i]);
+        } else {
+            for (size_t i = 0; i < count; i++)
+                values[i] = static_cast<DestT>(*reinterpret_cast<const SourceT*>(p + i*stride));
+        }
+    }
+
+    template <typename DestT, typename SourceT>
+    void storeBlock(char* p, size_t stride, const SourceT* values, size_t count)
+    {
+        if (stride == sizeof(DestT)) {
+            DestT* d = reinterpret_cast<DestT*>(p);
+            for (size_t i = 0; i < count; i++)
+                d[i] = static_cast<DestT>(values[i]);
+        } else {
+            for (size_t i = 0; i < count; i++)
+                *reinterpret_cast<DestT*>(p + i*stride) = static_cast<DestT>(values[i]);
+        }
+    }
+
+    /// Store to bool array with same mapping as the per value routines
+    template <typename SourceT>
+    void storeBoolBlock(char* p, size_t stride, const SourceT* values, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            *reinterpret_cast<bool*>(p + i*stride) = (values[i] ? false : true);
+    }
+
+    /// Store count values (or fewer, if stop early) checked against [lo, hi], return number stored
+    template <typename DestT, typename SourceT>
+    size_t storeCheckedBlock(char* p, size_t stride, const SourceT* values, size_t count, SourceT lo, SourceT hi)
+    {
+        size_t n = countInRange<SourceT>(reinterpret_cast<const char*>(values), sizeof(SourceT), count, lo, hi);
+        storeBlock<DestT, SourceT>(p, stride, values, n);
+        return(n);
+    }
+
+    /// Store value*scale+offset (rounded to nearest integer if requested), stopping at first result outside [lo, hi].
+    /// Returns number of values stored, the rejected result is put in badValue.
+    template <typename DestT>
+    size_t storeScaledBlock(char* p, size_t stride, const int64_t* values, size_t count, double scale, double offset,
+                            bool round, double lo, double hi, double& badValue)
+    {
+        for (size_t i = 0; i < count; i++) {
+            double scaledValue = values[i]*scale + offset;
+            if (round)
+                scaledValue = floor(scaledValue + 0.5);
+            if (scaledValue < lo || hi < scaledValue) {
+                badValue = scaledValue;
+                return(i);
+            }
+            *reinterpret_cast<DestT*>(p + i*stride) = static_cast<DestT>(scaledValue);
+        }
+        return(count);
+    }
+
+    /// Load (x-offset)/scale rounded to nearest integer, stopping at first result not representable in an int64_t.
+    /// Returns number of values loaded, the rejected result is put in badValue.
+    template <typename SourceT>
+    size_t loadScaledBlock(const char* p, size_t stride, int64_t* values, size_t count, double scale, double offset, double& badValue)
+    {
+        for (size_t i = 0; i < count; i++) {
+            double doubleRawValue = floor((*reinterpret_cast<const SourceT*>(p + i*stride) - offset)/scale + 0.5);
+            if (doubleRawValue < E57_INT64_MIN || E57_INT64_MAX < doubleRawValue) {
+                badValue = doubleRawValue;
+                return(i);
+            }
+            values[i] = static_cast<int64_t>(doubleRawValue);
+        }
+        return(count);
+    }
+}
+
+void SourceDestBufferImpl::getNextBlock(int64_t* values, size_t count)
+{
+    /// don't checkImageFileOpen
+
+    /// Verify block is within bounds
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString(count));
+
+    /// Convert from the memory representation, non-integer ones only if doConversion_
+    const char* p = &base_[nextIndex_*stride_];
     switch (memoryRepresentation_) {
         case E57_INT8:
-            value = static_cast<int64_t>(*reinterpret_cast<int8_t*>(p));
+            loadBlock<int64_t, int8_t>(p, stride_, values, count);
             break;
         case E57_UINT8:
-            value = static_cast<int64_t>(*reinterpret_cast<uint8_t*>(p));
+            loadBlock<int64_t, uint8_t>(p, stride_, values, count);
             break;
         case E57_INT16:
-            value = static_cast<int64_t>(*reinterpret_cast<int16_t*>(p));
+            loadBlock<int64_t, int16_t>(p, stride_, values, count);
             break;
         case E57_UINT16:
-            value = static_cast<int64_t>(*reinterpret_cast<uint16_t*>(p));
+            loadBlock<int64_t, uint16_t>(p, stride_, values, count);
             break;
         case E57_INT32:
-            value = static_cast<int64_t>(*reinterpret_cast<int32_t*>(p));
+            loadBlock<int64_t, int32_t>(p, stride_, values, count);
             break;
         case E57_UINT32:
-            value = static_cast<int64_t>(*reinterpret_cast<uint32_t*>(p));
+            loadBlock<int64_t, uint32_t>(p, stride_, values, count);
             break;
         case E57_INT64:
-            value = *reinterpret_cast<int64_t*>(p);
+            loadBlock<int64_t, int64_t>(p, stride_, values, count);
             break;
         case E57_BOOL:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            /// Convert bool to 0/1, all non-zero values map to 1.0
-            value = (*reinterpret_cast<bool*>(p)) ? 1 : 0;
+            loadBlock<int64_t, bool>(p, stride_, values, count);
             break;
         case E57_REAL32:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
             //??? fault if get special value: NaN, NegInf...
-            value = static_cast<int64_t>(*reinterpret_cast<float*>(p));
+            loadBlock<int64_t, float>(p, stride_, values, count);
             break;
         case E57_REAL64:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
             //??? fault if get special value: NaN, NegInf...
-            value = static_cast<int64_t>(*reinterpret_cast<double*>(p));
+            loadBlock<int64_t, double>(p, stride_, values, count);
             break;
         case E57_USTRING:
             throw E57_EXCEPTION2(E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_);
         default:
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
     }
-    nextIndex_++;
-    return(value);
+    nextIndex_ += count;
 }
 
-int64_t SourceDestBufferImpl::getNextInt64(double scale, double offset)
+void SourceDestBufferImpl::getNextBlock(int64_t* values, size_t count, double scale, double offset)
 {
     /// don't checkImageFileOpen
 
-    /// Reverse scale (undo scaling) of a user's number to get raw value to put in file.
-
-    /// Encorporating the scale is optional (requested by user when constructing the sdbuf).
     /// If the user did not request scaling, then we get raw values from user's buffer.
     if (!doScaling_) {
-        /// Just return raw value.
-        return(getNextInt64());
+        getNextBlock(values, count);
+        return;
     }
 
     /// Double check non-zero scale.  Going to divide by it below.
     if (scale == 0)
         throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
 
-    /// Verify index is within bounds
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+    /// Verify block is within bounds
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString(count));
 
-    /// Fetch value from source buffer.
-    /// Convert from non-integer formats if requested
-    char* p = &base_[nextIndex_*stride_];
-    double doubleRawValue;
+    /// Remove scale and offset, non-integer memory representations only if doConversion_
+    const char* p = &base_[nextIndex_*stride_];
+    double badValue = 0;
+    size_t n;
     switch (memoryRepresentation_) {
         case E57_INT8:
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<int8_t*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<int8_t>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_UINT8:
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<uint8_t*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<uint8_t>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_INT16:
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<int16_t*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<int16_t>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_UINT16:
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<uint16_t*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<uint16_t>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_INT32:
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<int32_t*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<int32_t>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_UINT32:
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<uint32_t*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<uint32_t>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_INT64:
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<int64_t*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<int64_t>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_BOOL:
-            if (*reinterpret_cast<bool*>(p))
-                doubleRawValue = floor((1 - offset)/scale + 0.5);
-            else
-                doubleRawValue = floor((0 - offset)/scale + 0.5);
+            n = loadScaledBlock<bool>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_REAL32:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
             //??? fault if get special value: NaN, NegInf...
-
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<float*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<float>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_REAL64:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
             //??? fault if get special value: NaN, NegInf...
-
-            /// Calc (x-offset)/scale rounded to nearest integer, but keep in floating point until sure is in bounds
-            doubleRawValue = floor((*reinterpret_cast<double*>(p) - offset)/scale + 0.5);
+            n = loadScaledBlock<double>(p, stride_, values, count, scale, offset, badValue);
             break;
         case E57_USTRING:
             throw E57_EXCEPTION2(E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_);
         default:
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
     }
+    nextIndex_ += n;
+
     /// Make sure that value is representable in an int64_t
-    if (doubleRawValue < E57_INT64_MIN || E57_INT64_MAX < doubleRawValue) {
+    if (n < count) {
         throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE,
                              "pathName=" + pathName_
-                             + " value=" + toString(doubleRawValue));
+                             + " value=" + toString(badValue));
     }
-
-    int64_t rawValue = static_cast<int64_t>(doubleRawValue);
-
-    nextIndex_++;
-    return(rawValue);
 }
 
-float SourceDestBufferImpl::getNextFloat()
+void SourceDestBufferImpl::getNextBlock(float* values, size_t count)
 {
     /// don't checkImageFileOpen
 
-    /// Verify index is within bounds
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+    /// Verify block is within bounds
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString(count));
 
-    /// Fetch value from source buffer.
-    /// Convert from other formats to floating point if requested
-    char* p = &base_[nextIndex_*stride_];
-    float value;
+    /// Integer representations need conversion to floating point
+    if (memoryRepresentation_ != E57_REAL32 && memoryRepresentation_ != E57_REAL64 && memoryRepresentation_ != E57_USTRING && !doConversion_)
+        throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
+
+    /// Convert from the memory representation
+    const char* p = &base_[nextIndex_*stride_];
+    size_t n = count;
     switch (memoryRepresentation_) {
         case E57_INT8:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<float>(*reinterpret_cast<int8_t*>(p));
+            loadBlock<float, int8_t>(p, stride_, values, count);
             break;
         case E57_UINT8:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<float>(*reinterpret_cast<uint8_t*>(p));
+            loadBlock<float, uint8_t>(p, stride_, values, count);
             break;
         case E57_INT16:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<float>(*reinterpret_cast<int16_t*>(p));
+            loadBlock<float, int16_t>(p, stride_, values, count);
             break;
         case E57_UINT16:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<float>(*reinterpret_cast<uint16_t*>(p));
+            loadBlock<float, uint16_t>(p, stride_, values, count);
             break;
         case E57_INT32:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<float>(*reinterpret_cast<int32_t*>(p));
+            loadBlock<float, int32_t>(p, stride_, values, count);
             break;
         case E57_UINT32:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<float>(*reinterpret_cast<uint32_t*>(p));
+            loadBlock<float, uint32_t>(p, stride_, values, count);
             break;
         case E57_INT64:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<float>(*reinterpret_cast<int64_t*>(p));
+            loadBlock<float, int64_t>(p, stride_, values, count);
             break;
         case E57_BOOL:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-
-            /// Convert bool to 0/1, all non-zero values map to 1.0
-            value = (*reinterpret_cast<bool*>(p)) ? 1.0F : 0.0F;
+            loadBlock<float, bool>(p, stride_, values, count);
             break;
         case E57_REAL32:
-            value = *reinterpret_cast<float*>(p);
+            loadBlock<float, float>(p, stride_, values, count);
             break;
-        case E57_REAL64: {
+        case E57_REAL64:
             /// Check that exponent of user's value is not too large for single precision number in file.
-            double d = *reinterpret_cast<double*>(p);
-
-            ///??? silently limit here?
-            if (d < E57_DOUBLE_MIN || E57_DOUBLE_MAX < d)
-                throw E57_EXCEPTION2(E57_ERROR_REAL64_TOO_LARGE, "pathName=" + pathName_ + " value=" + toString(d));
-            value = static_cast<float>(d);
+            n = countInRange<double>(p, stride_, count, E57_DOUBLE_MIN, E57_DOUBLE_MAX);
+            loadBlock<float, double>(p, stride_, values, n);
             break;
-        }
         case E57_USTRING:
             throw E57_EXCEPTION2(E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_);
         default:
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
     }
-    nextIndex_++;
-    return(value);
+    nextIndex_ += n;
+
+    if (n < count) {
+        throw E57_EXCEPTION2(E57_ERROR_REAL64_TOO_LARGE,
+                             "pathName=" + pathName_
+                             + " value=" + toString(*reinterpret_cast<const double*>(p + n*stride_)));
+    }
 }
 
-double SourceDestBufferImpl::getNextDouble()
+void SourceDestBufferImpl::getNextBlock(double* values, size_t count)
 {
     /// don't checkImageFileOpen
 
-    /// Verify index is within bounds
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+    /// Verify block is within bounds
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString(count));
 
-    /// Fetch value from source buffer.
-    /// Convert from other formats to floating point if requested
-    char* p = &base_[nextIndex_*stride_];
-    double value;
+    /// Integer representations need conversion to floating point
+    if (memoryRepresentation_ != E57_REAL32 && memoryRepresentation_ != E57_REAL64 && memoryRepresentation_ != E57_USTRING && !doConversion_)
+        throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
+
+    /// Convert from the memory representation
+    const char* p = &base_[nextIndex_*stride_];
     switch (memoryRepresentation_) {
         case E57_INT8:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<double>(*reinterpret_cast<int8_t*>(p));
+            loadBlock<double, int8_t>(p, stride_, values, count);
             break;
         case E57_UINT8:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<double>(*reinterpret_cast<uint8_t*>(p));
+            loadBlock<double, uint8_t>(p, stride_, values, count);
             break;
         case E57_INT16:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<double>(*reinterpret_cast<int16_t*>(p));
+            loadBlock<double, int16_t>(p, stride_, values, count);
             break;
         case E57_UINT16:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<double>(*reinterpret_cast<uint16_t*>(p));
+            loadBlock<double, uint16_t>(p, stride_, values, count);
             break;
         case E57_INT32:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<double>(*reinterpret_cast<int32_t*>(p));
+            loadBlock<double, int32_t>(p, stride_, values, count);
             break;
         case E57_UINT32:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<double>(*reinterpret_cast<uint32_t*>(p));
+            loadBlock<double, uint32_t>(p, stride_, values, count);
             break;
         case E57_INT64:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            value = static_cast<double>(*reinterpret_cast<int64_t*>(p));
+            loadBlock<double, int64_t>(p, stride_, values, count);
             break;
         case E57_BOOL:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            /// Convert bool to 0/1, all non-zero values map to 1.0
-            value = (*reinterpret_cast<bool*>(p)) ? 1.0 : 0.0;
+            loadBlock<double, bool>(p, stride_, values, count);
             break;
         case E57_REAL32:
-            value = static_cast<double>(*reinterpret_cast<float*>(p));
+            loadBlock<double, float>(p, stride_, values, count);
             break;
         case E57_REAL64:
-            value = *reinterpret_cast<double*>(p);
+            loadBlock<double, double>(p, stride_, values, count);
             break;
         case E57_USTRING:
             throw E57_EXCEPTION2(E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_);
         default:
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
     }
-    nextIndex_++;
-    return(value);
-}
-
-ustring SourceDestBufferImpl::getNextString()
-{
-    /// don't checkImageFileOpen
-
-    /// Check have correct type buffer
-    if (memoryRepresentation_ != E57_USTRING)
-        throw E57_EXCEPTION2(E57_ERROR_EXPECTING_USTRING, "pathName=" + pathName_);
-
-    /// Verify index is within bounds
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
-
-    /// Get ustring from vector
-    return((*ustrings_)[nextIndex_++]);
+    nextIndex_ += count;
 }
 
-void  SourceDestBufferImpl::setNextInt64(int64_t value)
+void SourceDestBufferImpl::setNextBlock(const int64_t* values, size_t count)
 {
     /// don't checkImageFileOpen
 
     /// Verify have room
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString(count));
 
-    /// Calc start of memory location, index into buffer using stride_ (the distance between elements).
+    /// Convert to the memory representation, non-integer ones only if doConversion_.  Values before one that isn't representable are still stored.
     char* p = &base_[nextIndex_*stride_];
-
+    size_t n = count;
     switch (memoryRepresentation_) {
         case E57_INT8:
-            if (value < E57_INT8_MIN || E57_INT8_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int8_t*>(p) = static_cast<int8_t>(value);
+            n = storeCheckedBlock<int8_t, int64_t>(p, stride_, values, count, E57_INT8_MIN, E57_INT8_MAX);
             break;
         case E57_UINT8:
-            if (value < E57_UINT8_MIN || E57_UINT8_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint8_t*>(p) = static_cast<uint8_t>(value);
+            n = storeCheckedBlock<uint8_t, int64_t>(p, stride_, values, count, E57_UINT8_MIN, E57_UINT8_MAX);
             break;
         case E57_INT16:
-            if (value < E57_INT16_MIN || E57_INT16_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int16_t*>(p) = static_cast<int16_t>(value);
+            n = storeCheckedBlock<int16_t, int64_t>(p, stride_, values, count, E57_INT16_MIN, E57_INT16_MAX);
             break;
         case E57_UINT16:
-            if (value < E57_UINT16_MIN || E57_UINT16_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint16_t*>(p) = static_cast<uint16_t>(value);
+            n = storeCheckedBlock<uint16_t, int64_t>(p, stride_, values, count, E57_UINT16_MIN, E57_UINT16_MAX);
             break;
         case E57_INT32:
-            if (value < E57_INT32_MIN || E57_INT32_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int32_t*>(p) = static_cast<int32_t>(value);
+            n = storeCheckedBlock<int32_t, int64_t>(p, stride_, values, count, E57_INT32_MIN, E57_INT32_MAX);
             break;
         case E57_UINT32:
-            if (value < E57_UINT32_MIN || E57_UINT32_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint32_t*>(p) = static_cast<uint32_t>(value);
+            n = storeCheckedBlock<uint32_t, int64_t>(p, stride_, values, count, E57_UINT32_MIN, E57_UINT32_MAX);
             break;
         case E57_INT64:
-            *reinterpret_cast<int64_t*>(p) = static_cast<int64_t>(value);
+            storeBlock<int64_t, int64_t>(p, stride_, values, count);
             break;
         case E57_BOOL:
-            *reinterpret_cast<bool*>(p) = (value ? false : true);
+            storeBoolBlock<int64_t>(p, stride_, values, count);
             break;
         case E57_REAL32:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
             //??? very large integers may lose some lowest bits here. error?
-            *reinterpret_cast<float*>(p) = static_cast<float>(value);
+            storeBlock<float, int64_t>(p, stride_, values, count);
             break;
         case E57_REAL64:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            *reinterpret_cast<double*>(p) = static_cast<double>(value);
+            storeBlock<double, int64_t>(p, stride_, values, count);
             break;
         case E57_USTRING:
             throw E57_EXCEPTION2(E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_);
     }
+    nextIndex_ += n;
 
-    nextIndex_++;
+    if (n < count)
+        throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(values[n]));
 }
 
-void  SourceDestBufferImpl::setNextInt64(int64_t value, double scale, double offset)
+void SourceDestBufferImpl::setNextBlock(const int64_t* values, size_t count, double scale, double offset)
 {
     /// don't checkImageFileOpen
 
-    /// Apply a scale and offset to numbers from file before puting in user's buffer.
-
-    /// Encorporating the scale is optional (requested by user when constructing the sdbuf).
     /// If the user did not request scaling, then we send raw values to user's buffer.
     if (!doScaling_) {
-        /// Use raw value routine, then bail out.
-        setNextInt64(value);
+        setNextBlock(values, count);
         return;
     }
 
     /// Verify have room
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString(count));
 
-    /// Calc start of memory location, index into buffer using stride_ (the distance between elements).
+    /// Apply scale and offset, then convert to the memory representation.
+    /// Results going to integer representations are rounded to nearest integer, and checked before they are stored.
+    const double noLimit = numeric_limits<double>::infinity();
     char* p = &base_[nextIndex_*stride_];
-
-    /// Calc x*scale+offset
-    double scaledValue;
-    if (memoryRepresentation_ == E57_REAL32 || memoryRepresentation_ == E57_REAL64) {
-        /// Value will be stored in some floating point rep in user's buffer, so keep full resolution here.
-        scaledValue = value*scale + offset;
-    } else {
-        /// Value will represented as some integer in user's buffer, so round to nearest integer here.
-        /// But keep in floating point rep until we know that the value is representable in the user's buffer.
-        scaledValue = floor(value*scale + offset + 0.5);
-    }
-
+    double badValue = 0;
+    size_t n = count;
     switch (memoryRepresentation_) {
         case E57_INT8:
-            if (scaledValue < E57_INT8_MIN || E57_INT8_MAX < scaledValue)
-                throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " scaledValue=" + toString(scaledValue));
-            *reinterpret_cast<int8_t*>(p) = static_cast<int8_t>(scaledValue);
+            n = storeScaledBlock<int8_t>(p, stride_, values, count, scale, offset, true, E57_INT8_MIN, E57_INT8_MAX, badValue);
             break;
         case E57_UINT8:
-            if (scaledValue < E57_UINT8_MIN || E57_UINT8_MAX < scaledValue)
-                throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " scaledValue=" + toString(scaledValue));
-            *reinterpret_cast<uint8_t*>(p) = static_cast<uint8_t>(scaledValue);
+            n = storeScaledBlock<uint8_t>(p, stride_, values, count, scale, offset, true, E57_UINT8_MIN, E57_UINT8_MAX, badValue);
             break;
         case E57_INT16:
-            if (scaledValue < E57_INT16_MIN || E57_INT16_MAX < scaledValue)
-                throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " scaledValue=" + toString(scaledValue));
-            *reinterpret_cast<int16_t*>(p) = static_cast<int16_t>(scaledValue);
+            n = storeScaledBlock<int16_t>(p, stride_, values, count, scale, offset, true, E57_INT16_MIN, E57_INT16_MAX, badValue);
             break;
         case E57_UINT16:
-            if (scaledValue < E57_UINT16_MIN || E57_UINT16_MAX < scaledValue)
-                throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " scaledValue=" + toString(scaledValue));
-            *reinterpret_cast<uint16_t*>(p) = static_cast<uint16_t>(scaledValue);
+            n = storeScaledBlock<uint16_t>(p, stride_, values, count, scale, offset, true, E57_UINT16_MIN, E57_UINT16_MAX, badValue);
             break;
         case E57_INT32:
-            if (scaledValue < E57_INT32_MIN || E57_INT32_MAX < scaledValue)
-                throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " scaledValue=" + toString(scaledValue));
-            *reinterpret_cast<int32_t*>(p) = static_cast<int32_t>(scaledValue);
+            n = storeScaledBlock<int32_t>(p, stride_, values, count, scale, offset, true, E57_INT32_MIN, E57_INT32_MAX, badValue);
             break;
         case E57_UINT32:
-            if (scaledValue < E57_UINT32_MIN || E57_UINT32_MAX < scaledValue)
-                throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " scaledValue=" + toString(scaledValue));
-            *reinterpret_cast<uint32_t*>(p) = static_cast<uint32_t>(scaledValue);
+            n = storeScaledBlock<uint32_t>(p, stride_, values, count, scale, offset, true, E57_UINT32_MIN, E57_UINT32_MAX, badValue);
             break;
         case E57_INT64:
-            *reinterpret_cast<int64_t*>(p) = static_cast<int64_t>(scaledValue);
+            n = storeScaledBlock<int64_t>(p, stride_, values, count, scale, offset, true, -noLimit, noLimit, badValue);
             break;
         case E57_BOOL:
-            *reinterpret_cast<bool*>(p) = (scaledValue ? false : true);
+            for (size_t i = 0; i < count; i++)
+                *reinterpret_cast<bool*>(p + i*stride_) = (floor(values[i]*scale + offset + 0.5) ? false : true);
             break;
         case E57_REAL32:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
             /// Check that exponent of result is not too big for single precision float
-            if (scaledValue < E57_DOUBLE_MIN || E57_DOUBLE_MAX < scaledValue)
-                throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " scaledValue=" + toString(scaledValue));
-            *reinterpret_cast<float*>(p) = static_cast<float>(scaledValue);
+            n = storeScaledBlock<float>(p, stride_, values, count, scale, offset, false, E57_DOUBLE_MIN, E57_DOUBLE_MAX, badValue);
             break;
         case E57_REAL64:
             if (!doConversion_)
                 throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            *reinterpret_cast<double*>(p) = scaledValue;
+            n = storeScaledBlock<double>(p, stride_, values, count, scale, offset, false, -noLimit, noLimit, badValue);
             break;
         case E57_USTRING:
             throw E57_EXCEPTION2(E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_);
     }
+    nextIndex_ += n;
 
-    nextIndex_++;
+    if (n < count)
+        throw E57_EXCEPTION2(E57_ERROR_SCALED_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " scaledValue=" + toString(badValue));
 }
 
-void SourceDestBufferImpl::setNextFloat(float value)
+void SourceDestBufferImpl::setNextBlock(const float* values, size_t count)
 {
     /// don't checkImageFileOpen
 
     /// Verify have room
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString(count));
 
-    /// Calc start of memory location, index into buffer using stride_ (the distance between elements).
-    char* p = &base_[nextIndex_*stride_];
+    /// Integer representations need conversion from floating point
+    if (memoryRepresentation_ != E57_REAL32 && memoryRepresentation_ != E57_REAL64 && memoryRepresentation_ != E57_USTRING && !doConversion_)
+        throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
 
+    /// Convert to the memory representation, integer ones only if doConversion_.  Values before one that isn't representable are still stored.
+    char* p = &base_[nextIndex_*stride_];
+    size_t n = count;
     switch (memoryRepresentation_) {
         case E57_INT8:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
             //??? fault if get special value: NaN, NegInf...  (all other ints below too)
-            if (value < E57_INT8_MIN || E57_INT8_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int8_t*>(p) = static_cast<int8_t>(value);
+            n = storeCheckedBlock<int8_t, float>(p, stride_, values, count, E57_INT8_MIN, E57_INT8_MAX);
             break;
         case E57_UINT8:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_UINT8_MIN || E57_UINT8_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint8_t*>(p) = static_cast<uint8_t>(value);
+            n = storeCheckedBlock<uint8_t, float>(p, stride_, values, count, E57_UINT8_MIN, E57_UINT8_MAX);
             break;
         case E57_INT16:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_INT16_MIN || E57_INT16_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int16_t*>(p) = static_cast<int16_t>(value);
+            n = storeCheckedBlock<int16_t, float>(p, stride_, values, count, E57_INT16_MIN, E57_INT16_MAX);
             break;
         case E57_UINT16:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_UINT16_MIN || E57_UINT16_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint16_t*>(p) = static_cast<uint16_t>(value);
+            n = storeCheckedBlock<uint16_t, float>(p, stride_, values, count, E57_UINT16_MIN, E57_UINT16_MAX);
             break;
         case E57_INT32:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_INT32_MIN || E57_INT32_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int32_t*>(p) = static_cast<int32_t>(value);
+            n = storeCheckedBlock<int32_t, float>(p, stride_, values, count, E57_INT32_MIN, E57_INT32_MAX);
             break;
         case E57_UINT32:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_UINT32_MIN || E57_UINT32_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint32_t*>(p) = static_cast<uint32_t>(value);
+            n = storeCheckedBlock<uint32_t, float>(p, stride_, values, count, E57_UINT32_MIN, E57_UINT32_MAX);
             break;
         case E57_INT64:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_INT64_MIN || E57_INT64_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int64_t*>(p) = static_cast<int64_t>(value);
+            n = storeCheckedBlock<int64_t, float>(p, stride_, values, count, E57_INT64_MIN, E57_INT64_MAX);
             break;
         case E57_BOOL:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            *reinterpret_cast<bool*>(p) = (value ? false : true);
+            storeBoolBlock<float>(p, stride_, values, count);
             break;
         case E57_REAL32:
-            *reinterpret_cast<float*>(p) = value;
+            storeBlock<float, float>(p, stride_, values, count);
             break;
         case E57_REAL64:
             //??? does this count as a conversion?
-            *reinterpret_cast<double*>(p) = static_cast<double>(value);
+            storeBlock<double, float>(p, stride_, values, count);
             break;
         case E57_USTRING:
             throw E57_EXCEPTION2(E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_);
     }
+    nextIndex_ += n;
 
-    nextIndex_++;
+    if (n < count)
+        throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(values[n]));
 }
 
-void SourceDestBufferImpl::setNextDouble(double value)
+void SourceDestBufferImpl::setNextBlock(const double* values, size_t count)
 {
     /// don't checkImageFileOpen
 
     /// Verify have room
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
+    if (count > capacity_ - nextIndex_)
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_ + " count=" + toString(count));
 
-    /// Calc start of memory location, index into buffer using stride_ (the distance between elements).
-    char* p = &base_[nextIndex_*stride_];
+    /// Integer representations need conversion from floating point
+    if (memoryRepresentation_ != E57_REAL32 && memoryRepresentation_ != E57_REAL64 && memoryRepresentation_ != E57_USTRING && !doConversion_)
+        throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
 
+    /// Convert to the memory representation, integer ones only if doConversion_.  Values before one that isn't representable are still stored.
+    char* p = &base_[nextIndex_*stride_];
+    size_t n = count;
     switch (memoryRepresentation_) {
         case E57_INT8:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
             //??? fault if get special value: NaN, NegInf...  (all other ints below too)
-            if (value < E57_INT8_MIN || E57_INT8_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int8_t*>(p) = static_cast<int8_t>(value);
+            n = storeCheckedBlock<int8_t, double>(p, stride_, values, count, E57_INT8_MIN, E57_INT8_MAX);
             break;
         case E57_UINT8:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_UINT8_MIN || E57_UINT8_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint8_t*>(p) = static_cast<uint8_t>(value);
+            n = storeCheckedBlock<uint8_t, double>(p, stride_, values, count, E57_UINT8_MIN, E57_UINT8_MAX);
             break;
         case E57_INT16:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_INT16_MIN || E57_INT16_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int16_t*>(p) = static_cast<int16_t>(value);
+            n = storeCheckedBlock<int16_t, double>(p, stride_, values, count, E57_INT16_MIN, E57_INT16_MAX);
             break;
         case E57_UINT16:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_UINT16_MIN || E57_UINT16_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint16_t*>(p) = static_cast<uint16_t>(value);
+            n = storeCheckedBlock<uint16_t, double>(p, stride_, values, count, E57_UINT16_MIN, E57_UINT16_MAX);
             break;
         case E57_INT32:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_INT32_MIN || E57_INT32_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int32_t*>(p) = static_cast<int32_t>(value);
+            n = storeCheckedBlock<int32_t, double>(p, stride_, values, count, E57_INT32_MIN, E57_INT32_MAX);
             break;
         case E57_UINT32:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_UINT32_MIN || E57_UINT32_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<uint32_t*>(p) = static_cast<uint32_t>(value);
+            n = storeCheckedBlock<uint32_t, double>(p, stride_, values, count, E57_UINT32_MIN, E57_UINT32_MAX);
             break;
         case E57_INT64:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            if (value < E57_INT64_MIN || E57_INT64_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<int64_t*>(p) = static_cast<int64_t>(value);
+            n = storeCheckedBlock<int64_t, double>(p, stride_, values, count, E57_INT64_MIN, E57_INT64_MAX);
             break;
         case E57_BOOL:
-            if (!doConversion_)
-                throw E57_EXCEPTION2(E57_ERROR_CONVERSION_REQUIRED, "pathName=" + pathName_);
-            *reinterpret_cast<bool*>(p) = (value ? false : true);
+            storeBoolBlock<double>(p, stride_, values, count);
             break;
         case E57_REAL32:
-            /// Does this count as conversion?  It loses information.
             /// Check for really large exponents that can't fit in a single precision
-            if (value < E57_DOUBLE_MIN || E57_DOUBLE_MAX < value)
-                throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(value));
-            *reinterpret_cast<float*>(p) = static_cast<float>(value);
+            n = storeCheckedBlock<float, double>(p, stride_, values, count, E57_DOUBLE_MIN, E57_DOUBLE_MAX);
             break;
         case E57_REAL64:
-            *reinterpret_cast<double*>(p) = value;
+            storeBlock<double, double>(p, stride_, values, count);
             break;
         case E57_USTRING:
             throw E57_EXCEPTION2(E57_ERROR_EXPECTING_NUMERIC, "pathName=" + pathName_);
     }
+    nextIndex_ += n;
 
-    nextIndex_++;
-}
-
-void SourceDestBufferImpl::setNextString(const ustring& value)
-{
-    /// don't checkImageFileOpen
-
-    if (memoryRepresentation_ != E57_USTRING)
-        throw E57_EXCEPTION2(E57_ERROR_EXPECTING_USTRING, "pathName=" + pathName_);
-
-    /// Verify have room.
-    if (nextIndex_ >= capacity_)
-        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName_);
-
-    /// Assign to already initialized element in vector
-    (*ustrings_)[nextIndex_] = value;
-    nextIndex_++;
+    if (n < count)
+        throw E57_EXCEPTION2(E57_ERROR_VALUE_NOT_REPRESENTABLE, "pathName=" + pathName_ + " value=" + toString(values[n]));
 }
 
 void SourceDestBufferImpl::checkCompatible(shared_ptr<SourceDestBufferImpl> newBuf) const
@@ -1724,6 +1894,25 @@ void SourceDestBufferImpl::checkCompatible(shared_ptr<SourceDestBufferImpl> newB
     }
 }
 
+shared_ptr<SourceDestBufferImpl> SourceDestBufferImpl::slice(size_t firstIndex, size_t count) const
+{
+    /// Only fixed size elements can be addressed by index
+    if (memoryRepresentation_ == E57_USTRING || firstIndex > capacity_ || count > capacity_ - firstIndex) {
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
+                             "pathName=" + pathName_
+                             + " firstIndex=" + toString(firstIndex)
+                             + " count=" + toString(count)
+                             + " capacity=" + toString(capacity_));
+    }
+
+    /// Same buffer description, but starting at element firstIndex and holding count elements
+    shared_ptr<SourceDestBufferImpl> s(new SourceDestBufferImpl(*this));
+    s->base_        = &base_[firstIndex*stride_];
+    s->capacity_    = count;
+    s->nextIndex_   = 0;
+    return(s);
+}
+
 #ifdef E57_DEBUG
 void SourceDestBufferImpl::dump(int indent, ostream& os)
 {
@@ -1911,7 +2100,7 @@ void CompressedVectorNodeImpl::checkLeavesInSet(const std::set<ustring>& /*pathN
     throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "this->pathName=" + this->pathName());
 }
 
-void CompressedVectorNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName)
+void CompressedVectorNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName)
 {
     // don't checkImageFileOpen
 
@@ -1919,9 +2108,9 @@ void CompressedVectorNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> imf, Chec
     if (forcedFieldName != nullptr)
         fieldName = forcedFieldName;
     else
-        fieldName = elementName_;
+        fieldName = *elementName_;
 
-    uint64_t physicalStart = cf.logicalToPhysical(binarySectionLogicalStart_);
+    uint64_t physicalStart = CheckedFile::logicalToPhysical(binarySectionLogicalStart_);
 
     cf << space(indent) << "<" << fieldName << " type=\"CompressedVector\"";
     cf << " fileOffset=\"" << physicalStart;
@@ -1954,7 +2143,7 @@ void CompressedVectorNodeImpl::dump(int indent, ostream& os)
 }
 #endif
 
-shared_ptr<CompressedVectorWriterImpl> CompressedVectorNodeImpl::writer(vector<SourceDestBuffer> sbufs)
+shared_ptr<CompressedVectorWriterImpl> CompressedVectorNodeImpl::writer(vector<SourceDestBuffer> sbufs, const CompressedVectorWriterOptions& options)
 {
     checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__);
 
@@ -1993,24 +2182,28 @@ shared_ptr<CompressedVectorWriterImpl> CompressedVectorNodeImpl::writer(vector<S
         throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "this->elementName=" + this->elementName() + " elementName=" + ni->elementName());
 
     /// Return a shared_ptr to new object
-    shared_ptr<CompressedVectorWriterImpl> cvwi(new CompressedVectorWriterImpl(cai, sbufs));
+    shared_ptr<CompressedVectorWriterImpl> cvwi(new CompressedVectorWriterImpl(cai, sbufs, options));
     return(cvwi);
 }
 
-shared_ptr<CompressedVectorReaderImpl> CompressedVectorNodeImpl::reader(vector<SourceDestBuffer> dbufs)
+shared_ptr<CompressedVectorReaderImpl> CompressedVectorNodeImpl::reader(vector<SourceDestBuffer> dbufs, const CompressedVectorReaderOptions& options)
 {
     checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__);
 
     shared_ptr<ImageFileImpl> destImageFile(destImageFile_);
 
-    /// Check don't have any writers/readers open for this ImageFile
+    /// Check don't have any writers open for this ImageFile.
+    /// Any number of readers may be open at once, they only share the file through CheckedFile::readAt().
     if (destImageFile->writerCount() > 0) {
         throw E57_EXCEPTION2(E57_ERROR_TOO_MANY_WRITERS,
                              "fileName=" + destImageFile->fileName()
                              + " writerCount=" + toString(destImageFile->writerCount())
                              + " readerCount=" + toString(destImageFile->readerCount()));
     }
-    if (destImageFile->readerCount() > 0) {
+
+    /// Reading a file being written first flushes its pending write page (see CheckedFile::readLogical), which isn't thread safe.
+    /// So a write mode ImageFile only allows one reader at a time, as before.
+    if (destImageFile->isWriter() && destImageFile->readerCount() > 0) {
         throw E57_EXCEPTION2(E57_ERROR_TOO_MANY_READERS,
                              "fileName=" + destImageFile->fileName()
                              + " writerCount=" + toString(destImageFile->writerCount())
@@ -2041,7 +2234,7 @@ shared_ptr<CompressedVectorReaderImpl> CompressedVectorNodeImpl::reader(vector<S
     //cai->dump(4);
 #endif
     /// Return a shared_ptr to new object
-    shared_ptr<CompressedVectorReaderImpl> cvri(new CompressedVectorReaderImpl(cai, dbufs));
+    shared_ptr<CompressedVectorReaderImpl> cvri(new CompressedVectorReaderImpl(cai, dbufs, options));
     return(cvri);
 }
 
@@ -2132,7 +2325,7 @@ void IntegerNodeImpl::checkLeavesInSet(const std::set<ustring>& pathNames, share
         throw E57_EXCEPTION2(E57_ERROR_NO_BUFFER_FOR_ELEMENT, "this->pathName=" + this->pathName());
 }
 
-void IntegerNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf???*/, CheckedFile& cf, int indent, const char* forcedFieldName)
+void IntegerNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf???*/, BufferedWriter& cf, int indent, const char* forcedFieldName)
 {
     // don't checkImageFileOpen
 
@@ -2140,7 +2333,7 @@ void IntegerNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf???*/, Checke
     if (forcedFieldName != nullptr)
         fieldName = forcedFieldName;
     else
-        fieldName = elementName_;
+        fieldName = *elementName_;
 
     cf << space(indent) << "<" << fieldName << " type=\"Integer\"";
 
@@ -2313,7 +2506,7 @@ void ScaledIntegerNodeImpl::checkLeavesInSet(const std::set<ustring>& pathNames,
         throw E57_EXCEPTION2(E57_ERROR_NO_BUFFER_FOR_ELEMENT, "this->pathName=" + this->pathName());
 }
 
-void ScaledIntegerNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, CheckedFile& cf, int indent, const char* forcedFieldName)
+void ScaledIntegerNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, BufferedWriter& cf, int indent, const char* forcedFieldName)
 {
     // don't checkImageFileOpen
 
@@ -2321,7 +2514,7 @@ void ScaledIntegerNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, Che
     if (forcedFieldName != nullptr)
         fieldName = forcedFieldName;
     else
-        fieldName = elementName_;
+        fieldName = *elementName_;
 
     cf << space(indent) << "<" << fieldName << " type=\"ScaledInteger\"";
 
@@ -2464,7 +2657,7 @@ void FloatNodeImpl::checkLeavesInSet(const std::set<ustring>& pathNames, shared_
         throw E57_EXCEPTION2(E57_ERROR_NO_BUFFER_FOR_ELEMENT, "this->pathName=" + this->pathName());
 }
 
-void FloatNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, CheckedFile& cf, int indent, const char* forcedFieldName)
+void FloatNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, BufferedWriter& cf, int indent, const char* forcedFieldName)
 {
     // don't checkImageFileOpen
 
@@ -2472,7 +2665,7 @@ void FloatNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, CheckedFile
     if (forcedFieldName != nullptr)
         fieldName = forcedFieldName;
     else
-        fieldName = elementName_;
+        fieldName = *elementName_;
 
     cf << space(indent) << "<" << fieldName << " type=\"Float\"";
     if (precision_ == E57_SINGLE) {
@@ -2584,7 +2777,7 @@ void StringNodeImpl::checkLeavesInSet(const std::set<ustring>& pathNames, shared
         throw E57_EXCEPTION2(E57_ERROR_NO_BUFFER_FOR_ELEMENT, "this->pathName=" + this->pathName());
 }
 
-void StringNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, CheckedFile& cf, int indent, const char* forcedFieldName)
+void StringNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, BufferedWriter& cf, int indent, const char* forcedFieldName)
 {
     // don't checkImageFileOpen
 
@@ -2592,7 +2785,7 @@ void StringNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, CheckedFil
     if (forcedFieldName != nullptr)
         fieldName = forcedFieldName;
     else
-        fieldName = elementName_;
+        fieldName = *elementName_;
 
     cf << space(indent) << "<" << fieldName << " type=\"String\"";
 
@@ -2743,8 +2936,8 @@ void BlobNodeImpl::read(uint8_t* buf, int64_t start, size_t count)
                              + " length=" + toString(blobLogicalLength_));
     }
     shared_ptr<ImageFileImpl> imf(destImageFile_);
-    imf->file_->seek(binarySectionLogicalStart_ + sizeof(BlobSectionHeader) + start);
-    imf->file_->read(reinterpret_cast<char*>(buf), static_cast<size_t>(count));  //??? arg1 void* ?
+    imf->file_->readAt(binarySectionLogicalStart_ + sizeof(BlobSectionHeader) + start,
+                       reinterpret_cast<char*>(buf), static_cast<size_t>(count));  //??? arg1 void* ?
 }
 
 void BlobNodeImpl::write(uint8_t* buf, int64_t start, size_t count)
@@ -2781,7 +2974,7 @@ void BlobNodeImpl::checkLeavesInSet(const std::set<ustring>& pathNames, shared_p
         throw E57_EXCEPTION2(E57_ERROR_NO_BUFFER_FOR_ELEMENT, "this->pathName=" + this->pathName());
 }
 
-void BlobNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, CheckedFile& cf, int indent, const char* forcedFieldName)
+void BlobNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, BufferedWriter& cf, int indent, const char* forcedFieldName)
 {
     // don't checkImageFileOpen
 
@@ -2789,12 +2982,12 @@ void BlobNodeImpl::writeXml(std::shared_ptr<ImageFileImpl> /*imf*/, CheckedFile&
     if (forcedFieldName != nullptr)
         fieldName = forcedFieldName;
     else
-        fieldName = elementName_;
+        fieldName = *elementName_;
 
     //??? need to implement
     //??? Type --> type
     //??? need to have length?, check same as in section header?
-    uint64_t physicalOffset = cf.logicalToPhysical(binarySectionLogicalStart_);
+    uint64_t physicalOffset = CheckedFile::logicalToPhysical(binarySectionLogicalStart_);
     cf << space(indent) << "<" << fieldName << " type=\"Blob\" fileOffset=\"" << physicalOffset << "\" length=\"" << blobLogicalLength_ << "\"/>\n";
 }
 
@@ -2818,6 +3011,63 @@ void BlobNodeImpl::dump(int indent, ostream& os)
 }
 #endif
 
+//=============================================================================
+NodeArena* NodeArena::create()
+{
+    /// Creator holds the first reference, see release()
+    return(new NodeArena());
+}
+
+NodeArena::NodeArena()
+: refCount_(1), next_(nullptr), available_(0)
+{
+}
+
+void NodeArena::release()
+{
+    /// Creator is done allocating, arena goes away with the last allocation
+    unref();
+}
+
+void* NodeArena::allocate(size_t byteCount)
+{
+    /// Keep every allocation aligned as operator new would
+    const size_t alignment = alignof(std::max_align_t);
+    byteCount = (byteCount + alignment-1) & ~(alignment-1);
+
+    if (byteCount > available_) {
+        if (byteCount > E57_NODE_ARENA_BLOCK_SIZE/4) {
+            /// Large request gets a block of its own, keep cutting from the current block afterwards
+            blocks_.push_back(unique_ptr<char[]>(new char[byteCount]));
+            refCount_++;
+            return(blocks_.back().get());
+        }
+
+        /// Abandon the rest of the current block, start a new one
+        blocks_.push_back(unique_ptr<char[]>(new char[E57_NODE_ARENA_BLOCK_SIZE]));
+        next_ = blocks_.back().get();
+        available_ = E57_NODE_ARENA_BLOCK_SIZE;
+    }
+
+    void* p = next_;
+    next_ += byteCount;
+    available_ -= byteCount;
+    refCount_++;
+    return(p);
+}
+
+void NodeArena::deallocate(void* /*p*/)
+{
+    /// Memory isn't reused, just count it
+    unref();
+}
+
+void NodeArena::unref()
+{
+    if (--refCount_ == 0)
+        delete this;
+}
+
 //=============================================================================
 //=============================================================================
 //=============================================================================
@@ -2827,6 +3077,9 @@ ImageFileImpl::ImageFileImpl( ReadChecksumPolicy policy )
   writerCount_(0),
   readerCount_(0),
   checksumPolicy( std::max( 0, std::min( policy, 100 ) ) ),
+  memoryMapped_( false ),
+  validateXml_( true ),
+  nodeArena_( false ),
   file_(nullptr),
   xmlLogicalOffset_( 0 ),
   xmlLogicalLength_( 0 ),
@@ -2836,6 +3089,14 @@ ImageFileImpl::ImageFileImpl( ReadChecksumPolicy policy )
     /// See ImageFileImpl::construct2() for second phase.
 }
 
+ImageFileImpl::ImageFileImpl( const ImageFileOptions& options )
+: ImageFileImpl( options.checksumPolicy )
+{
+    memoryMapped_ = options.memoryMapped;
+    validateXml_  = options.validateXml;
+    nodeArena_    = options.nodeArena;
+}
+
 void ImageFileImpl::construct2(const ustring& fileName, const ustring& mode)
 {
     /// Second phase of construction, now we have a well-formed ImageFile object.
@@ -2862,7 +3123,7 @@ void ImageFileImpl::construct2(const ustring& fileName, const ustring& mode)
     if (!isWriter_) {
         try { //??? should one try block cover whole function?
             /// Open file for reading.
-            file_ = new CheckedFile( fileName_, CheckedFile::ReadOnly, checksumPolicy );
+            file_ = new CheckedFile( fileName_, memoryMapped_ ? CheckedFile::ReadOnlyMapped : CheckedFile::ReadOnly, checksumPolicy );
 
             shared_ptr<StructureNodeImpl> root(new StructureNodeImpl(imf));
             root_ = root;
@@ -2883,6 +3144,22 @@ void ImageFileImpl::construct2(const ustring& fileName, const ustring& mode)
             throw;  // rethrow
         }
 
+#ifdef E57_BUILTIN_XML_PARSER
+        try {
+            /// Parse XML section with built-in parser, building up the node tree
+            E57XmlParser parser(imf);
+
+            unusedLogicalStart_ = sizeof(E57FileHeader);
+
+            parser.parse(file_, xmlLogicalOffset_, xmlLogicalLength_);
+        } catch (...) {
+            if (file_ != nullptr) {
+                delete file_;
+                file_ = nullptr;
+            }
+            throw;  // rethrow
+        }
+#else
         SAX2XMLReader* xmlReader = nullptr;
 
         // Initialize the XML4C2 system
@@ -2901,11 +3178,12 @@ void ImageFileImpl::construct2(const ustring& fileName, const ustring& mode)
         }
 
         //??? check these are right
-        xmlReader->setFeature(XMLUni::fgSAX2CoreValidation,        true);
-        xmlReader->setFeature(XMLUni::fgXercesDynamic,             true);
+        /// Without validation, the parser only checks that the XML is well formed, E57XmlParser still checks the E57 structure.
+        xmlReader->setFeature(XMLUni::fgSAX2CoreValidation,        validateXml_);
+        xmlReader->setFeature(XMLUni::fgXercesDynamic,             validateXml_);
         xmlReader->setFeature(XMLUni::fgSAX2CoreNameSpaces,        true);
-        xmlReader->setFeature(XMLUni::fgXercesSchema,              true);
-        xmlReader->setFeature(XMLUni::fgXercesSchemaFullChecking,  true);
+        xmlReader->setFeature(XMLUni::fgXercesSchema,              validateXml_);
+        xmlReader->setFeature(XMLUni::fgXercesSchemaFullChecking,  validateXml_);
         xmlReader->setFeature(XMLUni::fgSAX2CoreNameSpacePrefixes, true);
 
         try {
@@ -2936,6 +3214,7 @@ void ImageFileImpl::construct2(const ustring& fileName, const ustring& mode)
         delete xmlReader;
 
         XMLPlatformUtils::Terminate();
+#endif
 
     } else { /// open for writing (start empty)
         try {
@@ -3025,7 +3304,7 @@ void ImageFileImpl::decrWriterCount()
         throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
                              "fileName=" + fileName_
                              + " writerCount=" + toString(writerCount_)
-                             + " readerCount=" + toString(readerCount_));
+                             + " readerCount=" + toString(readerCount_.load()));
     }
 #endif
 }
@@ -3043,7 +3322,7 @@ void ImageFileImpl::decrReaderCount()
         throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
                              "fileName=" + fileName_
                              + " writerCount=" + toString(writerCount_)
-                             + " readerCount=" + toString(readerCount_));
+                             + " readerCount=" + toString(readerCount_.load()));
     }
 #endif
 }
@@ -3068,17 +3347,21 @@ void ImageFileImpl::close()
         xmlLogicalOffset_ = unusedLogicalStart_;
         file_->seek(xmlLogicalOffset_, CheckedFile::Logical);
         uint64_t xmlPhysicalOffset = file_->position(CheckedFile::Physical);
-        *file_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+
+        /// Generate XML in memory, goes to file in large blocks
+        BufferedWriter xml(file_);
+        xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
 #ifdef E57_OXYGEN_SUPPORT //???
-//???        *file_ << "<?oxygen RNGSchema=\"file:/C:/kevin/astm/DataFormat/xif/las_v0_05.rnc\" type=\"compact\"?>\n";
+//???        xml << "<?oxygen RNGSchema=\"file:/C:/kevin/astm/DataFormat/xif/las_v0_05.rnc\" type=\"compact\"?>\n";
 #endif
 
         //??? need to add name space attributes to e57Root
-        root_->writeXml(shared_from_this(), *file_, 0, "e57Root");
+        root_->writeXml(shared_from_this(), xml, 0, "e57Root");
 
         /// Pad XML section so length is multiple of 4
-        while ((file_->position(CheckedFile::Logical) - xmlLogicalOffset_) % 4 != 0)
-            *file_ << " ";
+        while ((xml.position() - xmlLogicalOffset_) % 4 != 0)
+            xml << " ";
+        xml.flush();
 
         /// Note logical length
         xmlLogicalLength_ = file_->position(CheckedFile::Logical) - xmlLogicalOffset_;
@@ -3467,6 +3750,21 @@ ustring ImageFileImpl::pathNameUnparse(bool isRelative, const vector<ustring>& f
     return(path);
 }
 
+shared_ptr<const ustring> ImageFileImpl::internElementName(const ustring& elementName)
+{
+    /// no checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__)
+
+    /// Files repeat the same few element names many times (and every Vector restarts at "0"), so keep one copy of each.
+    /// Nodes share ownership, so names stay valid if nodes outlive this ImageFile.
+    unordered_map<ustring, shared_ptr<const ustring> >::const_iterator it = elementNames_.find(elementName);
+    if (it != elementNames_.end())
+        return(it->second);
+
+    shared_ptr<const ustring> name(make_shared<const ustring>(elementName));
+    elementNames_.emplace(elementName, name);
+    return(name);
+}
+
 void ImageFileImpl::checkImageFileOpen(const char* srcFileName, int srcLineNumber, const char* srcFunctionName)
 {
     if (!isOpen()) {
@@ -3483,7 +3781,7 @@ void ImageFileImpl::dump(int indent, ostream& os)
     /// no checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__)
     os << space(indent) << "fileName:    " << fileName_ << endl;
     os << space(indent) << "writerCount: " << writerCount_ << endl;
-    os << space(indent) << "readerCount: " << readerCount_ << endl;
+    os << space(indent) << "readerCount: " << readerCount_.load() << endl;
     os << space(indent) << "isWriter:    " << isWriter_ << endl;
     for (size_t i=0; i < extensionsCount(); i++)
         os << space(indent) << "nameSpace[" << i << "]: prefix=" << extensionsPrefix(i) << " uri=" << extensionsUri(i) << endl;
@@ -3657,6 +3955,36 @@ int main()
 
 //================================================================
 
+void SeekIndex::addChunk(uint64_t recordNumber, uint64_t physicalOffset)
+{
+    /// Chunks are added in file order, so both fields must be strictly increasing
+    if (!chunks_.empty() && (recordNumber <= chunks_.back().recordNumber || physicalOffset <= chunks_.back().physicalOffset)) {
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
+                             "recordNumber=" + toString(recordNumber)
+                             + " physicalOffset=" + toString(physicalOffset));
+    }
+
+    Chunk chunk;
+    chunk.recordNumber   = recordNumber;
+    chunk.physicalOffset = physicalOffset;
+    chunks_.push_back(chunk);
+}
+
+#ifdef E57_DEBUG
+void SeekIndex::dump(int indent, std::ostream& os)
+{
+    os << space(indent) << "chunkCount: " << chunks_.size() << endl;
+    for (size_t i = 0; i < chunks_.size() && i < 10; i++) {
+        os << space(indent) << "chunk[" << i << "]: recordNumber=" << chunks_[i].recordNumber
+           << " physicalOffset=" << chunks_[i].physicalOffset << endl;
+    }
+    if (chunks_.size() > 10)
+        os << space(indent) << chunks_.size()-10 << " more chunks unprinted..." << endl;
+}
+#endif
+
+//================================================================
+
 CompressedVectorSectionHeader::CompressedVectorSectionHeader()
 {
     /// Double check that header is correct length.  Watch out for RTTI increasing the size.
@@ -3980,9 +4308,9 @@ void IndexPacket::verify(unsigned bufferLength, uint64_t totalRecordCount, uint6
     if (packetType != E57_INDEX_PACKET)
         throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetType=" + toString(packetType));
 
-    /// Check packetLength is at least large enough to hold header
+    /// Check packetLength is at least large enough to hold header (the entries are variable length, so not sizeof(*this))
     unsigned packetLength = packetLogicalLengthMinus1+1;
-    if (packetLength < sizeof(*this))
+    if (packetLength < 16)
         throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString(packetLength));
 
     /// Check packet length is multiple of 4
@@ -4021,7 +4349,7 @@ void IndexPacket::verify(unsigned bufferLength, uint64_t totalRecordCount, uint6
     }
 
     /// Check if entries will fit in space provided
-    unsigned neededLength = 16 + 8*entryCount;
+    unsigned neededLength = 16 + sizeof(IndexPacketEntry)*entryCount;
     if (packetLength < neededLength) {
         throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
                              "packetLength=" + toString(packetLength)
@@ -4074,7 +4402,7 @@ void IndexPacket::verify(unsigned bufferLength, uint64_t totalRecordCount, uint6
 }
 
 #ifdef E57_BIGENDIAN
-IndexPacket::swab(bool toLittleEndian)
+void IndexPacket::swab(bool toLittleEndian)
 {
     /// Be a little paranoid
     if (packetType != E57_INDEX_PACKET)
@@ -4184,9 +4512,21 @@ struct SortByBytestreamNumber {
     }
 };
 
-CompressedVectorWriterImpl::CompressedVectorWriterImpl(shared_ptr<CompressedVectorNodeImpl> ni, vector<SourceDestBuffer>& sbufs)
+CompressedVectorWriterImpl::CompressedVectorWriterImpl(shared_ptr<CompressedVectorNodeImpl> ni, vector<SourceDestBuffer>& sbufs,
+                                                       const CompressedVectorWriterOptions& options)
 : cVector_(ni),
-  isOpen_(false)  // set to true when succeed below
+  isOpen_(false),  // set to true when succeed below
+  encoderThreadCount_(options.encoderThreadCount),
+  encoderRound_(0),
+  encoderStop_(false),
+  encoderBusyCount_(0),
+  encoderTargetRecordIndex_(0),
+  encoderNextStream_(0),
+  backgroundWrite_(options.backgroundWrite),
+  ioLogicalOffset_(0),
+  ioLength_(0),
+  ioPending_(false),
+  ioStop_(false)
 {
     //???  check if cvector already been written (can't write twice)
 
@@ -4204,7 +4544,8 @@ CompressedVectorWriterImpl::CompressedVectorWriterImpl(shared_ptr<CompressedVect
     setBuffers(sbufs); //??? copy code here?
 
     /// Zero dataPacket_ at start
-    memset(&dataPacket_, 0, sizeof(dataPacket_));
+    dataPacket_.reset(new DataPacket);
+    memset(dataPacket_.get(), 0, sizeof(DataPacket));
 
     /// For each individual sbuf, create an appropriate Encoder based on the cVector_ attributes
     for (unsigned i=0; i < sbufs_.size(); i++) {
@@ -4250,6 +4591,18 @@ CompressedVectorWriterImpl::CompressedVectorWriterImpl(shared_ptr<CompressedVect
     dataPacketsCount_       = 0;
     indexPacketsCount_      = 0;
 
+    /// If indexing, the first data packet written will start the first chunk, at record 0.
+    writeIndex_             = options.writeIndex;
+    chunkStartPacketsCount_ = 0;
+    chunkEndRecordIndex_    = 0;
+    chunkStartPending_      = writeIndex_;
+    chunkStartRecordIndex_  = 0;
+
+    /// No point having more threads than bytestreams
+    if (encoderThreadCount_ == 0)
+        encoderThreadCount_ = std::max(std::thread::hardware_concurrency(), 1U);
+    encoderThreadCount_ = std::min(encoderThreadCount_, static_cast<unsigned>(bytestreams_.size()));
+
     /// Just before return (and can't throw) increment writer count  ??? safer way to assure don't miss close?
     imf->incrWriterCount();
 
@@ -4269,6 +4622,14 @@ CompressedVectorWriterImpl::~CompressedVectorWriterImpl()
     } catch (...) {
         //??? report?
     }
+
+    /// close() stops the encoder and I/O threads, unless it wasn't called or threw first
+    encoderThreadsStop();
+    try {
+        ioThreadStop();
+    } catch (...) {
+        //??? report?
+    }
 }
 
 void CompressedVectorWriterImpl::close()
@@ -4290,6 +4651,9 @@ void CompressedVectorWriterImpl::close()
     /// Set closed before do anything, so if get fault and start unwinding, don't try to close again.
     isOpen_ = false;
 
+    /// Nothing left to encode in parallel, only flushing
+    encoderThreadsStop();
+
     /// If have any data, write packet
     /// Write all remaining ioBuffers and internal encoder register cache into file.
     /// Know we are done when totalOutputAvailable() returns 0 after a flush().
@@ -4299,6 +4663,13 @@ void CompressedVectorWriterImpl::close()
         flush();
     }
 
+    /// Wait for background writes to finish, reports any error they had, before writing anything else
+    ioThreadStop();
+
+    /// Write index packets after the data packets, sets topIndexPhysicalOffset_
+    if (writeIndex_)
+        indexWrite();
+
     /// Compute length of whole section we just wrote (from section start to current start of free space).
     sectionLogicalLength_ = imf->unusedLogicalStart_ - sectionHeaderLogicalStart_;
 #ifdef E57_MAX_VERBOSE
@@ -4393,6 +4764,13 @@ void CompressedVectorWriterImpl::write(const size_t requestedRecordCount)
     checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__);
     checkWriterOpen(__FILE__, __LINE__, __FUNCTION__);
 
+    /// Report error from a background write of a previous packet
+    if (backgroundWrite_) {
+        std::lock_guard<std::mutex> lock(ioMutex_);
+        if (ioError_)
+            std::rethrow_exception(ioError_);
+    }
+
     /// Check that requestedRecordCount is not larger than the sbufs
     if (requestedRecordCount > sbufs_.at(0).impl()->capacity()) {
         throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT,
@@ -4409,6 +4787,23 @@ void CompressedVectorWriterImpl::write(const size_t requestedRecordCount)
     /// Loop until all channels have completed requestedRecordCount transfers
     uint64_t endRecordIndex = recordCount_ + requestedRecordCount;
     for (;;) {
+        /// If all channels have reached the end of the current chunk, write out everything they have produced.
+        /// Then the next data packet starts with the first bit of chunkEndRecordIndex_ in every bytestream, and can be indexed.
+        if (chunkEndRecordIndex_ > 0) {
+            bool chunkComplete = true;
+            for (unsigned i=0; i < bytestreams_.size(); i++) {
+                if (bytestreams_.at(i)->currentRecordIndex() < chunkEndRecordIndex_)
+                    chunkComplete = false;
+            }
+            if (chunkComplete) {
+                while (totalOutputAvailable() > 0)
+                    packetWrite();
+                chunkStartPending_     = true;
+                chunkStartRecordIndex_ = chunkEndRecordIndex_;
+                chunkEndRecordIndex_   = 0;
+            }
+        }
+
         /// Calc remaining record counts for all channels
         uint64_t totalRecordCount = 0;
         for (unsigned i=0; i < bytestreams_.size(); i++)
@@ -4443,39 +4838,52 @@ void CompressedVectorWriterImpl::write(const size_t requestedRecordCount)
             continue;  /// restart loop so recalc statistics (packet size may not be zero after write, if have too much data)
         }
 
-        ///??? useful?
-        /// Get approximation of number of bytes per record of CompressedVector and total of bytes used
+        /// Number of data packets in a chunk.  A seek has to decode at most one chunk to reach a record.
+        /// The last packet of each chunk is usually short, so longer chunks waste less space.
+#define E57_CHUNK_PACKET_COUNT  8
+
+        /// If indexing and current chunk is long enough, pick the record where it will end.
+        /// Bitpacked integers can only end a chunk where the encoder register is empty, otherwise the next packet would start mid-record.
+        /// The alignments are all powers of two, so the largest is a multiple of the others.
+        if (writeIndex_ && chunkEndRecordIndex_ == 0 && !chunkStartPending_ && dataPacketsCount_ - chunkStartPacketsCount_ >= E57_CHUNK_PACKET_COUNT) {
+            uint64_t alignment = 1;
+            uint64_t furthestRecordIndex = 0;
+            for (unsigned i=0; i < bytestreams_.size(); i++) {
+                alignment = max(alignment, static_cast<uint64_t>(bytestreams_.at(i)->chunkRecordAlignment()));
+                furthestRecordIndex = max(furthestRecordIndex, bytestreams_.at(i)->currentRecordIndex());
+            }
+            chunkEndRecordIndex_ = (furthestRecordIndex / alignment + 1) * alignment;
+        }
+
+        /// Don't let any channel go past the end of the current chunk
+        uint64_t stopRecordIndex = endRecordIndex;
+        if (chunkEndRecordIndex_ > 0 && chunkEndRecordIndex_ < stopRecordIndex)
+            stopRecordIndex = chunkEndRecordIndex_;
+
+        /// Get approximation of number of bits per record of CompressedVector, and where the slowest channel is
         float totalBitsPerRecord = 0;  // an estimate of future performance
-        for (unsigned i=0; i < bytestreams_.size(); i++)
+        uint64_t slowestRecordIndex = stopRecordIndex;
+        for (unsigned i=0; i < bytestreams_.size(); i++) {
             totalBitsPerRecord += bytestreams_.at(i)->bitsPerRecord();
+            slowestRecordIndex = min(slowestRecordIndex, bytestreams_.at(i)->currentRecordIndex());
+        }
 
+        /// Estimate how many records will fill the rest of the packet to the target size.
+        /// If all fields are constants (no bits per record), everything left fits.
+        uint64_t spaceRemaining = E57_TARGET_PACKET_SIZE - currentPacketSize();
+        uint64_t recordsNeeded = stopRecordIndex - slowestRecordIndex;
+        if (totalBitsPerRecord > 0) {
+            double approxRecordsNeeded = ceil(8.0 * spaceRemaining / totalBitsPerRecord);
+            if (approxRecordsNeeded < static_cast<double>(recordsNeeded))
+                recordsNeeded = max(static_cast<uint64_t>(approxRecordsNeeded), static_cast<uint64_t>(1));
+        }
 #ifdef E57_MAX_VERBOSE
-        float totalBytesPerRecord = max(totalBitsPerRecord/8, 0.1F); //??? trust
-
-        cout << "  totalBytesPerRecord=" << totalBytesPerRecord << endl; //???
+        cout << "  totalBitsPerRecord=" << totalBitsPerRecord << " spaceRemaining=" << spaceRemaining << " recordsNeeded=" << recordsNeeded << endl; //???
 #endif
 
-//!!!        unsigned spaceRemaining = E57_DATA_PACKET_MAX - currentPacketSize();
-//!!!        unsigned appoxRecordsNeeded = static_cast<unsigned>(floor(spaceRemaining / totalBytesPerRecord)); //??? divide by zero if all constants
-
-
-        /// Don't allow straggler to get too far behind. ???
-        /// Don't allow a single channel to get too far ahead ???
-        /// Process channels that are furthest behind first. ???
-
-        ///!!!! For now just process one record per loop until packet is full enough, or completed request
-        for (unsigned i=0; i < bytestreams_.size(); i++) {
-             if (bytestreams_.at(i)->currentRecordIndex() < endRecordIndex) {
-#if 0
-                bytestreams_.at(i)->processRecords(1);
-#else
-                //!!! For now, process up to 50 records at a time
-                uint64_t recordCount = endRecordIndex - bytestreams_.at(i)->currentRecordIndex();
-                recordCount = (recordCount<50ULL)?recordCount:50ULL; //min(recordCount, 50ULL);
-                bytestreams_.at(i)->processRecords(static_cast<unsigned>(recordCount));
-#endif
-            }
-        }
+        /// Bring every channel up to the same record, so streams in a packet stay synchronized.
+        /// A channel that is already there, or whose output is full, just doesn't make progress this iteration.
+        encodeRecords(slowestRecordIndex + recordsNeeded);
     }
 
     recordCount_ += requestedRecordCount;
@@ -4483,28 +4891,201 @@ void CompressedVectorWriterImpl::write(const size_t requestedRecordCount)
     /// When we leave this function, will likely still have data in channel ioBuffers as well as partial words in Encoder registers.
 }
 
-size_t CompressedVectorWriterImpl::totalOutputAvailable() const
+void CompressedVectorWriterImpl::encodeRecords(uint64_t targetRecordIndex)
 {
-    size_t total = 0;
-    for (size_t i=0; i < bytestreams_.size(); i++) {
-        total += bytestreams_.at(i)->outputAvailable();
+    /// Bring every bytestream up to targetRecordIndex, or as far as its output has room for.
+    encoderTargetRecordIndex_ = targetRecordIndex;
+    encoderNextStream_ = 0;
+
+    if (encoderThreadCount_ <= 1) {
+        encodeBytestreams();
+        return;
     }
-    return(total);
+
+    /// Start the pool on the first round, the caller is one of the encoderThreadCount_ threads
+    if (encoderThreads_.empty()) {
+        for (unsigned i = 1; i < encoderThreadCount_; i++)
+            encoderThreads_.push_back(std::thread(&CompressedVectorWriterImpl::encoderThread, this));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex_);
+        encoderRound_++;
+        encoderBusyCount_ = static_cast<unsigned>(encoderThreads_.size());
+        encoderError_ = nullptr;
+    }
+    encoderStart_.notify_all();
+
+    /// Take a share of the bytestreams on this thread, then wait for the others to finish theirs
+    std::exception_ptr error;
+    try {
+        encodeBytestreams();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(encoderMutex_);
+    encoderDone_.wait(lock, [this] { return(encoderBusyCount_ == 0); });
+    if (!error)
+        error = encoderError_;
+    if (error)
+        std::rethrow_exception(error);
 }
 
-size_t CompressedVectorWriterImpl::currentPacketSize() const
+void CompressedVectorWriterImpl::encodeBytestreams()
 {
-    /// Calc current packet size
-    return(sizeof(DataPacketHeader) + bytestreams_.size()*sizeof(uint16_t) + totalOutputAvailable());
+    /// Each bytestream is encoded by only one thread per round, and has its own source buffer, so the encoders don't share anything.
+    for (;;) {
+        size_t i = encoderNextStream_++;
+        if (i >= bytestreams_.size())
+            break;
+        uint64_t currentRecordIndex = bytestreams_[i]->currentRecordIndex();
+        if (currentRecordIndex < encoderTargetRecordIndex_)
+            bytestreams_[i]->processRecords(static_cast<size_t>(encoderTargetRecordIndex_ - currentRecordIndex));
+    }
 }
 
-uint64_t CompressedVectorWriterImpl::packetWrite()
+void CompressedVectorWriterImpl::encoderThread()
 {
-#ifdef E57_MAX_VERBOSE
-    cout << "CompressedVectorWriterImpl::packetWrite() called" << endl; //???
-#endif
+    uint64_t round = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(encoderMutex_);
+            encoderStart_.wait(lock, [this, round] { return(encoderStop_ || encoderRound_ != round); });
+            if (encoderStop_)
+                return;
+            round = encoderRound_;
+        }
 
-    /// Double check that we have work to do
+        /// Exceptions are caught in this thread, and the first one is rethrown by the caller of encodeRecords().
+        std::exception_ptr error;
+        try {
+            encodeBytestreams();
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(encoderMutex_);
+        if (error && !encoderError_)
+            encoderError_ = error;
+        if (--encoderBusyCount_ == 0)
+            encoderDone_.notify_one();
+    }
+}
+
+void CompressedVectorWriterImpl::encoderThreadsStop()
+{
+    if (encoderThreads_.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex_);
+        encoderStop_ = true;
+    }
+    encoderStart_.notify_all();
+    for (std::thread& thread : encoderThreads_)
+        thread.join();
+    encoderThreads_.clear();
+}
+
+void CompressedVectorWriterImpl::ioPacketQueue(uint64_t logicalOffset, unsigned length)
+{
+    /// Previous packet must be written before its buffer is reused
+    ioWait();
+
+    /// Swap buffers, packet just assembled goes to I/O thread
+    if (!ioPacket_)
+        ioPacket_.reset(new DataPacket);
+    std::swap(dataPacket_, ioPacket_);
+    ioLogicalOffset_ = logicalOffset;
+    ioLength_        = length;
+
+    if (!ioThread_.joinable())
+        ioThread_ = std::thread(&CompressedVectorWriterImpl::ioThread, this);
+    {
+        std::lock_guard<std::mutex> lock(ioMutex_);
+        ioPending_ = true;
+    }
+    ioCond_.notify_all();
+}
+
+void CompressedVectorWriterImpl::ioWait()
+{
+    /// Wait until no packet is in flight, and rethrow the first write error if there was one
+    std::unique_lock<std::mutex> lock(ioMutex_);
+    ioCond_.wait(lock, [this] { return(!ioPending_); });
+    if (ioError_)
+        std::rethrow_exception(ioError_);
+}
+
+void CompressedVectorWriterImpl::ioThread()
+{
+    for (;;) {
+        {
+            /// A packet queued before the stop is still written
+            std::unique_lock<std::mutex> lock(ioMutex_);
+            ioCond_.wait(lock, [this] { return(ioStop_ || ioPending_); });
+            if (!ioPending_)
+                return;
+        }
+
+        /// Exceptions are caught in this thread, and rethrown by the next write(), packet queued, or close().
+        std::exception_ptr error;
+        try {
+            shared_ptr<ImageFileImpl> imf(cVector_->destImageFile_);
+            imf->file_->seek(ioLogicalOffset_);
+            imf->file_->write(reinterpret_cast<char*>(ioPacket_.get()), ioLength_);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(ioMutex_);
+            if (error && !ioError_)
+                ioError_ = error;
+            ioPending_ = false;
+        }
+        ioCond_.notify_all();
+    }
+}
+
+void CompressedVectorWriterImpl::ioThreadStop()
+{
+    if (ioThread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(ioMutex_);
+            ioStop_ = true;
+        }
+        ioCond_.notify_all();
+        ioThread_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(ioMutex_);
+    if (ioError_)
+        std::rethrow_exception(ioError_);
+}
+
+size_t CompressedVectorWriterImpl::totalOutputAvailable() const
+{
+    size_t total = 0;
+    for (size_t i=0; i < bytestreams_.size(); i++) {
+        total += bytestreams_.at(i)->outputAvailable();
+    }
+    return(total);
+}
+
+size_t CompressedVectorWriterImpl::currentPacketSize() const
+{
+    /// Calc current packet size
+    return(sizeof(DataPacketHeader) + bytestreams_.size()*sizeof(uint16_t) + totalOutputAvailable());
+}
+
+uint64_t CompressedVectorWriterImpl::packetWrite()
+{
+#ifdef E57_MAX_VERBOSE
+    cout << "CompressedVectorWriterImpl::packetWrite() called" << endl; //???
+#endif
+
+    /// Double check that we have work to do
     size_t totalOutput = totalOutputAvailable();
     if (totalOutput == 0)
         return(0);
@@ -4556,7 +5137,7 @@ uint64_t CompressedVectorWriterImpl::packetWrite()
     shared_ptr<ImageFileImpl> imf(cVector_->destImageFile_);
 
     /// Use temp buf in object (is 64KBytes long) instead of allocating each time here
-    char* packet = reinterpret_cast<char*>(&dataPacket_);
+    char* packet = reinterpret_cast<char*>(dataPacket_.get());
 #ifdef E57_MAX_VERBOSE
     cout << "  packet=" << (unsigned)packet << endl; //???
 #endif
@@ -4628,28 +5209,33 @@ uint64_t CompressedVectorWriterImpl::packetWrite()
     }
 
     /// Prepare header in dataPacket_, now that we are sure of packetLength
-    dataPacket_.packetType = E57_DATA_PACKET;
-    dataPacket_.packetFlags = 0;
-    dataPacket_.packetLogicalLengthMinus1 = static_cast<uint16_t>(packetLength-1);          // %%% Truncation
-    dataPacket_.bytestreamCount = static_cast<uint16_t>(bytestreams_.size());       // %%% Truncation
+    dataPacket_->packetType = E57_DATA_PACKET;
+    dataPacket_->packetFlags = 0;
+    dataPacket_->packetLogicalLengthMinus1 = static_cast<uint16_t>(packetLength-1);          // %%% Truncation
+    dataPacket_->bytestreamCount = static_cast<uint16_t>(bytestreams_.size());       // %%% Truncation
 
     /// Double check that data packet is well formed
-    dataPacket_.verify(packetLength);
+    dataPacket_->verify(packetLength);
 
 #ifdef E57_BIGENDIAN
     /// On bigendian CPUs, swab packet to little-endian byte order before writing.
-    dataPacket_.swab(true);
+    dataPacket_->swab(true);
 #endif
 
     /// Write whole data packet at beginning of free space in file
     uint64_t packetLogicalOffset = imf->allocateSpace(packetLength, false);
     uint64_t packetPhysicalOffset = imf->file_->logicalToPhysical(packetLogicalOffset);
-    imf->file_->seek(packetLogicalOffset);  //??? have seekLogical and seekPhysical instead? more explicit
-    imf->file_->write(packet, packetLength);
+    if (backgroundWrite_) {
+        /// Hand packet to I/O thread, and assemble the next one in the buffer it has finished with
+        ioPacketQueue(packetLogicalOffset, packetLength);
+    } else {
+        imf->file_->seek(packetLogicalOffset);  //??? have seekLogical and seekPhysical instead? more explicit
+        imf->file_->write(packet, packetLength);
+    }
 
 #ifdef E57_MAX_VERBOSE
 //  cout << "data packet:" << endl;
-//  dataPacket_.dump(4);
+//  dataPacket_->dump(4);
 #endif
 
     /// If first data packet written for this CompressedVector binary section, save address to put in section header
@@ -4657,9 +5243,14 @@ uint64_t CompressedVectorWriterImpl::packetWrite()
     ///??? what if have exceptions while write, what is state of file?  will close report file good/bad?
     if (dataPacketsCount_ == 0)
         dataPhysicalOffset_ = packetPhysicalOffset;
-    dataPacketsCount_++;
 
-    ///!!! update seekIndex here? if started new chunk?
+    /// If this packet starts a chunk, add it to the seekIndex
+    if (chunkStartPending_) {
+        seekIndex_.addChunk(chunkStartRecordIndex_, packetPhysicalOffset);
+        chunkStartPacketsCount_ = dataPacketsCount_;
+        chunkStartPending_ = false;
+    }
+    dataPacketsCount_++;
 
     /// Return physical offset of data packet for potential use in seekIndex
     return(packetPhysicalOffset); //??? needed
@@ -4671,6 +5262,75 @@ void CompressedVectorWriterImpl::flush()
         bytestreams_.at(i)->registerFlushToOutput();
 }
 
+void CompressedVectorWriterImpl::indexWrite()
+{
+    /// Write tree of index packets from seekIndex_.
+    /// Level 0 packets point to the first data packet of each chunk, higher levels point to the packets of the level below.
+    /// The tree is written after the last data packet, inside the section, and found through indexPhysicalOffset.
+    /// Readers skip the index packets when they look for data packets.
+    const vector<SeekIndex::Chunk>& chunks = seekIndex_.chunks();
+    if (chunks.empty())
+        return;
+
+    shared_ptr<ImageFileImpl> imf(cVector_->destImageFile_);
+
+    vector<SeekIndex::Chunk> entries(chunks);
+    for (unsigned indexLevel = 0; ; indexLevel++) {
+        /// Record first record and location of each packet written at this level, for use by the next level up.
+        vector<SeekIndex::Chunk> packets;
+
+        size_t first = 0;
+        while (first < entries.size()) {
+            size_t count = min(entries.size() - first, static_cast<size_t>(IndexPacket::MAX_ENTRIES));
+
+            /// Packets above level 0 must have at least two entries, so don't leave one entry for the last packet.
+            if (indexLevel > 0 && entries.size() - first - count == 1)
+                count--;
+
+            /// IndexPacket is too big to put on the stack.  Constructor zeros it.
+            unique_ptr<IndexPacket> ipkt(new IndexPacket);
+            for (size_t i = 0; i < count; i++) {
+                ipkt->entries[i].chunkRecordNumber   = entries[first+i].recordNumber;
+                ipkt->entries[i].chunkPhysicalOffset = entries[first+i].physicalOffset;
+            }
+
+            /// Header is 16 bytes, entries are 16 bytes each, so packetLength is always a multiple of 4
+            unsigned packetLength = static_cast<unsigned>(16 + sizeof(IndexPacket::IndexPacketEntry)*count);
+            ipkt->packetType                = E57_INDEX_PACKET;
+            ipkt->packetLogicalLengthMinus1 = static_cast<uint16_t>(packetLength-1);
+            ipkt->entryCount                = static_cast<uint16_t>(count);
+            ipkt->indexLevel                = static_cast<uint8_t>(indexLevel);
+
+#ifdef E57_DEBUG
+            /// Double check that index packet is well formed
+            ipkt->verify(packetLength, recordCount_, imf->file_->length(CheckedFile::Physical));
+#endif
+            ipkt->swab(true);  /// swab if neccesary
+
+            /// Write index packet at beginning of free space in file
+            uint64_t packetLogicalOffset = imf->allocateSpace(packetLength, false);
+            uint64_t packetPhysicalOffset = imf->file_->logicalToPhysical(packetLogicalOffset);
+            imf->file_->seek(packetLogicalOffset);
+            imf->file_->write(reinterpret_cast<char*>(ipkt.get()), packetLength);
+            indexPacketsCount_++;
+
+            SeekIndex::Chunk packet;
+            packet.recordNumber   = entries[first].recordNumber;
+            packet.physicalOffset = packetPhysicalOffset;
+            packets.push_back(packet);
+
+            first += count;
+        }
+
+        /// When a level fits in a single packet, it is the top of the tree
+        if (packets.size() == 1) {
+            topIndexPhysicalOffset_ = packets.at(0).physicalOffset;
+            break;
+        }
+        entries.swap(packets);
+    }
+}
+
 void CompressedVectorWriterImpl::checkImageFileOpen(const char* srcFileName, int srcLineNumber, const char* srcFunctionName)
 {
 #if 0
@@ -4728,7 +5388,7 @@ void CompressedVectorWriterImpl::dump(int indent, std::ostream& os)
 
     /// Don't call dump() for DataPacket, since it may contain junk when debugging.  Just print a few byte values.
     os << space(indent) << "dataPacket:" << endl;
-    uint8_t* p = reinterpret_cast<uint8_t*>(&dataPacket_);
+    uint8_t* p = reinterpret_cast<uint8_t*>(dataPacket_.get());
     for (unsigned i = 0; i < 40; ++i) {
         os << space(indent+4) << "dataPacket[" << i << "]: " << static_cast<unsigned>(p[i]) << endl;
     }
@@ -4741,15 +5401,22 @@ void CompressedVectorWriterImpl::dump(int indent, std::ostream& os)
     os << space(indent) << "recordCount:               " << recordCount_ << endl;
     os << space(indent) << "dataPacketsCount:          " << dataPacketsCount_ << endl;
     os << space(indent) << "indexPacketsCount:         " << indexPacketsCount_ << endl;
+    os << space(indent) << "writeIndex:                " << writeIndex_ << endl;
+    os << space(indent) << "chunkStartPacketsCount:    " << chunkStartPacketsCount_ << endl;
+    os << space(indent) << "chunkEndRecordIndex:       " << chunkEndRecordIndex_ << endl;
+    os << space(indent) << "chunkStartPending:         " << chunkStartPending_ << endl;
+    os << space(indent) << "chunkStartRecordIndex:     " << chunkStartRecordIndex_ << endl;
 }
 
 ///================================================================
 ///================================================================
 ///================================================================
 
-CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVectorNodeImpl> cvi, vector<SourceDestBuffer>& dbufs)
+CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVectorNodeImpl> cvi, vector<SourceDestBuffer>& dbufs,
+                                                       const CompressedVectorReaderOptions& options)
 : isOpen_(false),  // set to true when succeed below
-  cVector_(cvi)
+  cVector_(cvi),
+  options_(options)
 {
 #ifdef E57_MAX_VERBOSE
     cout << "CompressedVectorReaderImpl() called" << endl; //???
@@ -4768,6 +5435,14 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
                              + " cvPathName=" + cVector_->pathName());
     }
 
+    /// Cache must be able to hold at least one packet
+    if (options.cacheByteSize == 0 && options.cachePacketCount == 0) {
+        throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT,
+                             "imageFileName=" + cVector_->imageFileName()
+                             + " cvPathName=" + cVector_->pathName()
+                             + " cachePacketCount=" + toString(options.cachePacketCount));
+    }
+
     /// Get CompressedArray's prototype node (all array elements must match this type)
     proto_ = cVector_->getPrototype();
 
@@ -4797,8 +5472,16 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
 
     shared_ptr<ImageFileImpl> imf(cVector_->destImageFile_);
 
+    /// Size the packet cache, a byte size is rounded down to whole maximum sized packets.
+    unsigned cachePacketCount = options.cachePacketCount;
+    if (options.cacheByteSize > 0)
+        cachePacketCount = static_cast<unsigned>(std::max<size_t>(options.cacheByteSize / E57_DATA_PACKET_MAX, 1));
+
+    /// Read ahead thread shares the CheckedFile with this thread, only safe when nothing is writing to it.
+    unsigned readAheadCount = imf->isWriter() ? 0 : options.readAheadPacketCount;
+
     //??? what if fault in this constructor?
-    cache_ = new PacketReadCache(imf->file_, 32);
+    cache_ = new PacketReadCache(imf->file_, cachePacketCount, readAheadCount);
 
     /// Read CompressedVector section header
     CompressedVectorSectionHeader sectionHeader;
@@ -4809,8 +5492,7 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
                              "imageFileName=" + cVector_->imageFileName()
                              + " cvPathName=" + cVector_->pathName());
     }
-    imf->file_->seek(sectionLogicalStart, CheckedFile::Logical);
-    imf->file_->read(reinterpret_cast<char*>(&sectionHeader), sizeof(sectionHeader));
+    imf->file_->readAt(sectionLogicalStart, reinterpret_cast<char*>(&sectionHeader), sizeof(sectionHeader));
     sectionHeader.swab();  /// swab if neccesary
 
 #ifdef E57_DEBUG
@@ -4820,8 +5502,12 @@ CompressedVectorReaderImpl::CompressedVectorReaderImpl(shared_ptr<CompressedVect
     /// Pre-calc end of section, so can tell when we are out of packets.
     sectionEndLogicalOffset_ = sectionLogicalStart + sectionHeader.sectionLogicalLength;
 
+    /// Save location of index for seek, is zero if file has no index
+    indexPhysicalOffset_ = sectionHeader.indexPhysicalOffset;
+
     /// Convert physical offset to first data packet to logical
     uint64_t dataLogicalOffset = imf->file_->physicalToLogical(sectionHeader.dataPhysicalOffset);
+    dataLogicalOffset_ = dataLogicalOffset;
 
     /// Verify that packet given by dataPhysicalOffset is actually a data packet, init channels
     {
@@ -4937,7 +5623,7 @@ unsigned CompressedVectorReaderImpl::read()
     }
 
     /// Verify that each channel produced the same number of records
-    unsigned outputCount = 0;
+    size_t outputCount = 0;
     for (unsigned i = 0; i < channels_.size(); i++) {
         DecodeChannel* chan = &channels_[i];
         if (i == 0)
@@ -4952,7 +5638,134 @@ unsigned CompressedVectorReaderImpl::read()
     }
 
     /// Return number of records transferred to each dbuf.
-    return(outputCount);
+    return(static_cast<unsigned>(outputCount));
+}
+
+/// Fewest records given to each thread by readAll, smaller slices cost more in seeking than they save.
+#define E57_READ_ALL_MIN_SLICE_RECORDS  65536
+
+uint64_t CompressedVectorReaderImpl::readAll(vector<SourceDestBuffer>& dbufs, unsigned threadCount)
+{
+    checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__);
+    checkReaderOpen(__FILE__, __LINE__, __FUNCTION__);
+
+    /// Check dbufs well formed: no dups, no extra, missing is ok
+    if (dbufs.size() == 0) {
+        throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT,
+                             "imageFileName=" + cVector_->imageFileName()
+                             + " cvPathName=" + cVector_->pathName());
+    }
+    proto_->checkBuffers(dbufs, true);
+
+    /// Each dbuf must be able to hold every record
+    for (SourceDestBuffer& dbuf : dbufs) {
+        if (dbuf.impl()->capacity() < maxRecordCount_) {
+            throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT,
+                                 "pathName=" + dbuf.impl()->pathName()
+                                 + " capacity=" + toString(dbuf.impl()->capacity())
+                                 + " recordCount=" + toString(maxRecordCount_));
+        }
+    }
+
+    if (maxRecordCount_ == 0)
+        return(0);
+
+    /// Strings are variable length, so can't start decoding them in the middle of the vector.
+    /// They are read by one job from the first record, the fixed size fields are split into slices of records read in parallel.
+    vector<SourceDestBuffer> stringDbufs;
+    vector<SourceDestBuffer> numericDbufs;
+    for (SourceDestBuffer& dbuf : dbufs) {
+        if (dbuf.impl()->memoryRepresentation() == E57_USTRING)
+            stringDbufs.push_back(dbuf);
+        else
+            numericDbufs.push_back(dbuf);
+    }
+
+    /// A write mode ImageFile can't be read from several threads at once (see CompressedVectorNodeImpl::reader),
+    /// so its jobs are all run on this thread, one after another.
+    bool runSerially = cVector_->destImageFile()->isWriter();
+    if (runSerially)
+        threadCount = 1;
+    else if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+
+    uint64_t sliceCount = 0;
+    if (numericDbufs.size() > 0) {
+        sliceCount = (maxRecordCount_ + E57_READ_ALL_MIN_SLICE_RECORDS - 1) / E57_READ_ALL_MIN_SLICE_RECORDS;
+        sliceCount = std::min(sliceCount, static_cast<uint64_t>(threadCount));
+    }
+
+    /// Each job gets its own reader, positioned by seek(), which decodes straight into the job's part of the caller's buffers.
+    /// Readers are made here rather than in the threads, so errors in the arguments are reported before any thread starts.
+    struct ReadJob {
+        unique_ptr<CompressedVectorReaderImpl> reader;
+        uint64_t    firstRecord;
+        uint64_t    recordCount;
+    };
+    vector<ReadJob> jobs;
+    for (uint64_t slice = 0; slice < sliceCount; slice++) {
+        uint64_t firstRecord = maxRecordCount_ * slice / sliceCount;
+        uint64_t endRecord   = maxRecordCount_ * (slice + 1) / sliceCount;
+
+        vector<SourceDestBuffer> sliceDbufs;
+        for (SourceDestBuffer& dbuf : numericDbufs)
+            sliceDbufs.push_back(SourceDestBuffer(dbuf.impl()->slice(static_cast<size_t>(firstRecord), static_cast<size_t>(endRecord - firstRecord))));
+
+        ReadJob job;
+        job.reader.reset(new CompressedVectorReaderImpl(cVector_, sliceDbufs, options_));
+        job.firstRecord = firstRecord;
+        job.recordCount = endRecord - firstRecord;
+        jobs.push_back(std::move(job));
+    }
+    if (stringDbufs.size() > 0) {
+        ReadJob job;
+        job.reader.reset(new CompressedVectorReaderImpl(cVector_, stringDbufs, options_));
+        job.firstRecord = 0;
+        job.recordCount = maxRecordCount_;
+        jobs.push_back(std::move(job));
+    }
+
+    /// First job runs on this thread, the rest get a thread each.
+    /// Exceptions are caught in the thread that threw, and the first one is rethrown here after all threads finish.
+    vector<std::exception_ptr> errors(jobs.size());
+    auto runJob = [&jobs, &errors](size_t jobIndex) {
+        try {
+            ReadJob& job = jobs[jobIndex];
+            if (job.firstRecord > 0)
+                job.reader->seek(job.firstRecord);
+            /// read() returns an unsigned count, take it from the slice instead, which may hold more than 2^32 records
+            job.reader->read();
+            uint64_t recordCount = job.reader->dbufs_.at(0).impl()->nextIndex();
+            if (recordCount != job.recordCount) {
+                throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
+                                     "firstRecord=" + toString(job.firstRecord)
+                                     + " recordCount=" + toString(recordCount)
+                                     + " expectedRecordCount=" + toString(job.recordCount));
+            }
+            job.reader->close();
+        } catch (...) {
+            errors[jobIndex] = std::current_exception();
+        }
+    };
+
+    vector<std::thread> threads;
+    for (size_t i = 1; i < jobs.size(); i++) {
+        if (runSerially)
+            runJob(i);
+        else
+            threads.push_back(std::thread(runJob, i));
+    }
+    runJob(0);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    for (std::exception_ptr& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    /// Return number of records transferred to each dbuf.
+    return(maxRecordCount_);
 }
 
 uint64_t CompressedVectorReaderImpl::earliestPacketNeededForInput() const
@@ -5109,6 +5922,16 @@ void CompressedVectorReaderImpl::feedPacketToDecoders(uint64_t currentPacketLogi
             }
         }
     }
+
+    /// Let the cache start reading the packets after the furthest ahead channel, while the decoders work.
+    uint64_t furthestPacketLogicalOffset = 0;
+    for ( const DecodeChannel &channel : channels_ )
+    {
+        if (!channel.inputFinished && channel.currentPacketLogicalOffset > furthestPacketLogicalOffset)
+            furthestPacketLogicalOffset = channel.currentPacketLogicalOffset;
+    }
+    if (furthestPacketLogicalOffset > 0)
+        cache_->readAhead(furthestPacketLogicalOffset, sectionEndLogicalOffset_);
 }
 
 uint64_t CompressedVectorReaderImpl::findNextDataPacket(uint64_t nextPacketLogicalOffset)
@@ -5144,12 +5967,315 @@ uint64_t CompressedVectorReaderImpl::findNextDataPacket(uint64_t nextPacketLogic
     return E57_UINT64_MAX;
 }
 
-void CompressedVectorReaderImpl::seek(uint64_t /*recordNumber*/)
+void CompressedVectorReaderImpl::seek(uint64_t recordNumber)
 {
     checkImageFileOpen(__FILE__, __LINE__, __FUNCTION__);
+    checkReaderOpen(__FILE__, __LINE__, __FUNCTION__);
+
+    /// Seeking to one past the last record is allowed
+    if (recordNumber > maxRecordCount_) {
+        throw E57_EXCEPTION2(E57_ERROR_BAD_API_ARGUMENT,
+                             "recordNumber=" + toString(recordNumber)
+                             + " maxRecordCount=" + toString(maxRecordCount_)
+                             + " imageFileName=" + cVector_->imageFileName()
+                             + " cvPathName=" + cVector_->pathName());
+    }
+
+    if (indexPhysicalOffset_ != 0) {
+        /// Find chunk containing recordNumber, start all channels at its beginning.
+        uint64_t chunkRecordNumber;
+        uint64_t chunkLogicalOffset;
+        seekIndexLookup(recordNumber, chunkRecordNumber, chunkLogicalOffset);
+        seekChunkStart(chunkRecordNumber, chunkLogicalOffset);
+    } else {
+        /// No index packets, so use packet directory to start each channel as close to recordNumber as its encoding allows.
+        seekPacketDirectory(recordNumber);
+    }
+
+    /// Decode up to recordNumber
+    skipRecords(recordNumber);
+
+    recordCount_ = recordNumber;
+}
+
+void CompressedVectorReaderImpl::seekIndexLookup(uint64_t recordNumber, uint64_t& chunkRecordNumber, uint64_t& chunkLogicalOffset)
+{
+    shared_ptr<ImageFileImpl> imf(cVector_->destImageFile_);
+
+    /// Walk down the index tree from the top packet.
+    /// At each level, follow the last entry that starts at or before recordNumber, until reach a level 0 packet.
+    uint64_t packetLogicalOffset = imf->file_->physicalToLogical(indexPhysicalOffset_);
+    for (unsigned depth = 0; ; depth++) {
+        char* anyPacket = nullptr;
+        unique_ptr<PacketLock> packetLock = cache_->lock(packetLogicalOffset, anyPacket);
+        const IndexPacket* ipkt = reinterpret_cast<const IndexPacket*>(anyPacket);
+
+        if (ipkt->packetType != E57_INDEX_PACKET)
+            throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetType=" + toString(ipkt->packetType));
+
+        /// Levels count down to zero, so can't be deeper than the top level allows.  Protects against loops in a bad file.
+        if (depth > 5)
+            throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "indexLevel=" + toString(ipkt->indexLevel));
+
+        /// Binary search for first entry that starts after recordNumber
+        unsigned lo = 0;
+        unsigned hi = ipkt->entryCount;
+        while (lo < hi) {
+            unsigned mid = (lo + hi) / 2;
+            if (ipkt->entries[mid].chunkRecordNumber <= recordNumber)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        /// First entry must start at or before recordNumber
+        if (lo == 0) {
+            throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
+                                 "recordNumber=" + toString(recordNumber)
+                                 + " chunkRecordNumber=" + toString(ipkt->entries[0].chunkRecordNumber));
+        }
+
+        chunkRecordNumber  = ipkt->entries[lo-1].chunkRecordNumber;
+        chunkLogicalOffset = imf->file_->physicalToLogical(ipkt->entries[lo-1].chunkPhysicalOffset);
+
+        if (ipkt->indexLevel == 0)
+            return;
+        packetLogicalOffset = chunkLogicalOffset;
+    }
+}
+
+void CompressedVectorReaderImpl::seekChunkStart(uint64_t chunkRecordNumber, uint64_t chunkLogicalOffset)
+{
+    char* anyPacket = nullptr;
+    unique_ptr<PacketLock> packetLock = cache_->lock(chunkLogicalOffset, anyPacket);
+    DataPacket* dpkt = reinterpret_cast<DataPacket*>(anyPacket);
+
+    /// Chunks always start with a data packet
+    if (dpkt->packetType != E57_DATA_PACKET)
+        throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetType=" + toString(dpkt->packetType));
+
+    /// Every bytestream buffer in the packet starts with the first bit of chunkRecordNumber.
+    /// So restart each channel at the beginning of its buffer, and throw away anything its decoder is holding.
+    for (DecodeChannel &channel : channels_) {
+        channel.currentPacketLogicalOffset    = chunkLogicalOffset;
+        channel.currentBytestreamBufferIndex  = 0;
+        channel.currentBytestreamBufferLength = dpkt->getBytestreamBufferLength(channel.bytestreamNumber);
+        channel.inputFinished                 = false;
+        channel.decoder->recordIndexReset(chunkRecordNumber);
+    }
+}
+
+void CompressedVectorReaderImpl::seekPacketDirectory(uint64_t recordNumber)
+{
+    shared_ptr<PacketDirectory> directory = packetDirectory();
+    size_t packetCount = directory->packetLogicalOffsets.size();
+
+    for (DecodeChannel &channel : channels_) {
+        unsigned bytestreamNumber = channel.bytestreamNumber;
+        if (bytestreamNumber >= directory->bytestreamCount) {
+            throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
+                                 "bytestreamNumber=" + toString(bytestreamNumber)
+                                 + " bytestreamCount=" + toString(directory->bytestreamCount));
+        }
+
+        /// Ask decoder for the nearest record at or before recordNumber that it can start decoding at, and where it is in the bytestream.
+        /// Variable length encodings (strings) have to start at the beginning.
+        uint64_t startRecordNumber;
+        uint64_t byteOffset;
+        if (!channel.decoder->recordPosition(recordNumber, startRecordNumber, byteOffset)) {
+            startRecordNumber = 0;
+            byteOffset        = 0;
+        }
+
+        /// Binary search for first packet whose bytestream buffer ends after byteOffset.
+        /// If there isn't one, the decoder doesn't need any more input, so park it at end of last packet.
+        size_t lo = 0;
+        size_t hi = packetCount;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (directory->bytestreamStart(mid+1, bytestreamNumber) <= byteOffset)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        size_t packetIndex = (lo < packetCount) ? lo : packetCount-1;
+
+        uint64_t bufferStart  = directory->bytestreamStart(packetIndex, bytestreamNumber);
+        uint64_t bufferLength = directory->bytestreamStart(packetIndex+1, bytestreamNumber) - bufferStart;
+
+        channel.currentPacketLogicalOffset    = directory->packetLogicalOffsets.at(packetIndex);
+        channel.currentBytestreamBufferIndex  = static_cast<size_t>(min(byteOffset - bufferStart, bufferLength));
+        channel.currentBytestreamBufferLength = static_cast<size_t>(bufferLength);
+        channel.inputFinished                 = false;
+        channel.decoder->recordIndexReset(startRecordNumber);
+    }
+}
+
+shared_ptr<PacketDirectory> CompressedVectorReaderImpl::packetDirectory()
+{
+    /// Readers of the same CompressedVector in other threads may want the directory at the same time, only build it once.
+    lock_guard<mutex> lock(cVector_->packetDirectoryMutex_);
+    if (cVector_->packetDirectory_)
+        return(cVector_->packetDirectory_);
+
+    shared_ptr<ImageFileImpl> imf(cVector_->destImageFile_);
+
+    shared_ptr<PacketDirectory> directory(new PacketDirectory);
+    directory->bytestreamCount = 0;
+    vector<uint64_t> bytestreamTotals;
+    vector<uint16_t> bsbLength;
+
+    /// Walk all packets in section, reading only the packet headers and the bytestream buffer lengths of data packets.
+    uint64_t packetLogicalOffset = dataLogicalOffset_;
+    while (packetLogicalOffset < sectionEndLogicalOffset_) {
+        /// Use EmptyPacketHeader since it has the common fields to all packets.
+        EmptyPacketHeader header;
+        imf->file_->readAt(packetLogicalOffset, reinterpret_cast<char*>(&header), sizeof(header));
+        header.swab();
+        unsigned packetLength = header.packetLogicalLengthMinus1+1;
+
+        if (header.packetType == E57_DATA_PACKET) {
+            DataPacketHeader dataHeader;
+            imf->file_->readAt(packetLogicalOffset, reinterpret_cast<char*>(&dataHeader), sizeof(dataHeader));
+            dataHeader.swab();
+            dataHeader.verify();
+
+            /// All data packets in section must have same number of bytestreams
+            unsigned bytestreamCount = dataHeader.bytestreamCount;
+            if (directory->bytestreamCount == 0) {
+                directory->bytestreamCount = bytestreamCount;
+                bytestreamTotals.resize(bytestreamCount, 0);
+                bsbLength.resize(bytestreamCount);
+            } else if (bytestreamCount != directory->bytestreamCount) {
+                throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
+                                     "bytestreamCount=" + toString(bytestreamCount)
+                                     + " expectedCount=" + toString(directory->bytestreamCount));
+            }
+            if (sizeof(DataPacketHeader) + bytestreamCount*sizeof(uint16_t) > packetLength) {
+                throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
+                                     "bytestreamCount=" + toString(bytestreamCount)
+                                     + " packetLength=" + toString(packetLength));
+            }
 
-    ///!!! implement
-    throw E57_EXCEPTION1(E57_ERROR_NOT_IMPLEMENTED);
+            imf->file_->readAt(packetLogicalOffset + sizeof(DataPacketHeader), reinterpret_cast<char*>(&bsbLength[0]),
+                               bytestreamCount*sizeof(uint16_t));
+
+            directory->packetLogicalOffsets.push_back(packetLogicalOffset);
+            for (unsigned i = 0; i < bytestreamCount; i++) {
+                SWAB(&bsbLength[i]);  /// swab if neccesary
+                directory->bytestreamStarts.push_back(bytestreamTotals[i]);
+                bytestreamTotals[i] += bsbLength[i];
+            }
+        }
+
+        /// All packets have length in same place, so can use the field to skip to next packet.
+        packetLogicalOffset += packetLength;
+    }
+
+    /// Reader constructor checked that section starts with a data packet, so should have found at least one.
+    if (directory->packetLogicalOffsets.empty())
+        throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "dataLogicalOffset=" + toString(dataLogicalOffset_));
+
+    /// Append row of totals, so length of every bytestream buffer is difference of two rows
+    directory->bytestreamStarts.insert(directory->bytestreamStarts.end(), bytestreamTotals.begin(), bytestreamTotals.end());
+
+    cVector_->packetDirectory_ = directory;
+    return(directory);
+}
+
+/// Records decoded at a time by skipRecords, per channel
+#define E57_SKIP_BUFFER_RECORDS 4096
+
+void CompressedVectorReaderImpl::skipRecords(uint64_t recordNumber)
+{
+    shared_ptr<ImageFileImpl> imf(cVector_->destImageFile_);
+
+    /// Skipped records are decoded into scratch buffers, so the caller's dbufs aren't touched,
+    /// and values that wouldn't fit in the caller's memory representation aren't an error.
+    /// The scratch buffers take each field's values as they are stored in the file, so need no conversion or scaling.
+    vector<vector<int64_t> > skipIntegers(channels_.size());
+    vector<vector<double> >  skipReals(channels_.size());
+    vector<vector<ustring> > skipStrings(channels_.size());
+    vector<SourceDestBuffer> skipDbufs;
+    for (size_t i = 0; i < channels_.size(); i++) {
+        ustring pathName = channels_[i].dbuf.impl()->pathName();
+        shared_ptr<SourceDestBufferImpl> skipBuffer;
+        switch (proto_->get(pathName)->type()) {
+            case E57_INTEGER:
+            case E57_SCALED_INTEGER:
+                skipIntegers[i].resize(E57_SKIP_BUFFER_RECORDS);
+                skipBuffer.reset(new SourceDestBufferImpl(imf, pathName, &skipIntegers[i][0], E57_SKIP_BUFFER_RECORDS));
+                break;
+            case E57_FLOAT:
+                skipReals[i].resize(E57_SKIP_BUFFER_RECORDS);
+                skipBuffer.reset(new SourceDestBufferImpl(imf, pathName, &skipReals[i][0], E57_SKIP_BUFFER_RECORDS));
+                break;
+            case E57_STRING:
+                skipStrings[i].resize(E57_SKIP_BUFFER_RECORDS);
+                skipBuffer.reset(new SourceDestBufferImpl(imf, pathName, &skipStrings[i]));
+                break;
+            default:
+                throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "pathName=" + pathName);
+        }
+        skipDbufs.push_back(SourceDestBuffer(skipBuffer));
+    }
+
+    /// Swap the scratch buffers into the channels, and limit them to recordNumber, so decoding stops exactly there.
+    /// Each channel's dbuf is swapped back afterwards, even if decoding fails, since the scratch buffers are about to go away.
+    for (size_t i = 0; i < channels_.size(); i++)
+        swap(channels_[i].dbuf, skipDbufs[i]);
+    auto restore = [this, &skipDbufs]() {
+        for (size_t i = 0; i < channels_.size(); i++) {
+            DecodeChannel &channel = channels_[i];
+            swap(channel.dbuf, skipDbufs[i]);
+            vector<SourceDestBuffer> dbufs(1, channel.dbuf);
+            channel.decoder->destBufferSetNew(dbufs);
+            channel.maxRecordCount = maxRecordCount_;
+            channel.decoder->maxRecordCountSet(maxRecordCount_);
+        }
+    };
+    try {
+        for (DecodeChannel &channel : channels_) {
+            vector<SourceDestBuffer> dbufs(1, channel.dbuf);
+            channel.decoder->destBufferSetNew(dbufs);
+            channel.maxRecordCount = recordNumber;
+            channel.decoder->maxRecordCountSet(recordNumber);
+        }
+
+        /// Decode and throw the records away, until every channel gets to recordNumber.
+        bool skipComplete = false;
+        while (!skipComplete) {
+            for (DecodeChannel &channel : channels_)
+                channel.dbuf.impl()->rewind();
+
+            for (DecodeChannel &channel : channels_)
+                channel.decoder->inputProcess(NULL, 0);
+
+            uint64_t earliestPacketLogicalOffset;
+            while ((earliestPacketLogicalOffset = earliestPacketNeededForInput()) != E57_UINT64_MAX)
+                feedPacketToDecoders(earliestPacketLogicalOffset);
+
+            skipComplete = true;
+            for (DecodeChannel &channel : channels_) {
+                if (channel.decoder->totalRecordsCompleted() < recordNumber) {
+                    /// If ran out of packets before getting there, the section is bad
+                    if (channel.inputFinished) {
+                        throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET,
+                                             "bytestreamNumber=" + toString(channel.bytestreamNumber)
+                                             + " totalRecordsCompleted=" + toString(channel.decoder->totalRecordsCompleted())
+                                             + " recordNumber=" + toString(recordNumber));
+                    }
+                    skipComplete = false;
+                }
+            }
+        }
+    } catch (...) {
+        restore();
+        throw;
+    }
+
+    /// Put back the caller's dbufs, and the limits for the whole vector
+    restore();
 }
 
 bool CompressedVectorReaderImpl::isOpen() const
@@ -5239,6 +6365,8 @@ void CompressedVectorReaderImpl::dump(int indent, std::ostream& os)
     os << space(indent) << "recordCount:             " << recordCount_ << endl;
     os << space(indent) << "maxRecordCount:          " << maxRecordCount_ << endl;
     os << space(indent) << "sectionEndLogicalOffset: " << sectionEndLogicalOffset_ << endl;
+    os << space(indent) << "dataLogicalOffset:       " << dataLogicalOffset_ << endl;
+    os << space(indent) << "indexPhysicalOffset:     " << indexPhysicalOffset_ << endl;
 }
 
 //================================================================
@@ -5265,30 +6393,63 @@ PacketLock::~PacketLock()
     }
 }
 
-PacketReadCache::PacketReadCache(CheckedFile* cFile, unsigned packetCount)
+PacketReadCache::PacketReadCache(CheckedFile* cFile, unsigned packetCount, unsigned readAheadCount)
 : lockCount_(0),
-  useCount_(0),
   cFile_(cFile),
-  entries_(packetCount)
+  entries_(packetCount),
+  newest_(NO_ENTRY),
+  oldest_(NO_ENTRY),
+  readAheadSlots_(readAheadCount),
+  readAheadStart_(0),
+  readAheadEnd_(0),
+  readAheadPending_(false),
+  readAheadStop_(false)
 {
     if (packetCount == 0)
         throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "packetCount=" + toString(packetCount));
 
-    /// Allocate requested number of maximum sized data packets buffers for holding data read from file
+    index_.reserve(packetCount);
+
+    /// Link all entries into the LRU list, entry 0 is reused first.
+    /// Packet buffers are allocated when an entry is first used, so a large cache costs nothing until it fills.
     for (unsigned i=0; i < entries_.size(); i++) {
         entries_.at(i).logicalOffset_ = 0;
-        entries_.at(i).buffer_        = new char[E57_DATA_PACKET_MAX];
-        entries_.at(i).lastUsed_      = 0;
+        entries_.at(i).buffer_        = NULL;
+        entries_.at(i).newer_         = (i+1 < packetCount) ? i+1 : NO_ENTRY;
+        entries_.at(i).older_         = (i > 0) ? i-1 : NO_ENTRY;
+    }
+    newest_ = packetCount-1;
+    oldest_ = 0;
+
+    for (ReadAheadSlot& slot : readAheadSlots_) {
+        slot.logicalOffset_ = 0;
+        slot.buffer_        = NULL;
+        slot.length_        = 0;
+        slot.ready_         = false;
     }
 }
 
 PacketReadCache::~PacketReadCache()
 {
+    /// Stop read ahead thread before freeing the buffers it may be reading into
+    if (readAheadThread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(readAheadMutex_);
+            readAheadStop_ = true;
+        }
+        readAheadCondition_.notify_all();
+        readAheadThread_.join();
+    }
+
     /// Free allocated packet buffers
     for (unsigned i=0; i < entries_.size(); i++) {
         delete [] entries_.at(i).buffer_;
         entries_.at(i).buffer_ = NULL;
     }
+    for (ReadAheadSlot& slot : readAheadSlots_) {
+        delete [] slot.buffer_;
+        slot.buffer_ = NULL;
+    }
 }
 
 unique_ptr<PacketLock> PacketReadCache::lock(uint64_t packetLogicalOffset, char* &pkt)
@@ -5305,55 +6466,47 @@ unique_ptr<PacketLock> PacketReadCache::lock(uint64_t packetLogicalOffset, char*
     if (packetLogicalOffset == 0)
         throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "packetLogicalOffset=" + toString(packetLogicalOffset));
 
-    /// Linear scan for matching packet offset in cache
-    for (unsigned i = 0; i < entries_.size(); i++)
-    {
-        if (packetLogicalOffset == entries_[i].logicalOffset_)
-        {
-            /// Found a match, so don't have to read anything
+    unsigned entry;
+    auto found = index_.find(packetLogicalOffset);
+    if (found != index_.end()) {
+        /// Found a match, so don't have to read anything
+        entry = found->second;
 #ifdef E57_MAX_VERBOSE
-            cout << "  Found matching cache entry, index=" << i << endl;
+        cout << "  Found matching cache entry, index=" << entry << endl;
 #endif
-            /// Mark entry with current useCount (keeps track of age of entry).
-            entries_[i].lastUsed_ = ++useCount_;
-
-            /// Publish buffer address to caller
-            pkt = entries_[i].buffer_;
-
-            /// Create lock so we are sure that we will be unlocked when use is finished.
-            unique_ptr<PacketLock> plock(new PacketLock(this, i));
-
-            /// Increment cache lock just before return
-            lockCount_++;
+    } else {
+        /// Not in cache, so reuse the least recently used (LRU) packet buffer
+        entry = oldest_;
+#ifdef E57_MAX_VERBOSE
+        cout << "  Oldest entry=" << entry << endl;
+#endif
+        CacheEntry& e = entries_[entry];
 
-            return plock;
+        /// Forget the packet entry used to hold, so a failed read below doesn't leave a half overwritten packet findable.
+        if (e.logicalOffset_ != 0) {
+            index_.erase(e.logicalOffset_);
+            e.logicalOffset_ = 0;
         }
-    }
-    /// Get here if didn't find a match already in cache.
 
-    /// Find least recently used (LRU) packet buffer
-    unsigned oldestEntry = 0;
-    unsigned oldestUsed = entries_.at(0).lastUsed_;
-
-    for (unsigned i = 0; i < entries_.size(); i++)
-    {
-        if (entries_[i].lastUsed_ < oldestUsed)
-        {
-            oldestEntry = i;
-            oldestUsed = entries_[i].lastUsed_;
+        /// Use packet from read ahead thread if it has it, otherwise read it now
+        if (!takeReadAhead(entry, packetLogicalOffset)) {
+            if (e.buffer_ == NULL)
+                e.buffer_ = new char[E57_DATA_PACKET_MAX];
+            readPacket(e.buffer_, packetLogicalOffset);
         }
+
+        e.logicalOffset_ = packetLogicalOffset;
+        index_[packetLogicalOffset] = entry;
     }
-#ifdef E57_MAX_VERBOSE
-    cout << "  Oldest entry=" << oldestEntry << " lastUsed=" << oldestUsed << endl;
-#endif
 
-    readPacket(oldestEntry, packetLogicalOffset);
+    /// Move entry to the newest end of the LRU list
+    makeMostRecent(entry);
 
     /// Publish buffer address to caller
-    pkt = entries_[oldestEntry].buffer_;
+    pkt = entries_[entry].buffer_;
 
-    /// Create lock so we are sure we will be unlocked when use is finished.
-    unique_ptr<PacketLock> plock(new PacketLock(this, oldestEntry));
+    /// Create lock so we are sure that we will be unlocked when use is finished.
+    unique_ptr<PacketLock> plock(new PacketLock(this, entry));
 
     /// Increment cache lock just before return
     lockCount_++;
@@ -5361,6 +6514,165 @@ unique_ptr<PacketLock> PacketReadCache::lock(uint64_t packetLogicalOffset, char*
     return plock;
 }
 
+void PacketReadCache::makeMostRecent(unsigned entry)
+{
+    if (entry == newest_)
+        return;
+
+    CacheEntry& e = entries_[entry];
+
+    /// Unlink entry, it isn't newest_ so it has a newer neighbour
+    entries_[e.newer_].older_ = e.older_;
+    if (e.older_ != NO_ENTRY)
+        entries_[e.older_].newer_ = e.newer_;
+    else
+        oldest_ = e.newer_;
+
+    /// Relink at newest end
+    e.newer_ = NO_ENTRY;
+    e.older_ = newest_;
+    entries_[newest_].newer_ = entry;
+    newest_ = entry;
+}
+
+void PacketReadCache::readAhead(uint64_t packetLogicalOffset, uint64_t sectionEndLogicalOffset)
+{
+    /// Ask the read ahead thread to fetch the packets that follow packetLogicalOffset.
+    /// Only a hint: does nothing if read ahead is off, or the packet isn't in the cache to learn its length from.
+    if (readAheadSlots_.empty())
+        return;
+    auto found = index_.find(packetLogicalOffset);
+    if (found == index_.end())
+        return;
+
+    /// All packets have length in same place
+    const EmptyPacketHeader* hp = reinterpret_cast<const EmptyPacketHeader*>(entries_[found->second].buffer_);
+    uint64_t start = packetLogicalOffset + hp->packetLogicalLengthMinus1 + 1;
+    if (start >= sectionEndLogicalOffset)
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(readAheadMutex_);
+
+        /// Already asked for these packets
+        if (start == readAheadStart_)
+            return;
+
+        readAheadStart_   = start;
+        readAheadEnd_     = sectionEndLogicalOffset;
+        readAheadPending_ = true;
+    }
+
+    if (readAheadThread_.joinable())
+        readAheadCondition_.notify_all();
+    else
+        readAheadThread_ = std::thread(&PacketReadCache::readAheadThread, this);
+}
+
+bool PacketReadCache::takeReadAhead(unsigned entry, uint64_t packetLogicalOffset)
+{
+    if (readAheadSlots_.empty())
+        return false;
+
+    std::unique_lock<std::mutex> lock(readAheadMutex_);
+    for (;;) {
+        ReadAheadSlot* slot = nullptr;
+        for (ReadAheadSlot& s : readAheadSlots_) {
+            if (s.logicalOffset_ == packetLogicalOffset) {
+                slot = &s;
+                break;
+            }
+        }
+        if (slot == nullptr)
+            return false;
+
+        if (!slot->ready_) {
+            /// Thread is reading the packet right now, cheaper to wait for it than to read it again.
+            /// If the read fails, the thread frees the slot and we read the packet ourselves to get the error.
+            readAheadCondition_.wait(lock);
+            continue;
+        }
+
+        /// Trade buffers with the slot, so the packet doesn't have to be copied
+        std::swap(entries_[entry].buffer_, slot->buffer_);
+        slot->logicalOffset_ = 0;
+        slot->ready_         = false;
+        return true;
+    }
+}
+
+void PacketReadCache::readAheadThread()
+{
+    std::unique_lock<std::mutex> lock(readAheadMutex_);
+    while (!readAheadStop_) {
+        if (!readAheadPending_) {
+            readAheadCondition_.wait(lock);
+            continue;
+        }
+
+        /// Walk the packets of the request in order, reading the first one not already in a slot.
+        /// Lengths of packets already in a slot are known, so the walk can step over them.
+        uint64_t start  = readAheadStart_;
+        uint64_t offset = start;
+        ReadAheadSlot* target = nullptr;
+        for (size_t n = 0; n < readAheadSlots_.size() && offset < readAheadEnd_; n++) {
+            ReadAheadSlot* slot = nullptr;
+            for (ReadAheadSlot& s : readAheadSlots_) {
+                if (s.logicalOffset_ == offset && s.ready_) {
+                    slot = &s;
+                    break;
+                }
+            }
+            if (slot == nullptr) {
+                /// Reuse a free slot, or one behind the request, or else the one furthest ahead.
+                for (ReadAheadSlot& s : readAheadSlots_) {
+                    if (s.logicalOffset_ < start) {
+                        target = &s;
+                        break;
+                    }
+                    if (target == nullptr || s.logicalOffset_ > target->logicalOffset_)
+                        target = &s;
+                }
+                break;
+            }
+            offset += slot->length_;
+        }
+
+        if (target == nullptr || offset >= readAheadEnd_) {
+            /// All requested packets are waiting in slots
+            readAheadPending_ = false;
+            continue;
+        }
+
+        /// Read the packet without holding the lock, lock() may want packets that are already ready
+        target->logicalOffset_ = offset;
+        target->ready_         = false;
+        if (target->buffer_ == NULL)
+            target->buffer_ = new char[E57_DATA_PACKET_MAX];
+        char* buffer = target->buffer_;
+
+        lock.unlock();
+        unsigned length = 0;
+        try {
+            length = readPacket(buffer, offset);
+        } catch (...) {
+            /// Leave the error to be found again when lock() reads the packet itself
+        }
+        lock.lock();
+
+        if (length > 0) {
+            target->length_ = length;
+            target->ready_  = true;
+        } else {
+            /// Can't find the packets after a bad one, so drop the request
+            target->logicalOffset_ = 0;
+            if (start == readAheadStart_)
+                readAheadPending_ = false;
+        }
+        readAheadCondition_.notify_all();
+    }
+}
+
 void PacketReadCache::unlock(unsigned lockedEntry)
 {
 //??? why lockedEntry not used?
@@ -5374,16 +6686,15 @@ void PacketReadCache::unlock(unsigned lockedEntry)
     lockCount_--;
 }
 
-void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOffset)
+unsigned PacketReadCache::readPacket(char* buffer, uint64_t packetLogicalOffset)
 {
 #ifdef E57_MAX_VERBOSE
-    cout << "PacketReadCache::readPacket() called, oldestEntry=" << oldestEntry << " packetLogicalOffset=" << packetLogicalOffset << endl;
+    cout << "PacketReadCache::readPacket() called, packetLogicalOffset=" << packetLogicalOffset << endl;
 #endif
 
     /// Read header of packet first to get length.  Use EmptyPacketHeader since it has the commom fields to all packets.
     EmptyPacketHeader header;
-    cFile_->seek(packetLogicalOffset, CheckedFile::Logical);
-    cFile_->read(reinterpret_cast<char*>(&header), sizeof(header));
+    cFile_->readAt(packetLogicalOffset, reinterpret_cast<char*>(&header), sizeof(header));
     header.swab();
     /// Can't verify packet header here, because it is not really an EmptyPacketHeader.
     unsigned packetLength = header.packetLogicalLengthMinus1+1;
@@ -5392,15 +6703,14 @@ void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOff
     if (packetLength > E57_DATA_PACKET_MAX)
         throw E57_EXCEPTION2(E57_ERROR_BAD_CV_PACKET, "packetLength=" + toString(packetLength));
 
-    /// Now read in whole packet into preallocated buffer_.  Note buffer is
-    cFile_->seek(packetLogicalOffset, CheckedFile::Logical);
-    cFile_->read(entries_.at(oldestEntry).buffer_, packetLength);
+    /// Now read in whole packet into buffer.
+    cFile_->readAt(packetLogicalOffset, buffer, packetLength);
 
     /// Swab if necessary, then verify that packet is good.
     switch (header.packetType)
     {
         case E57_DATA_PACKET: {
-                DataPacket* dpkt = reinterpret_cast<DataPacket*>(entries_.at(oldestEntry).buffer_);
+                DataPacket* dpkt = reinterpret_cast<DataPacket*>(buffer);
 #ifdef E57_BIGENDIAN
                 dpkt->swab(false);
 #endif
@@ -5412,7 +6722,7 @@ void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOff
             }
             break;
         case E57_INDEX_PACKET: {
-                IndexPacket* ipkt = reinterpret_cast<IndexPacket*>(entries_.at(oldestEntry).buffer_);
+                IndexPacket* ipkt = reinterpret_cast<IndexPacket*>(buffer);
 #ifdef E57_BIGENDIAN
                 ipkt->swab(false);
 #endif
@@ -5424,7 +6734,7 @@ void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOff
             }
             break;
         case E57_EMPTY_PACKET: {
-                EmptyPacketHeader* hp = reinterpret_cast<EmptyPacketHeader*>(entries_.at(oldestEntry).buffer_);
+                EmptyPacketHeader* hp = reinterpret_cast<EmptyPacketHeader*>(buffer);
                 hp->swab();
                 hp->verify(packetLength);
 #ifdef E57_MAX_VERBOSE
@@ -5437,23 +6747,17 @@ void PacketReadCache::readPacket(unsigned oldestEntry, uint64_t packetLogicalOff
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "packetType=" + toString(header.packetType));
     }
 
-    entries_[oldestEntry].logicalOffset_ = packetLogicalOffset;
-
-    /// Mark entry with current useCount (keeps track of age of entry).
-    /// This is a cache, so a small hiccup when useCount_ overflows won't hurt.
-    entries_[oldestEntry].lastUsed_ = ++useCount_;
+    return packetLength;
 }
 
 #ifdef E57_DEBUG
 void PacketReadCache::dump(int indent, std::ostream& os)
 {
     os << space(indent) << "lockCount: " << lockCount_ << endl;
-    os << space(indent) << "useCount:  " << useCount_ << endl;
-    os << space(indent) << "entries:" << endl;
-    for (unsigned i=0; i < entries_.size(); i++) {
+    os << space(indent) << "entries (newest first):" << endl;
+    for (unsigned i=newest_; i != NO_ENTRY; i = entries_[i].older_) {
         os << space(indent) << "entry[" << i << "]:" << endl;
         os << space(indent+4) << "logicalOffset:  " << entries_[i].logicalOffset_ << endl;
-        os << space(indent+4) << "lastUsed:        " << entries_[i].lastUsed_ << endl;
         if (entries_[i].logicalOffset_ != 0) {
             os << space(indent+4) << "packet:" << endl;
             switch (reinterpret_cast<EmptyPacketHeader*>(entries_.at(i).buffer_)->packetType) {
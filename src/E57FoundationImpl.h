@@ -30,9 +30,16 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
 #include <set>
 #include <stack>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "Common.h"
@@ -43,10 +50,13 @@ namespace e57 {
 /// Forward declaration
 template <typename RegisterT> class BitpackIntegerEncoder;
 template <typename RegisterT> class BitpackIntegerDecoder;
+class BitpackFloatDecoder;
 
 class E57XmlParser;
+class NodePathImpl;
 class Decoder;
 class Encoder;
+struct PacketDirectory;
 
 //================================================================
 
@@ -78,7 +88,7 @@ public:
     void                    checkBuffers(const std::vector<SourceDestBuffer>& sdbufs, bool allowMissing);
     bool                    findTerminalPosition(std::shared_ptr<NodeImpl> ni, uint64_t& countFromLeft);
 
-    virtual void            writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) = 0;
+    virtual void            writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) = 0;
 
     virtual                 ~NodeImpl() = default;
 
@@ -88,6 +98,7 @@ public:
 
 protected:
     friend class StructureNodeImpl;
+    friend class NodePathImpl;
     friend class CompressedVectorWriterImpl;
     friend class Decoder;
     friend class Encoder;
@@ -95,14 +106,18 @@ protected:
                                          NodeImpl(std::weak_ptr<ImageFileImpl> destImageFile);
     NodeImpl&                            operator=(NodeImpl& n);
     virtual std::shared_ptr<NodeImpl>  lookup(const ustring& /*pathName*/) {return(std::shared_ptr<NodeImpl>());}
+    virtual std::shared_ptr<NodeImpl>  lookup(const std::vector<ustring>& /*fields*/, unsigned /*level*/) {return(std::shared_ptr<NodeImpl>());}
     std::shared_ptr<NodeImpl>          getRoot();
 
     std::weak_ptr<ImageFileImpl>       destImageFile_;
     std::weak_ptr<NodeImpl>            parent_;
-    ustring                            elementName_;
+    std::shared_ptr<const ustring>     elementName_;    /// interned by destImageFile, empty for root and unattached nodes
     bool                               isAttached_;
 };
 
+/// Number of children at which a Structure starts keeping a hash index of its element names
+#define E57_STRUCTURE_INDEX_MIN_CHILDREN 16
+
 class StructureNodeImpl : public NodeImpl {
 public:
                         StructureNodeImpl(std::weak_ptr<ImageFileImpl> destImageFile);
@@ -111,11 +126,13 @@ public:
     virtual NodeType    type() const override;
     virtual bool        isTypeEquivalent(std::shared_ptr<NodeImpl> ni) override;
     virtual bool        isDefined(const ustring& pathName) override;
+    bool                isDefined(NodePathImpl& path);
     virtual void        setAttachedRecursive() override;
 
     virtual int64_t     childCount() const;
     virtual std::shared_ptr<NodeImpl> get(int64_t index);
     virtual std::shared_ptr<NodeImpl> get(const ustring& pathName) override;
+    std::shared_ptr<NodeImpl> get(NodePathImpl& path);
     virtual void        set(int64_t index, std::shared_ptr<NodeImpl> ni);
     virtual void        set(const ustring& pathName, std::shared_ptr<NodeImpl> ni, bool autoPathCreate = false) override;
     virtual void        set(const std::vector<ustring>& fields, unsigned level, std::shared_ptr<NodeImpl> ni, bool autoPathCreate = false) override;
@@ -123,7 +140,7 @@ public:
 
     virtual void        checkLeavesInSet(const std::set<ustring>& pathNames, std::shared_ptr<NodeImpl> origin) override;
 
-    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
+    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) override;
 
 #ifdef E57_DEBUG
     void                dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -132,8 +149,12 @@ public:
 protected:
     friend class CompressedVectorReaderImpl;
     virtual std::shared_ptr<NodeImpl> lookup(const ustring& pathName) override;
+    virtual std::shared_ptr<NodeImpl> lookup(const std::vector<ustring>& fields, unsigned level) override;
+    size_t              childIndex(const ustring& elementName) const;
+    void                addChild(std::shared_ptr<NodeImpl> ni);
 
     std::vector<std::shared_ptr<NodeImpl> > children_;
+    std::unique_ptr<std::unordered_map<ustring, size_t> > childIndex_;  /// elementName -> index in children_, null until E57_STRUCTURE_INDEX_MIN_CHILDREN
 };
 
 class VectorNodeImpl : public StructureNodeImpl {
@@ -147,7 +168,7 @@ public:
 
     virtual void        set(int64_t index, std::shared_ptr<NodeImpl> ni) override;
 
-    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
+    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) override;
 
 #ifdef E57_DEBUG
     void                dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -157,6 +178,44 @@ protected:
     bool allowHeteroChildren_;
 };
 
+/// Number of start nodes a NodePathImpl remembers the node found from
+#define E57_NODE_PATH_CACHE_SIZE 8
+
+class NodePathImpl {
+public:
+                        NodePathImpl(std::weak_ptr<ImageFileImpl> destImageFile, const ustring& pathName);
+
+    std::shared_ptr<ImageFileImpl> destImageFile() const {return(std::shared_ptr<ImageFileImpl>(destImageFile_));}
+    ustring             pathName() const    {return(pathName_);}
+    bool                isRelative() const  {return(isRelative_);}
+
+    std::shared_ptr<NodeImpl> lookup(std::shared_ptr<NodeImpl> origin);
+
+#ifdef E57_DEBUG
+    void                dump(int indent = 0, std::ostream& os = std::cout);
+#endif
+
+protected:
+    std::weak_ptr<ImageFileImpl> destImageFile_;
+    ustring                 pathName_;
+    bool                    isRelative_;
+    std::vector<ustring>    fields_;    /// pathName_ split at '/', checked once in ctor
+
+    /// Node found by a successful lookup, and the node the lookup started from.
+    /// startKey is compared first, so entries for other start nodes are skipped without locking their weak_ptr.
+    struct CacheEntry {
+        const NodeImpl*         startKey = nullptr;
+        std::weak_ptr<NodeImpl> start;
+        std::weak_ptr<NodeImpl> node;
+    };
+    std::mutex              cacheMutex_;
+    CacheEntry              cache_[E57_NODE_PATH_CACHE_SIZE];
+    unsigned                cacheNext_;     /// Entry the next successful lookup replaces
+};
+
+/// Number of values encoders and decoders stage at a time for the block transfers of SourceDestBufferImpl
+#define E57_TRANSFER_BLOCK_SIZE 256
+
 class SourceDestBufferImpl : public std::enable_shared_from_this<SourceDestBufferImpl> {
 public:
     SourceDestBufferImpl(std::weak_ptr<ImageFileImpl> destImageFile, const ustring pathName, int8_t* b,   const size_t capacity, bool doConversion = false,
@@ -189,7 +248,7 @@ public:
     bool                    doScaling()     const { return doScaling_; }
     size_t                  stride()        const { return stride_; }
     size_t                  capacity()      const { return capacity_; }
-    unsigned                nextIndex()     const { return nextIndex_; }
+    size_t                  nextIndex()     const { return nextIndex_; }
     void                    rewind()        { nextIndex_= 0; }
 
     int64_t         getNextInt64();
@@ -203,7 +262,18 @@ public:
     void            setNextDouble(double value);
     void            setNextString(const ustring& value);
 
+    /// Block versions of above, transfer count values with one dispatch on memory representation
+    void            getNextBlock(int64_t* values, size_t count);
+    void            getNextBlock(int64_t* values, size_t count, double scale, double offset);
+    void            getNextBlock(float* values, size_t count);
+    void            getNextBlock(double* values, size_t count);
+    void            setNextBlock(const int64_t* values, size_t count);
+    void            setNextBlock(const int64_t* values, size_t count, double scale, double offset);
+    void            setNextBlock(const float* values, size_t count);
+    void            setNextBlock(const double* values, size_t count);
+
     void            checkCompatible(std::shared_ptr<SourceDestBufferImpl> newBuf) const;
+    std::shared_ptr<SourceDestBufferImpl> slice(size_t firstIndex, size_t count) const;
 
 #ifdef E57_DEBUG
     void            dump(int indent = 0, std::ostream& os = std::cout);
@@ -218,6 +288,7 @@ protected:
     friend class BitpackIntegerDecoder<uint16_t>;
     friend class BitpackIntegerDecoder<uint32_t>;
     friend class BitpackIntegerDecoder<uint64_t>;
+    friend class BitpackFloatDecoder;
 
     void                    checkState_() const;  /// Common routine to check that constructor arguments were ok, throws if not
 
@@ -230,7 +301,7 @@ protected:
     bool                    doConversion_;  /// Convert memory representation to/from disk representation
     bool                    doScaling_;     /// Apply scale factor for integer type
     size_t                  stride_;        /// Distance between each element (different than size_ if elements not contiguous)
-    unsigned                nextIndex_;     /// Number of elements that have been set (dest buffer) or read (source buffer) since rewind().
+    size_t                  nextIndex_;     /// Number of elements that have been set (dest buffer) or read (source buffer) since rewind().
     std::vector<ustring>*   ustrings_;      /// Optional array of ustrings (used if memoryRepresentation_==E57_USTRING) ???ownership
 };
 
@@ -255,11 +326,11 @@ public:
 
     virtual void        checkLeavesInSet(const std::set<ustring>& pathNames, std::shared_ptr<NodeImpl> origin) override;
 
-    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
+    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) override;
 
     /// Iterator constructors
-    std::shared_ptr<CompressedVectorWriterImpl> writer(std::vector<SourceDestBuffer> sbufs);
-    std::shared_ptr<CompressedVectorReaderImpl> reader(std::vector<SourceDestBuffer> dbufs);
+    std::shared_ptr<CompressedVectorWriterImpl> writer(std::vector<SourceDestBuffer> sbufs, const CompressedVectorWriterOptions& options);
+    std::shared_ptr<CompressedVectorReaderImpl> reader(std::vector<SourceDestBuffer> dbufs, const CompressedVectorReaderOptions& options);
 
     int64_t             getRecordCount()                        {return(recordCount_);}
     uint64_t            getBinarySectionLogicalStart()          {return(binarySectionLogicalStart_);}
@@ -279,6 +350,10 @@ protected:
 
     int64_t                     recordCount_;
     uint64_t                    binarySectionLogicalStart_;
+
+    /// Built by the first reader that seeks in a binary section without index packets, shared by later readers
+    std::shared_ptr<PacketDirectory> packetDirectory_;
+    std::mutex                  packetDirectoryMutex_;
 };
 
 class IntegerNodeImpl : public NodeImpl {
@@ -296,7 +371,7 @@ public:
 
     virtual void        checkLeavesInSet(const std::set<ustring>& pathNames, std::shared_ptr<NodeImpl> origin) override;
 
-    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
+    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) override;
 
 #ifdef E57_DEBUG
     void                dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -335,7 +410,7 @@ public:
 
     virtual void        checkLeavesInSet(const std::set<ustring>& pathNames, std::shared_ptr<NodeImpl> origin) override;
 
-    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
+    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) override;
 
 
 #ifdef E57_DEBUG
@@ -368,7 +443,7 @@ public:
 
     virtual void        checkLeavesInSet(const std::set<ustring>& pathNames, std::shared_ptr<NodeImpl> origin) override;
 
-    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
+    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) override;
 
 #ifdef E57_DEBUG
     void                dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -394,7 +469,7 @@ public:
 
     virtual void        checkLeavesInSet(const std::set<ustring>& pathNames, std::shared_ptr<NodeImpl> origin) override;
 
-    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
+    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) override;
 
 #ifdef E57_DEBUG
     void                dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -420,7 +495,7 @@ public:
 
     virtual void        checkLeavesInSet(const std::set<ustring>& pathNames, std::shared_ptr<NodeImpl> origin) override;
 
-    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, CheckedFile& cf, int indent, const char* forcedFieldName=nullptr) override;
+    virtual void        writeXml(std::shared_ptr<ImageFileImpl> imf, BufferedWriter& cf, int indent, const char* forcedFieldName=nullptr) override;
 
 #ifdef E57_DEBUG
     void                dump(int indent = 0, std::ostream& os = std::cout) override;
@@ -453,9 +528,62 @@ struct E57FileHeader {
 #endif
 };
 
+//================================================================
+
+/// Size of the blocks a NodeArena hands out memory from
+#define E57_NODE_ARENA_BLOCK_SIZE (64*1024)
+
+/// Memory for the nodes read from an XML section (see ImageFileOptions::nodeArena), cut in order out of large blocks.
+/// Nothing is freed one by one: the blocks are freed together once the creator has called release() and every
+/// allocation has been deallocated, which may be long after the ImageFile is gone.
+/// Only one thread may allocate, deallocate may be called from any thread.
+class NodeArena {
+public:
+    static NodeArena*   create();
+    void                release();
+
+    void*               allocate(size_t byteCount);
+    void                deallocate(void* p);
+
+protected:
+                        NodeArena();
+                        ~NodeArena() = default;
+    void                unref();
+
+    std::atomic<size_t> refCount_;      /// creator plus allocations not yet deallocated
+    std::vector<std::unique_ptr<char[]> > blocks_;
+    char*               next_;          /// next free byte in current block
+    size_t              available_;     /// bytes left in current block
+};
+
+/// Standard allocator handing out memory from a NodeArena, for std::allocate_shared
+template <class T>
+class NodeArenaAllocator {
+public:
+    typedef T value_type;
+
+    explicit            NodeArenaAllocator(NodeArena* arena) : arena_(arena) {}
+    template <class U>  NodeArenaAllocator(const NodeArenaAllocator<U>& a) : arena_(a.arena()) {}
+
+    T*                  allocate(size_t n)          {return(static_cast<T*>(arena_->allocate(n*sizeof(T))));}
+    void                deallocate(T* p, size_t)    {arena_->deallocate(p);}
+    NodeArena*          arena() const               {return(arena_);}
+
+protected:
+    NodeArena*          arena_;
+};
+
+template <class T, class U>
+bool operator==(const NodeArenaAllocator<T>& a, const NodeArenaAllocator<U>& b) {return(a.arena() == b.arena());}
+template <class T, class U>
+bool operator!=(const NodeArenaAllocator<T>& a, const NodeArenaAllocator<U>& b) {return(a.arena() != b.arena());}
+
+//================================================================
+
 class ImageFileImpl : public std::enable_shared_from_this<ImageFileImpl> {
 public:
                     ImageFileImpl( ReadChecksumPolicy policy );
+                    ImageFileImpl( const ImageFileOptions& options );
     void            construct2(const ustring& fileName, const ustring& mode);
     std::shared_ptr<StructureNodeImpl> root();
     void            close();
@@ -489,6 +617,8 @@ public:
     void            pathNameParse(const ustring& pathName, bool& isRelative, std::vector<ustring>& fields);
     ustring         pathNameUnparse(bool isRelative, const std::vector<ustring>& fields);
 
+    std::shared_ptr<const ustring> internElementName(const ustring& elementName);
+
     unsigned        bitsNeeded(int64_t minimum, int64_t maximum);
     static void     readFileHeader(CheckedFile* file, E57FileHeader& header);
     void            incrWriterCount();
@@ -518,9 +648,12 @@ protected:
     ustring         fileName_;
     bool            isWriter_;
     int             writerCount_;
-    int             readerCount_;
+    std::atomic<int> readerCount_;  // readers may be opened and closed from several threads
 
     ReadChecksumPolicy   checksumPolicy;
+    bool            memoryMapped_;      /// map file for reading
+    bool            validateXml_;       /// validate XML section against schema when reading
+    bool            nodeArena_;         /// allocate nodes read from XML section in a NodeArena
 
     CheckedFile*    file_;
 
@@ -534,6 +667,9 @@ protected:
     /// Bidirectional map from namespace prefix to uri
     std::vector<NameSpace>  nameSpaces_;
 
+    /// One copy of each element name used in the tree, shared by all nodes with that name
+    std::unordered_map<ustring, std::shared_ptr<const ustring> > elementNames_;
+
     /// Smart pointer to metadata tree
     std::shared_ptr<StructureNodeImpl> root_;
 };
@@ -543,10 +679,33 @@ protected:
 
 class SeekIndex {
 public:
-    ///!!! implement seek
+    /// A chunk is a run of data packets whose first packet starts with the first bit of a record in every bytestream.
+    struct Chunk {
+        uint64_t    recordNumber;       /// first record in chunk
+        uint64_t    physicalOffset;     /// offset of first data packet in chunk
+    };
+
+    void        addChunk(uint64_t recordNumber, uint64_t physicalOffset);
+    const std::vector<Chunk>& chunks() const {return(chunks_);}
 #ifdef E57_DEBUG
-    void        dump(int /*indent*/ = 0, std::ostream& /*os*/ = std::cout) {/*???*/}
+    void        dump(int indent = 0, std::ostream& os = std::cout);
 #endif
+
+protected:
+    std::vector<Chunk>  chunks_;
+};
+
+//================================================================
+
+struct PacketDirectory {
+    /// Location of every data packet in a binary section, and where each bytestream buffer falls in its bytestream.
+    /// Built from the packet headers alone, lets a reader seek in files without index packets.
+    unsigned                bytestreamCount;
+    std::vector<uint64_t>   packetLogicalOffsets;       /// one per data packet
+    std::vector<uint64_t>   bytestreamStarts;           /// bytes in earlier packets, [packetIndex*bytestreamCount + bytestreamNumber], extra last row holds totals
+
+    uint64_t    bytestreamStart(size_t packetIndex, unsigned bytestreamNumber) const
+                                                        {return(bytestreamStarts.at(packetIndex*bytestreamCount + bytestreamNumber));}
 };
 
 //================================================================
@@ -663,10 +822,12 @@ class PacketReadCache;
 
 class CompressedVectorReaderImpl {
 public:
-                CompressedVectorReaderImpl(std::shared_ptr<CompressedVectorNodeImpl> ni, std::vector<SourceDestBuffer>& dbufs);
+                CompressedVectorReaderImpl(std::shared_ptr<CompressedVectorNodeImpl> ni, std::vector<SourceDestBuffer>& dbufs,
+                                           const CompressedVectorReaderOptions& options);
                 ~CompressedVectorReaderImpl();
     unsigned    read();
     unsigned    read(std::vector<SourceDestBuffer>& dbufs);
+    uint64_t    readAll(std::vector<SourceDestBuffer>& dbufs, unsigned threadCount);
     void        seek(uint64_t recordNumber);
     bool        isOpen() const;
     std::shared_ptr<CompressedVectorNodeImpl> compressedVectorNode() const;
@@ -683,6 +844,11 @@ protected:
     uint64_t    earliestPacketNeededForInput() const;
     void        feedPacketToDecoders(uint64_t currentPacketLogicalOffset);
     uint64_t    findNextDataPacket(uint64_t nextPacketLogicalOffset);
+    void        seekIndexLookup(uint64_t recordNumber, uint64_t& chunkRecordNumber, uint64_t& chunkLogicalOffset);
+    void        seekChunkStart(uint64_t chunkRecordNumber, uint64_t chunkLogicalOffset);
+    void        seekPacketDirectory(uint64_t recordNumber);
+    std::shared_ptr<PacketDirectory> packetDirectory();
+    void        skipRecords(uint64_t recordNumber);
 
     //??? no default ctor, copy, assignment?
 
@@ -692,17 +858,21 @@ protected:
     std::shared_ptr<NodeImpl>                 proto_;
     std::vector<DecodeChannel>                  channels_;
     PacketReadCache*                            cache_;
+    CompressedVectorReaderOptions               options_;
 
     uint64_t    recordCount_;                   /// number of records written so far
     uint64_t    maxRecordCount_;
     uint64_t    sectionEndLogicalOffset_;
+    uint64_t    dataLogicalOffset_;             /// first data packet
+    uint64_t    indexPhysicalOffset_;           /// top level index packet, or zero if no index
 };
 
 //================================================================
 
 class CompressedVectorWriterImpl {
 public:
-                CompressedVectorWriterImpl(std::shared_ptr<CompressedVectorNodeImpl> ni, std::vector<SourceDestBuffer>& sbufs);
+                CompressedVectorWriterImpl(std::shared_ptr<CompressedVectorNodeImpl> ni, std::vector<SourceDestBuffer>& sbufs,
+                                           const CompressedVectorWriterOptions& options);
                 ~CompressedVectorWriterImpl();
     void        write(const size_t requestedRecordCount);
     void        write(std::vector<SourceDestBuffer>& sbufs, const size_t requestedRecordCount);
@@ -722,6 +892,15 @@ protected:
     size_t      currentPacketSize() const;
     uint64_t    packetWrite();
     void        flush();
+    void        indexWrite();
+    void        encodeRecords(uint64_t targetRecordIndex);
+    void        encodeBytestreams();
+    void        encoderThread();
+    void        encoderThreadsStop();
+    void        ioPacketQueue(uint64_t logicalOffset, unsigned length);
+    void        ioWait();
+    void        ioThread();
+    void        ioThreadStop();
 
     //??? no default ctor, copy, assignment?
 
@@ -731,7 +910,7 @@ protected:
 
     std::vector<std::shared_ptr<Encoder> >  bytestreams_;
     SeekIndex               seekIndex_;
-    DataPacket              dataPacket_;
+    std::unique_ptr<DataPacket> dataPacket_;                /// packet being assembled
 
     bool                    isOpen_;
     uint64_t                sectionHeaderLogicalStart_;     /// start of CompressedVector binary section
@@ -741,6 +920,41 @@ protected:
     uint64_t                recordCount_;                   /// number of records written so far
     uint64_t                dataPacketsCount_;              /// number of data packets written so far
     uint64_t                indexPacketsCount_;             /// number of index packets written so far
+
+    /// Chunks of data packets are only cut, and indexed, if writeIndex_
+    bool                    writeIndex_;
+    uint64_t                chunkStartPacketsCount_;        /// dataPacketsCount_ when current chunk started
+    uint64_t                chunkEndRecordIndex_;           /// record where current chunk will end, or zero if not decided yet
+    bool                    chunkStartPending_;             /// next data packet written starts a chunk
+    uint64_t                chunkStartRecordIndex_;         /// first record of pending chunk
+
+    /// Pool of threads that encode bytestreams, started on first write if encoderThreadCount_ > 1.
+    /// Each round, the threads and the caller take bytestreams from encoderNextStream_ until all are brought up to encoderTargetRecordIndex_.
+    /// Everything but encoderNextStream_ is guarded by encoderMutex_.
+    unsigned                encoderThreadCount_;            /// threads encoding, including the caller
+    std::vector<std::thread> encoderThreads_;
+    std::mutex              encoderMutex_;
+    std::condition_variable encoderStart_;                  /// signalled when a round starts, or the threads must stop
+    std::condition_variable encoderDone_;                   /// signalled when the last thread finishes a round
+    uint64_t                encoderRound_;                  /// incremented for each round
+    bool                    encoderStop_;
+    unsigned                encoderBusyCount_;              /// threads still working on current round
+    uint64_t                encoderTargetRecordIndex_;
+    std::atomic<size_t>     encoderNextStream_;             /// index in bytestreams_ of next bytestream to take
+    std::exception_ptr      encoderError_;                  /// first exception thrown in current round
+
+    /// Background packet writing, if backgroundWrite_.  ioThread_ checksums and writes ioPacket_ while the next packet is assembled in dataPacket_.
+    /// At most one packet is in flight.  ioPending_, ioStop_ and ioError_ are guarded by ioMutex_.
+    bool                    backgroundWrite_;
+    std::unique_ptr<DataPacket> ioPacket_;
+    uint64_t                ioLogicalOffset_;
+    unsigned                ioLength_;
+    std::thread             ioThread_;                      /// started on first packet written
+    std::mutex              ioMutex_;
+    std::condition_variable ioCond_;                        /// signalled when a packet is queued, written, or the thread must stop
+    bool                    ioPending_;                     /// ioPacket_ queued and not yet written
+    bool                    ioStop_;
+    std::exception_ptr      ioError_;                       /// first exception thrown by a write, stays set
 };
 
 //================================================================
@@ -767,10 +981,11 @@ protected:
 
 class PacketReadCache {
 public:
-                        PacketReadCache(CheckedFile* cFile, unsigned packetCount);
+                        PacketReadCache(CheckedFile* cFile, unsigned packetCount, unsigned readAheadCount = 0);
                         ~PacketReadCache();
 
     std::unique_ptr<PacketLock> lock(uint64_t packetLogicalOffset, char* &pkt);  //??? pkt could be const
+    void                readAhead(uint64_t packetLogicalOffset, uint64_t sectionEndLogicalOffset);
 
 #ifdef E57_DEBUG
       void                dump(int indent = 0, std::ostream& os = std::cout);
@@ -780,18 +995,45 @@ protected:
     friend class PacketLock;
     void                unlock(unsigned cacheIndex);
 
-    void                readPacket(unsigned oldestEntry, uint64_t packetLogicalOffset);
+    unsigned            readPacket(char* buffer, uint64_t packetLogicalOffset);
+    void                makeMostRecent(unsigned entry);
+    bool                takeReadAhead(unsigned entry, uint64_t packetLogicalOffset);
+    void                readAheadThread();
+
+    /// Marks the ends of the LRU list
+    static const unsigned NO_ENTRY = ~0U;
 
     struct CacheEntry {
-        uint64_t    logicalOffset_;
-        char*       buffer_;  //??? could be const?
-        unsigned    lastUsed_;
+        uint64_t    logicalOffset_;     /// zero if entry holds no packet
+        char*       buffer_;            /// allocated on first use  //??? could be const?
+        unsigned    newer_;             /// next more recently used entry, or NO_ENTRY
+        unsigned    older_;             /// next less recently used entry, or NO_ENTRY
     };
 
     unsigned            lockCount_;
-    unsigned            useCount_;
     CheckedFile*        cFile_;
     std::vector<CacheEntry>  entries_;
+    std::unordered_map<uint64_t, unsigned> index_;  /// packetLogicalOffset -> entry holding it
+    unsigned            newest_;        /// head of LRU list
+    unsigned            oldest_;        /// tail of LRU list, next entry to be reused
+
+    /// Packets read by the background thread wait in a slot until lock() asks for them.
+    /// The slots and the request are shared with the thread, and guarded by readAheadMutex_.
+    struct ReadAheadSlot {
+        uint64_t    logicalOffset_;     /// zero if slot is free
+        char*       buffer_;            /// allocated on first use
+        unsigned    length_;            /// packet length, valid when ready_
+        bool        ready_;             /// false while the thread is reading into the slot
+    };
+
+    std::vector<ReadAheadSlot> readAheadSlots_;
+    uint64_t            readAheadStart_;        /// first packet to read ahead, zero if no request
+    uint64_t            readAheadEnd_;          /// don't read at or past this offset
+    bool                readAheadPending_;      /// request not yet completed by thread
+    bool                readAheadStop_;
+    std::mutex          readAheadMutex_;
+    std::condition_variable readAheadCondition_;
+    std::thread         readAheadThread_;       /// started on first readAhead() call
 };
 
 } /// end namespace e57
@@ -24,6 +24,10 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cctype>
+#include <limits>
+
+#ifndef E57_BUILTIN_XML_PARSER
 #include <xercesc/sax2/Attributes.hpp>
 #include <xercesc/sax2/XMLReaderFactory.hpp>
 
@@ -31,6 +35,7 @@
 #include <xercesc/util/TransService.hpp>
 
 XERCES_CPP_NAMESPACE_USE
+#endif
 
 #include "E57FoundationImpl.h"
 
@@ -41,49 +46,29 @@ using namespace std;
 
 
 // define convenient constants for the attribute names
-static const XMLCh att_minimum[] = {
-    chLatin_m, chLatin_i, chLatin_n, chLatin_i, chLatin_m, chLatin_u,
-    chLatin_m, chNull
-};
-static const XMLCh att_maximum[] = {
-    chLatin_m, chLatin_a, chLatin_x, chLatin_i, chLatin_m, chLatin_u,
-    chLatin_m, chNull
-};
-static const XMLCh att_scale[] = {
-    chLatin_s, chLatin_c, chLatin_a, chLatin_l, chLatin_e, chNull
-};
-static const XMLCh att_offset[] = {
-    chLatin_o, chLatin_f, chLatin_f, chLatin_s, chLatin_e, chLatin_t, chNull
-};
-static const XMLCh att_precision[] = {
-    chLatin_p, chLatin_r, chLatin_e, chLatin_c, chLatin_i, chLatin_s,
-    chLatin_i, chLatin_o, chLatin_n, chNull
-};
-static const XMLCh att_allowHeterogeneousChildren[] = {
-    chLatin_a, chLatin_l, chLatin_l, chLatin_o, chLatin_w, chLatin_H,
-    chLatin_e, chLatin_t, chLatin_e, chLatin_r, chLatin_o, chLatin_g,
-    chLatin_e, chLatin_n, chLatin_e, chLatin_o, chLatin_u, chLatin_s,
-    chLatin_C, chLatin_h, chLatin_i, chLatin_l, chLatin_d, chLatin_r,
-    chLatin_e, chLatin_n, chNull
-};
-static const XMLCh att_fileOffset[] = {
-    chLatin_f, chLatin_i, chLatin_l, chLatin_e, chLatin_O, chLatin_f,
-    chLatin_f, chLatin_s, chLatin_e, chLatin_t, chNull
-};
-
-static const XMLCh att_type[] = {
-    chLatin_t, chLatin_y, chLatin_p, chLatin_e, chNull
-};
-static const XMLCh att_length[] = {
-    chLatin_l, chLatin_e, chLatin_n, chLatin_g, chLatin_t, chLatin_h,
-    chNull
-};
-static const XMLCh att_recordCount[] = {
-    chLatin_r, chLatin_e, chLatin_c, chLatin_o, chLatin_r, chLatin_d,
-    chLatin_C, chLatin_o, chLatin_u, chLatin_n, chLatin_t, chNull
-};
-
+static const char att_minimum[] = "minimum";
+static const char att_maximum[] = "maximum";
+static const char att_scale[] = "scale";
+static const char att_offset[] = "offset";
+static const char att_precision[] = "precision";
+static const char att_allowHeterogeneousChildren[] = "allowHeterogeneousChildren";
+static const char att_fileOffset[] = "fileOffset";
+
+static const char att_type[] = "type";
+static const char att_length[] = "length";
+static const char att_recordCount[] = "recordCount";
+
+/// Single precision values are written as the shortest string that reads back as the same float.  Read as a double,
+/// that string can lie just outside the float range, e.g. "3.4028235e+38" for E57_FLOAT_MAX, so read it as a float.
+static double parseFloatText(const ustring& s, FloatPrecision precision)
+{
+    //??? use exact rounding library
+    if (precision == E57_SINGLE)
+        return(strtof(s.c_str(), nullptr));
+    return(atof(s.c_str()));
+}
 
+#ifndef E57_BUILTIN_XML_PARSER
 class E57FileInputStream : public BinInputStream
 {
 public :
@@ -165,6 +150,7 @@ BinInputStream* E57FileInputSource::makeStream() const
 {
     return new E57FileInputStream(cf_, logicalStart_, logicalLength_);
 }
+#endif
 
 
 
@@ -207,48 +193,47 @@ void E57XmlParser::ParseInfo::dump(int indent, ostream& os)
 }
 
 E57XmlParser::E57XmlParser(std::shared_ptr<ImageFileImpl> imf)
-: imf_(imf)
+: imf_(imf), nodeArena_(nullptr)
 {
+    if (imf_->nodeArena_)
+        nodeArena_ = NodeArena::create();
 }
 
 E57XmlParser::~E57XmlParser()
 {
+    /// Nodes we created keep the arena alive as long as they need it
+    if (nodeArena_ != nullptr)
+        nodeArena_->release();
 }
 
-
-void E57XmlParser::startDocument()
-{
-#ifdef E57_MAX_VERBOSE
-    cout << "startDocument" << endl;
-#endif
-}
-
-
-void E57XmlParser::endDocument()
+template <class T, class... Args>
+shared_ptr<T> E57XmlParser::newNode(Args&&... args)
 {
-#ifdef E57_MAX_VERBOSE
-    cout << "endDocument"<<endl;
-#endif
+    /// In an arena, node and its shared_ptr control block come from one allocation
+    if (nodeArena_ != nullptr)
+        return(allocate_shared<T>(NodeArenaAllocator<T>(nodeArena_), std::forward<Args>(args)...));
+    else
+        return(shared_ptr<T>(new T(std::forward<Args>(args)...)));
 }
 
 
-void E57XmlParser::startElement(const   XMLCh* const    uri,
-                                const   XMLCh* const    localName,
-                                const   XMLCh* const    qName,
-                                const   Attributes&     attributes)
+void E57XmlParser::elementStart(const ustring&          uri,
+                                const ustring&          localName,
+                                const ustring&          qName,
+                                const E57XmlAttributes& attributes)
 {
 #ifdef E57_MAX_VERBOSE
     cout << "startElement" << endl;
-    cout << space(2) << "URI:       " << toUString(uri) << endl;
-    cout << space(2) << "localName: " << toUString(localName) << endl;
-    cout << space(2) << "qName:     " << toUString(qName) << endl;
+    cout << space(2) << "URI:       " << uri << endl;
+    cout << space(2) << "localName: " << localName << endl;
+    cout << space(2) << "qName:     " << qName << endl;
 
-    for (size_t i = 0; i < attributes.getLength(); i++) {
+    for (size_t i = 0; i < attributes.size(); i++) {
         cout << space(2) << "Attribute[" << i << "]" << endl;
-        cout << space(4) << "URI:       " << toUString(attributes.getURI(i)) << endl;
-        cout << space(4) << "localName: " << toUString(attributes.getLocalName(i)) << endl;
-        cout << space(4) << "qName:     " << toUString(attributes.getQName(i)) << endl;
-        cout << space(4) << "value:     " << toUString(attributes.getValue(i)) << endl;
+        cout << space(4) << "URI:       " << attributes[i].uri.str() << endl;
+        cout << space(4) << "localName: " << attributes[i].localName.str() << endl;
+        cout << space(4) << "qName:     " << attributes[i].qName.str() << endl;
+        cout << space(4) << "value:     " << attributes[i].value.str() << endl;
     }
 #endif
     /// Get Type attribute
@@ -364,9 +349,9 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
                 throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                      "precisionString=" + precision_str
                                      + " fileName=" + imf_->fileName()
-                                     + " uri=" + toUString(uri)
-                                     + " localName=" + toUString(localName)
-                                     + " qName=" + toUString(qName));
+                                     + " uri=" + uri
+                                     + " localName=" + localName
+                                     + " qName=" + qName);
             }
         } else {
             /// Not defined defined in XML, so defaults to double
@@ -375,7 +360,7 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
 
         if (isAttributeDefined(attributes, att_minimum)) {
             ustring minimum_str = lookupAttribute(attributes, att_minimum);
-            pi.floatMinimum = atof(minimum_str.c_str());  //??? use exact rounding library
+            pi.floatMinimum = parseFloatText(minimum_str, pi.precision);
         } else {
             /// Not defined defined in XML, so defaults to E57_FLOAT_MIN or E57_DOUBLE_MIN
             if (pi.precision == E57_SINGLE)
@@ -386,7 +371,7 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
 
         if (isAttributeDefined(attributes, att_maximum)) {
             ustring maximum_str = lookupAttribute(attributes, att_maximum);
-            pi.floatMaximum = atof(maximum_str.c_str());  //??? use exact rounding library
+            pi.floatMaximum = parseFloatText(maximum_str, pi.precision);
         } else {
             /// Not defined defined in XML, so defaults to FLOAT_MAX or DOUBLE_MAX
             if (pi.precision == E57_SINGLE)
@@ -442,26 +427,26 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
         pi.nodeType = E57_STRUCTURE;
 
         /// Read name space decls, if e57Root element
-        if (toUString(localName) == "e57Root") {
+        if (localName == "e57Root") {
             /// Search attributes for namespace declarations (only allowed in E57Root structure)
             bool gotDefault = false;
-            for (size_t i = 0; i < attributes.getLength(); i++) {
+            for (size_t i = 0; i < attributes.size(); i++) {
                 /// Check if declaring the default namespace
-                if (toUString(attributes.getQName(i)) == "xmlns") {
+                if (attributes[i].qName.equals("xmlns")) {
 #ifdef E57_VERBOSE
-                    cout << "declared default namespace, URI=" << toUString(attributes.getValue(i)) << endl;
+                    cout << "declared default namespace, URI=" << attributes[i].value.str() << endl;
 #endif
-                    imf_->extensionsAdd("", toUString(attributes.getValue(i)));
+                    imf_->extensionsAdd("", attributes[i].value.str());
                     gotDefault = true;
                 }
 
                 /// Check if declaring a namespace
-                if (toUString(attributes.getURI(i)) == "http://www.w3.org/2000/xmlns/") {
+                if (attributes[i].uri.equals("http://www.w3.org/2000/xmlns/")) {
 #ifdef E57_VERBOSE
-                    cout << "declared extension, prefix=" << toUString(attributes.getLocalName(i))
-                         << " URI=" << toUString(attributes.getValue(i)) << endl;
+                    cout << "declared extension, prefix=" << attributes[i].localName.str()
+                         << " URI=" << attributes[i].value.str() << endl;
 #endif
-                    imf_->extensionsAdd(toUString(attributes.getLocalName(i)), toUString(attributes.getValue(i)));
+                    imf_->extensionsAdd(attributes[i].localName.str(), attributes[i].value.str());
                 }
             }
 
@@ -469,18 +454,18 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
             if (!gotDefault) {
                 throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                      "fileName=" + imf_->fileName()
-                                     + " uri=" + toUString(uri)
-                                     + " localName=" + toUString(localName)
-                                     + " qName=" + toUString(qName));
+                                     + " uri=" + uri
+                                     + " localName=" + localName
+                                     + " qName=" + qName);
             }
         }
 
         /// Create container now, so can hold children
-        shared_ptr<StructureNodeImpl> s_ni(new StructureNodeImpl(imf_));
+        shared_ptr<StructureNodeImpl> s_ni(newNode<StructureNodeImpl>(imf_));
         pi.container_ni = s_ni;
 
         /// After have Structure, check again if E57Root, if so mark attached so all children will be attached when added
-        if (toUString(localName) == "e57Root")
+        if (localName == "e57Root")
             s_ni->setAttachedRecursive();
 
         /// Push info so far onto stack
@@ -508,9 +493,9 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
                 throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                      "allowHeterogeneousChildren=" + toString(i64)
                                      + "fileName=" + imf_->fileName()
-                                     + " uri=" + toUString(uri)
-                                     + " localName=" + toUString(localName)
-                                     + " qName=" + toUString(qName));
+                                     + " uri=" + uri
+                                     + " localName=" + localName
+                                     + " qName=" + qName);
             }
         } else {
             /// Not defined defined in XML, so defaults to false
@@ -518,7 +503,7 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
         }
 
         /// Create container now, so can hold children
-        shared_ptr<VectorNodeImpl> v_ni(new VectorNodeImpl(imf_, pi.allowHeterogeneousChildren));
+        shared_ptr<VectorNodeImpl> v_ni(newNode<VectorNodeImpl>(imf_, pi.allowHeterogeneousChildren));
         pi.container_ni = v_ni;
 
         /// Push info so far onto stack
@@ -550,7 +535,7 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
 #endif
 
         /// Create container now, so can hold children
-        shared_ptr<CompressedVectorNodeImpl> cv_ni(new CompressedVectorNodeImpl(imf_));
+        shared_ptr<CompressedVectorNodeImpl> cv_ni(newNode<CompressedVectorNodeImpl>(imf_));
         cv_ni->setRecordCount(pi.recordCount);
         cv_ni->setBinarySectionLogicalStart(imf_->file_->physicalToLogical(pi.fileOffset));  //??? what if file_ is NULL?
         pi.container_ni = cv_ni;
@@ -561,18 +546,18 @@ void E57XmlParser::startElement(const   XMLCh* const    uri,
         throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                              "nodeType=" + node_type
                              + " fileName=" + imf_->fileName()
-                             + " uri=" + toUString(uri)
-                             + " localName=" + toUString(localName)
-                             + " qName=" + toUString(qName));
+                             + " uri=" + uri
+                             + " localName=" + localName
+                             + " qName=" + qName);
     }
 #ifdef E57_MAX_VERBOSE
     pi.dump(4);
 #endif
 }
 
-void E57XmlParser::endElement(const XMLCh* const uri,
-                              const XMLCh* const localName,
-                              const XMLCh* const qName)
+void E57XmlParser::elementEnd(const ustring& uri,
+                              const ustring& localName,
+                              const ustring& qName)
 {
 #ifdef E57_MAX_VERBOSE
     cout << "endElement" << endl;
@@ -609,7 +594,7 @@ void E57XmlParser::endElement(const XMLCh* const uri,
 #endif
             } else
                 intValue = 0;
-            shared_ptr<IntegerNodeImpl> i_ni(new IntegerNodeImpl(imf_, intValue, pi.minimum, pi.maximum));
+            shared_ptr<IntegerNodeImpl> i_ni(newNode<IntegerNodeImpl>(imf_, intValue, pi.minimum, pi.maximum));
             current_ni = i_ni;
             } break;
         case E57_SCALED_INTEGER: {
@@ -625,34 +610,34 @@ void E57XmlParser::endElement(const XMLCh* const uri,
 #endif
             } else
                 intValue = 0;
-            shared_ptr<ScaledIntegerNodeImpl> si_ni(new ScaledIntegerNodeImpl(imf_, intValue, pi.minimum, pi.maximum, pi.scale, pi.offset));
+            shared_ptr<ScaledIntegerNodeImpl> si_ni(newNode<ScaledIntegerNodeImpl>(imf_, intValue, pi.minimum, pi.maximum, pi.scale, pi.offset));
             current_ni = si_ni;
             } break;
         case E57_FLOAT: {
             /// Convert child text (if any) to value, else default to 0.0
             double floatValue;
             if (pi.childText.length() > 0)
-                floatValue = atof(pi.childText.c_str());
+                floatValue = parseFloatText(pi.childText, pi.precision);
             else
                 floatValue = 0.0;
-            shared_ptr<FloatNodeImpl> f_ni(new FloatNodeImpl(imf_, floatValue, pi.precision, pi.floatMinimum, pi.floatMaximum));
+            shared_ptr<FloatNodeImpl> f_ni(newNode<FloatNodeImpl>(imf_, floatValue, pi.precision, pi.floatMinimum, pi.floatMaximum));
             current_ni = f_ni;
             } break;
         case E57_STRING: {
-            shared_ptr<StringNodeImpl> s_ni(new StringNodeImpl(imf_, pi.childText));
+            shared_ptr<StringNodeImpl> s_ni(newNode<StringNodeImpl>(imf_, pi.childText));
             current_ni = s_ni;
             } break;
         case E57_BLOB: {
-            shared_ptr<BlobNodeImpl> b_ni(new BlobNodeImpl(imf_, pi.fileOffset, pi.length));
+            shared_ptr<BlobNodeImpl> b_ni(newNode<BlobNodeImpl>(imf_, pi.fileOffset, pi.length));
             current_ni = b_ni;
             } break;
         default:
             throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
                                  "nodeType=" + toString(pi.nodeType)
                                  + " fileName=" + imf_->fileName()
-                                 + " uri=" + toUString(uri)
-                                 + " localName=" + toUString(localName)
-                                 + " qName=" + toUString(qName));
+                                 + " uri=" + uri
+                                 + " localName=" + localName
+                                 + " qName=" + qName);
     }
 #ifdef E57_MAX_VERBOSE
     current_ni->dump(4);
@@ -665,9 +650,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                  "currentType=" + toString(current_ni->type())
                                  + " fileName=" + imf_->fileName()
-                                 + " uri=" + toUString(uri)
-                                 + " localName=" + toUString(localName)
-                                 + " qName=" + toUString(qName));
+                                 + " uri=" + uri
+                                 + " localName=" + localName
+                                 + " qName=" + qName);
         }
         imf_->root_ = dynamic_pointer_cast<StructureNodeImpl>(current_ni);
         return;
@@ -678,9 +663,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
     if (!parent_ni) {
         throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                              "fileName=" + imf_->fileName()
-                             + " uri=" + toUString(uri)
-                             + " localName=" + toUString(localName)
-                             + " qName=" + toUString(qName));
+                             + " uri=" + uri
+                             + " localName=" + localName
+                             + " qName=" + qName);
     }
 
     /// Add current node into parent at top of stack
@@ -689,7 +674,7 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             shared_ptr<StructureNodeImpl> struct_ni = dynamic_pointer_cast<StructureNodeImpl>(parent_ni);
 
             /// Add named child to structure
-            struct_ni->set(toUString(qName), current_ni);
+            struct_ni->set(qName, current_ni);
             } break;
         case E57_VECTOR: {
             shared_ptr<VectorNodeImpl> vector_ni = dynamic_pointer_cast<VectorNodeImpl>(parent_ni);
@@ -699,7 +684,7 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             } break;
         case E57_COMPRESSED_VECTOR: {
             shared_ptr<CompressedVectorNodeImpl> cv_ni = dynamic_pointer_cast<CompressedVectorNodeImpl>(parent_ni);
-            ustring uQName = toUString(qName);
+            ustring uQName = qName;
 
             /// n can be either prototype or codecs
             if (uQName == "prototype")
@@ -709,9 +694,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
                     throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                          "currentType=" + toString(current_ni->type())
                                          + " fileName=" + imf_->fileName()
-                                         + " uri=" + toUString(uri)
-                                         + " localName=" + toUString(localName)
-                                         + " qName=" + toUString(qName));
+                                         + " uri=" + uri
+                                         + " localName=" + localName
+                                         + " qName=" + qName);
                 }
                 shared_ptr<VectorNodeImpl> vi = dynamic_pointer_cast<VectorNodeImpl>(current_ni);
 
@@ -720,9 +705,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
                     throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                          "currentType=" + toString(current_ni->type())
                                          + " fileName=" + imf_->fileName()
-                                         + " uri=" + toUString(uri)
-                                         + " localName=" + toUString(localName)
-                                         + " qName=" + toUString(qName));
+                                         + " uri=" + uri
+                                         + " localName=" + localName
+                                         + " qName=" + qName);
                 }
 
                 cv_ni->setCodecs(vi);
@@ -730,9 +715,9 @@ void E57XmlParser::endElement(const XMLCh* const uri,
                 /// Found unknown XML child element of CompressedVector, not prototype or codecs
                 throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                      + "fileName=" + imf_->fileName()
-                                     + " uri=" + toUString(uri)
-                                     + " localName=" + toUString(localName)
-                                     + " qName=" + toUString(qName));
+                                     + " uri=" + uri
+                                     + " localName=" + localName
+                                     + " qName=" + qName);
             }
         } break;
         default:
@@ -740,28 +725,17 @@ void E57XmlParser::endElement(const XMLCh* const uri,
             throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT,
                                  "parentType=" + toString(parent_ni->type())
                                  + " fileName=" + imf_->fileName()
-                                 + " uri=" + toUString(uri)
-                                 + " localName=" + toUString(localName)
-                                 + " qName=" + toUString(qName));
+                                 + " uri=" + uri
+                                 + " localName=" + localName
+                                 + " qName=" + qName);
     }
 }
 
 
-void E57XmlParser::processingInstruction(const XMLCh* const /*target*/,
-                                         const XMLCh* const /*data*/)
+void E57XmlParser::elementCharacters(const char* chars, size_t length)
 {
 #ifdef E57_MAX_VERBOSE
-    cout << "processingInstruction" << endl;
-#endif
-}
-
-
-void E57XmlParser::characters(const   XMLCh* const chars,
-                              const   XMLSize_t    length)
-{
-//??? use length to make ustring
-#ifdef E57_MAX_VERBOSE
-    cout << "characters, chars=\"" << toUString(chars) << "\" length=" << length << endl;
+    cout << "characters, chars=\"" << ustring(chars, length) << "\" length=" << length << endl;
 #endif
     /// Get active element
     ParseInfo& pi = stack_.top();
@@ -773,14 +747,109 @@ void E57XmlParser::characters(const   XMLCh* const chars,
         case E57_COMPRESSED_VECTOR:
         case E57_BLOB: {
             /// If characters aren't whitespace, have an error, else ignore
-            ustring s = toUString(chars);
-            if (s.find_first_not_of(" \t\n\r") != string::npos)
-                throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT, "chars=" + toUString(chars));
+            for (size_t i = 0; i < length; i++) {
+                if (chars[i] != ' ' && chars[i] != '\t' && chars[i] != '\n' && chars[i] != '\r')
+                    throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT, "chars=" + ustring(chars, length));
+            }
             } break;
         default:
             /// Append to any previous characters
-            pi.childText += toUString(chars);
+            pi.childText.append(chars, length);
+    }
+}
+
+ustring E57XmlParser::lookupAttribute(const E57XmlAttributes& attributes, const char* attribute_name)
+{
+    for (size_t i = 0; i < attributes.size(); i++) {
+        if (attributes[i].qName.equals(attribute_name))
+            return(attributes[i].value.str());
+    }
+    throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT, "attributeName=" + ustring(attribute_name));
+}
+
+bool E57XmlParser::isAttributeDefined(const E57XmlAttributes& attributes, const char* attribute_name)
+{
+    for (size_t i = 0; i < attributes.size(); i++) {
+        if (attributes[i].qName.equals(attribute_name))
+            return(true);
     }
+    return(false);
+}
+
+#ifndef E57_BUILTIN_XML_PARSER
+///================================================================
+/// Xerces SAX2 backend, transcodes the events to UTF-8 and passes them to the element handlers
+
+static E57XmlString keepString(vector<ustring>& strings, const ustring& s)
+{
+    /// strings must have been reserved big enough that push_back doesn't reallocate
+    strings.push_back(s);
+    return(E57XmlString(strings.back().data(), strings.back().length()));
+}
+
+void E57XmlParser::startDocument()
+{
+#ifdef E57_MAX_VERBOSE
+    cout << "startDocument" << endl;
+#endif
+}
+
+
+void E57XmlParser::endDocument()
+{
+#ifdef E57_MAX_VERBOSE
+    cout << "endDocument"<<endl;
+#endif
+}
+
+
+void E57XmlParser::startElement(const   XMLCh* const    uri,
+                                const   XMLCh* const    localName,
+                                const   XMLCh* const    qName,
+                                const   Attributes&     attributes)
+{
+    /// Transcode the attributes, the strings have to live until elementStart returns
+    XMLSize_t attributeCount = attributes.getLength();
+    vector<ustring> strings;
+    strings.reserve(4 * attributeCount);
+
+    E57XmlAttributes utf8Attributes(attributeCount);
+    for (XMLSize_t i = 0; i < attributeCount; i++) {
+        utf8Attributes[i].uri       = keepString(strings, toUString(attributes.getURI(i)));
+        utf8Attributes[i].localName = keepString(strings, toUString(attributes.getLocalName(i)));
+        utf8Attributes[i].qName     = keepString(strings, toUString(attributes.getQName(i)));
+        utf8Attributes[i].value     = keepString(strings, toUString(attributes.getValue(i)));
+    }
+
+    elementStart(toUString(uri), toUString(localName), toUString(qName), utf8Attributes);
+}
+
+
+void E57XmlParser::endElement(const XMLCh* const uri,
+                              const XMLCh* const localName,
+                              const XMLCh* const qName)
+{
+    elementEnd(toUString(uri), toUString(localName), toUString(qName));
+}
+
+
+void E57XmlParser::processingInstruction(const XMLCh* const /*target*/,
+                                         const XMLCh* const /*data*/)
+{
+#ifdef E57_MAX_VERBOSE
+    cout << "processingInstruction" << endl;
+#endif
+}
+
+
+void E57XmlParser::characters(const   XMLCh* const chars,
+                              const   XMLSize_t    length)
+{
+    /// chars isn't promised to be null terminated, so transcode exactly length of them
+    if (length == 0)
+        return;
+    TranscodeToStr UTF8Transcoder(chars, length, "UTF-8");
+    elementCharacters(reinterpret_cast<const char*>(UTF8Transcoder.str()), UTF8Transcoder.length());
 }
 
 void E57XmlParser::error(const SAXParseException& ex)
@@ -821,16 +890,604 @@ ustring E57XmlParser::toUString(const XMLCh* const xml_str)
     return(u_str);
 }
 
-ustring E57XmlParser::lookupAttribute(const Attributes& attributes, const XMLCh* attribute_name)
+#else
+///================================================================
+/// Built-in backend, a pull parser for the XML written in E57 files (UTF-8, no DTD).
+/// It works in place on a buffer holding the whole XML section: names and values are returned
+/// as pointers into the buffer, and entity and line end translation overwrite the buffer.
+
+static const char xmlnsUri[] = "http://www.w3.org/2000/xmlns/";
+static const char xmlUri[]   = "http://www.w3.org/XML/1998/namespace";
+
+namespace {
+    const uint32_t invalidCode = 0xFFFFFFFF;
+
+    /// Decodes the UTF-8 sequence at c, setting length to the number of bytes it takes.
+    /// Returns invalidCode for malformed or overlong sequences, surrogates, and code points above 0x10FFFF.
+    uint32_t utf8Decode(const char* c, const char* end, size_t& length)
+    {
+        unsigned char b = static_cast<unsigned char>(c[0]);
+        length = 1;
+        if (b < 0x80)
+            return(b);
+
+        uint32_t code;
+        uint32_t minimum;
+        if ((b & 0xE0) == 0xC0) {
+            length  = 2;
+            code    = b & 0x1F;
+            minimum = 0x80;
+        } else if ((b & 0xF0) == 0xE0) {
+            length  = 3;
+            code    = b & 0x0F;
+            minimum = 0x800;
+        } else if ((b & 0xF8) == 0xF0) {
+            length  = 4;
+            code    = b & 0x07;
+            minimum = 0x10000;
+        } else
+            return(invalidCode);
+
+        if (static_cast<size_t>(end - c) < length)
+            return(invalidCode);
+        for (size_t i = 1; i < length; i++) {
+            unsigned char continuation = static_cast<unsigned char>(c[i]);
+            if ((continuation & 0xC0) != 0x80)
+                return(invalidCode);
+            code = (code << 6) | (continuation & 0x3F);
+        }
+        if (code < minimum || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+            return(invalidCode);
+        return(code);
+    }
+
+    /// Char production of XML 1.0
+    bool isXmlChar(uint32_t code)
+    {
+        if (code < 0x20)
+            return(code == '\t' || code == '\n' || code == '\r');
+        return(code <= 0xD7FF || (code >= 0xE000 && code <= 0xFFFD) || (code >= 0x10000 && code <= 0x10FFFF));
+    }
+
+    /// NameStartChar production of XML 1.0 (fifth edition)
+    bool isNameStartChar(uint32_t code)
+    {
+        if (code < 0x80)
+            return(isalpha(static_cast<int>(code)) || code == '_' || code == ':');
+        return((code >= 0xC0 && code <= 0xD6) || (code >= 0xD8 && code <= 0xF6) || (code >= 0xF8 && code <= 0x2FF)
+               || (code >= 0x370 && code <= 0x37D) || (code >= 0x37F && code <= 0x1FFF) || (code >= 0x200C && code <= 0x200D)
+               || (code >= 0x2070 && code <= 0x218F) || (code >= 0x2C00 && code <= 0x2FEF) || (code >= 0x3001 && code <= 0xD7FF)
+               || (code >= 0xF900 && code <= 0xFDCF) || (code >= 0xFDF0 && code <= 0xFFFD) || (code >= 0x10000 && code <= 0xEFFFF));
+    }
+
+    /// NameChar production of XML 1.0 (fifth edition)
+    bool isNameChar(uint32_t code)
+    {
+        if (code < 0x80)
+            return(isalnum(static_cast<int>(code)) || code == '_' || code == ':' || code == '-' || code == '.');
+        return(isNameStartChar(code) || code == 0xB7 || (code >= 0x300 && code <= 0x36F) || (code >= 0x203F && code <= 0x2040));
+    }
+
+    class E57XmlPullParser
+    {
+    public:
+        enum Event {START_ELEMENT, END_ELEMENT, CHARACTERS, END_DOCUMENT};
+
+                                E57XmlPullParser(char* begin, char* end);
+
+        Event                   next();
+
+        /// Current element, after START_ELEMENT or END_ELEMENT
+        const E57XmlString&     uri() const         {return(uri_);}
+        const E57XmlString&     localName() const   {return(localName_);}
+        const E57XmlString&     qName() const       {return(qName_);}
+
+        /// Attributes of current element, after START_ELEMENT
+        const E57XmlAttributes& attributes() const  {return(attributes_);}
+
+        /// Translated text, after CHARACTERS
+        const E57XmlString&     text() const        {return(text_);}
+
+    private:
+        enum TextMode {TEXT, ATTRIBUTE_VALUE, CDATA};
+
+        struct OpenElement {
+            E57XmlString    qName;
+            E57XmlString    uri;
+            E57XmlString    localName;
+            size_t          nameSpaceCount;     /// Size of nameSpaces_ before the element's declarations
+        };
+
+        struct NameSpace {
+            E57XmlString    prefix;
+            E57XmlString    uri;
+        };
+
+        void            startTag();
+        void            endTag();
+        void            popElement();
+        void            processingInstruction();
+        void            checkChars() const;
+        E57XmlString    scanName();
+        bool            skipSpace();
+        bool            lookingAt(const char* s) const;
+        char*           find(const char* s) const;
+        E57XmlString    translate(char* first, char* last, TextMode mode);
+        char*           translateReference(char* ref, char* last, char*& out);
+        void            resolve(const E57XmlString& qName, bool isAttribute, E57XmlString& uri, E57XmlString& localName);
+        E57Exception    parseError(const char* at, const ustring& message) const;
+
+        char*                   begin_;
+        char*                   end_;
+        char*                   p_;             /// Next unread char
+        bool                    sawRoot_;
+        bool                    pendingEnd_;    /// Last start tag was an empty element, END_ELEMENT is next
+
+        std::vector<OpenElement> open_;
+        std::vector<NameSpace>  nameSpaces_;    /// Namespace declarations in scope, innermost last
+
+        E57XmlString            uri_;
+        E57XmlString            localName_;
+        E57XmlString            qName_;
+        E57XmlAttributes        attributes_;
+        E57XmlString            text_;
+    };
+}
+
+E57XmlPullParser::E57XmlPullParser(char* begin, char* end)
+: begin_(begin),
+  end_(end),
+  p_(begin),
+  sawRoot_(false),
+  pendingEnd_(false)
+{
+    /// Skip UTF-8 byte order mark, if any
+    if (lookingAt("\xEF\xBB\xBF"))
+        p_ += 3;
+
+    checkChars();
+}
+
+E57XmlPullParser::Event E57XmlPullParser::next()
+{
+    if (pendingEnd_) {
+        pendingEnd_ = false;
+        popElement();
+        return(END_ELEMENT);
+    }
+
+    for (;;) {
+        if (p_ == end_) {
+            if (!open_.empty())
+                throw parseError(p_, "element not closed: " + open_.back().qName.str());
+            if (!sawRoot_)
+                throw parseError(p_, "no root element");
+            return(END_DOCUMENT);
+        }
+
+        if (*p_ != '<') {
+            char* first = p_;
+            char* last = static_cast<char*>(memchr(p_, '<', end_ - p_));
+            if (last == nullptr)
+                last = end_;
+            p_ = last;
+
+            if (open_.empty()) {
+                /// Only whitespace is allowed outside the root element
+                for (char* c = first; c < last; c++) {
+                    if (*c != ' ' && *c != '\t' && *c != '\n' && *c != '\r')
+                        throw parseError(c, "text outside of root element");
+                }
+                continue;
+            }
+            text_ = translate(first, last, TEXT);
+            return(CHARACTERS);
+        }
+
+        if (lookingAt("<?")) {
+            processingInstruction();
+        } else if (lookingAt("<!--")) {
+            char* last = find("-->");
+            if (last == nullptr)
+                throw parseError(p_, "comment not terminated");
+            p_ = last + 3;
+        } else if (lookingAt("<![CDATA[")) {
+            if (open_.empty())
+                throw parseError(p_, "CDATA section outside of root element");
+            char* first = p_ + 9;
+            char* last = find("]]>");
+            if (last == nullptr)
+                throw parseError(p_, "CDATA section not terminated");
+            p_ = last + 3;
+            text_ = translate(first, last, CDATA);
+            return(CHARACTERS);
+        } else if (lookingAt("<!")) {
+            throw parseError(p_, "document type declarations are not supported");
+        } else if (lookingAt("</")) {
+            endTag();
+            return(END_ELEMENT);
+        } else {
+            startTag();
+            return(START_ELEMENT);
+        }
+    }
+}
+
+void E57XmlPullParser::startTag()
+{
+    if (sawRoot_ && open_.empty())
+        throw parseError(p_, "more than one root element");
+    p_++;
+
+    OpenElement element;
+    element.qName = scanName();
+    element.nameSpaceCount = nameSpaces_.size();
+
+    /// Read attributes up to end of tag, remembering namespace declarations
+    attributes_.clear();
+    for (;;) {
+        bool gotSpace = skipSpace();
+        if (p_ == end_)
+            throw parseError(p_, "start tag not terminated");
+        if (*p_ == '>') {
+            p_++;
+            break;
+        }
+        if (lookingAt("/>")) {
+            p_ += 2;
+            pendingEnd_ = true;
+            break;
+        }
+        if (!gotSpace)
+            throw parseError(p_, "expected whitespace before attribute");
+
+        E57XmlAttribute attribute;
+        attribute.qName = scanName();
+        skipSpace();
+        if (p_ == end_ || *p_ != '=')
+            throw parseError(p_, "expected '=' after attribute name");
+        p_++;
+        skipSpace();
+        if (p_ == end_ || (*p_ != '"' && *p_ != '\''))
+            throw parseError(p_, "expected quoted attribute value");
+        char* first = p_ + 1;
+        char* last = static_cast<char*>(memchr(first, *p_, end_ - first));
+        if (last == nullptr)
+            throw parseError(p_, "attribute value not terminated");
+        char* lessThan = static_cast<char*>(memchr(first, '<', last - first));
+        if (lessThan != nullptr)
+            throw parseError(lessThan, "'<' not allowed in attribute value");
+        p_ = last + 1;
+        attribute.value = translate(first, last, ATTRIBUTE_VALUE);
+
+        for (size_t i = 0; i < attributes_.size(); i++) {
+            if (attributes_[i].qName.length == attribute.qName.length
+                && memcmp(attributes_[i].qName.chars, attribute.qName.chars, attribute.qName.length) == 0)
+                throw parseError(attribute.qName.chars, "duplicate attribute: " + attribute.qName.str());
+        }
+
+        if (attribute.qName.equals("xmlns")) {
+            NameSpace ns;
+            ns.uri = attribute.value;
+            nameSpaces_.push_back(ns);
+        } else if (attribute.qName.length > 6 && memcmp(attribute.qName.chars, "xmlns:", 6) == 0) {
+            NameSpace ns;
+            ns.prefix = E57XmlString(attribute.qName.chars + 6, attribute.qName.length - 6);
+            ns.uri = attribute.value;
+            nameSpaces_.push_back(ns);
+        }
+        attributes_.push_back(attribute);
+    }
+
+    /// Now all declarations of this element are known, resolve names
+    for (size_t i = 0; i < attributes_.size(); i++)
+        resolve(attributes_[i].qName, true, attributes_[i].uri, attributes_[i].localName);
+    resolve(element.qName, false, element.uri, element.localName);
+
+    open_.push_back(element);
+    sawRoot_ = true;
+    qName_     = element.qName;
+    uri_       = element.uri;
+    localName_ = element.localName;
+}
+
+void E57XmlPullParser::endTag()
+{
+    p_ += 2;
+    E57XmlString qName = scanName();
+    skipSpace();
+    if (p_ == end_ || *p_ != '>')
+        throw parseError(p_, "expected '>' at end of end tag");
+    p_++;
+
+    if (open_.empty() || open_.back().qName.length != qName.length
+        || memcmp(open_.back().qName.chars, qName.chars, qName.length) != 0)
+        throw parseError(qName.chars, "end tag doesn't match start tag: " + qName.str());
+    popElement();
+}
+
+void E57XmlPullParser::popElement()
+{
+    const OpenElement& element = open_.back();
+    qName_     = element.qName;
+    uri_       = element.uri;
+    localName_ = element.localName;
+    nameSpaces_.resize(element.nameSpaceCount);
+    open_.pop_back();
+}
+
+void E57XmlPullParser::processingInstruction()
+{
+    char* first = p_;
+    char* last = find("?>");
+    if (last == nullptr)
+        throw parseError(p_, "processing instruction not terminated");
+    p_ = last + 2;
+
+    /// Only need to look at the XML declaration, to check the encoding
+    if (last - first < 6 || memcmp(first, "<?xml", 5) != 0
+        || (first[5] != ' ' && first[5] != '\t' && first[5] != '\n' && first[5] != '\r'))
+        return;
+    for (char* c = first; c + 8 < last; c++) {
+        if (memcmp(c, "encoding", 8) != 0)
+            continue;
+        c += 8;
+        while (c < last && (*c == ' ' || *c == '=' || *c == '"' || *c == '\''))
+            c++;
+        char* name = c;
+        while (c < last && *c != '"' && *c != '\'')
+            c++;
+        ustring encoding(name, c - name);
+        for (size_t i = 0; i < encoding.length(); i++)
+            encoding[i] = static_cast<char>(toupper(encoding[i]));
+        if (encoding != "UTF-8")
+            throw parseError(name, "unsupported encoding: " + ustring(name, c - name));
+        return;
+    }
+}
+
+void E57XmlPullParser::checkChars() const
+{
+    /// Check the whole document once, so names, text, attribute values, comments and CDATA sections
+    /// are all known to be UTF-8 holding only characters XML allows.
+    const char* c = p_;
+    while (c < end_) {
+        /// Usual case, printable ASCII
+        unsigned char b = static_cast<unsigned char>(*c);
+        if (b >= 0x20 && b < 0x80) {
+            c++;
+            continue;
+        }
+
+        size_t length;
+        uint32_t code = utf8Decode(c, end_, length);
+        if (code == invalidCode)
+            throw parseError(c, "invalid UTF-8");
+        if (!isXmlChar(code))
+            throw parseError(c, "character not allowed in XML: code=" + toString(code));
+        c += length;
+    }
+}
+
+E57XmlString E57XmlPullParser::scanName()
+{
+    /// checkChars() already found the document is valid UTF-8
+    char* first = p_;
+    while (p_ < end_) {
+        size_t length;
+        uint32_t code = utf8Decode(p_, end_, length);
+        if (!(p_ == first ? isNameStartChar(code) : isNameChar(code)))
+            break;
+        p_ += length;
+    }
+    if (p_ == first)
+        throw parseError(first, "expected a name");
+    return(E57XmlString(first, p_ - first));
+}
+
+bool E57XmlPullParser::skipSpace()
+{
+    char* first = p_;
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r'))
+        p_++;
+    return(p_ != first);
+}
+
+bool E57XmlPullParser::lookingAt(const char* s) const
 {
-    XMLSize_t attr_index;
-    if (!attributes.getIndex(attribute_name, attr_index))
-        throw E57_EXCEPTION2(E57_ERROR_BAD_XML_FORMAT, "attributeName=" + toUString(attribute_name));
-    return(toUString(attributes.getValue(attr_index)));
+    size_t n = strlen(s);
+    return(static_cast<size_t>(end_ - p_) >= n && memcmp(p_, s, n) == 0);
+}
+
+char* E57XmlPullParser::find(const char* s) const
+{
+    size_t n = strlen(s);
+    for (char* c = p_; end_ - c >= static_cast<ptrdiff_t>(n); c++) {
+        c = static_cast<char*>(memchr(c, s[0], end_ - c));
+        if (c == nullptr || static_cast<size_t>(end_ - c) < n)
+            break;
+        if (memcmp(c, s, n) == 0)
+            return(c);
+    }
+    return(nullptr);
 }
 
-bool E57XmlParser::isAttributeDefined(const Attributes& attributes, const XMLCh* attribute_name)
+E57XmlString E57XmlPullParser::translate(char* first, char* last, TextMode mode)
 {
-    XMLSize_t attr_index;
-    return(attributes.getIndex(attribute_name, attr_index));
+    /// Usual case, nothing to translate
+    char* c = first;
+    while (c < last && *c != '\r' && !(*c == '&' && mode != CDATA)
+           && !(mode == ATTRIBUTE_VALUE && (*c == '\t' || *c == '\n')))
+        c++;
+    if (c == last)
+        return(E57XmlString(first, last - first));
+
+    /// Translate in place, output is never longer than input
+    char* out = c;
+    while (c < last) {
+        if (*c == '\r') {
+            /// Line ends become \n, whitespace in attribute values becomes a space
+            c++;
+            if (c < last && *c == '\n')
+                c++;
+            *out++ = (mode == ATTRIBUTE_VALUE) ? ' ' : '\n';
+        } else if (mode == ATTRIBUTE_VALUE && (*c == '\t' || *c == '\n')) {
+            c++;
+            *out++ = ' ';
+        } else if (*c == '&' && mode != CDATA) {
+            c = translateReference(c, last, out);
+        } else
+            *out++ = *c++;
+    }
+
+    /// Blank out what is left of the input, so line numbers in error messages stay right
+    for (char* blank = out; blank < last; blank++)
+        *blank = ' ';
+    return(E57XmlString(first, out - first));
 }
+
+char* E57XmlPullParser::translateReference(char* ref, char* last, char*& out)
+{
+    char* semicolon = static_cast<char*>(memchr(ref, ';', last - ref));
+    if (semicolon == nullptr)
+        throw parseError(ref, "reference not terminated");
+    E57XmlString name(ref + 1, semicolon - ref - 1);
+
+    if (name.equals("lt"))
+        *out++ = '<';
+    else if (name.equals("gt"))
+        *out++ = '>';
+    else if (name.equals("amp"))
+        *out++ = '&';
+    else if (name.equals("quot"))
+        *out++ = '"';
+    else if (name.equals("apos"))
+        *out++ = '\'';
+    else if (name.length >= 2 && name.chars[0] == '#') {
+        /// Character reference, decimal or hex code point, written as UTF-8
+        bool hex = (name.chars[1] == 'x');
+        const char* digit = name.chars + (hex ? 2 : 1);
+        if (digit == semicolon)
+            throw parseError(ref, "bad character reference: " + name.str());
+        uint32_t code = 0;
+        for (; digit < semicolon; digit++) {
+            unsigned char d = static_cast<unsigned char>(*digit);
+            uint32_t value;
+            if (isdigit(d))
+                value = d - '0';
+            else if (hex && isxdigit(d))
+                value = static_cast<uint32_t>(tolower(d) - 'a' + 10);
+            else
+                throw parseError(ref, "bad character reference: " + name.str());
+            code = code * (hex ? 16 : 10) + value;
+            if (code > 0x10FFFF)
+                throw parseError(ref, "bad character reference: " + name.str());
+        }
+        if (!isXmlChar(code))
+            throw parseError(ref, "bad character reference: " + name.str());
+
+        if (code < 0x80)
+            *out++ = static_cast<char>(code);
+        else if (code < 0x800) {
+            *out++ = static_cast<char>(0xC0 | (code >> 6));
+            *out++ = static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            *out++ = static_cast<char>(0xE0 | (code >> 12));
+            *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            *out++ = static_cast<char>(0xF0 | (code >> 18));
+            *out++ = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (code & 0x3F));
+        }
+    } else
+        throw parseError(ref, "undefined entity: " + name.str());
+
+    return(semicolon + 1);
+}
+
+void E57XmlPullParser::resolve(const E57XmlString& qName, bool isAttribute, E57XmlString& uri, E57XmlString& localName)
+{
+    /// Same results as Xerces SAX2 with namespace prefixes reported: unprefixed attributes
+    /// (including xmlns) have no namespace, declarations with a prefix are in the xmlns namespace.
+    const char* colon = static_cast<const char*>(memchr(qName.chars, ':', qName.length));
+    E57XmlString prefix;
+    if (colon != nullptr) {
+        prefix    = E57XmlString(qName.chars, colon - qName.chars);
+        localName = E57XmlString(colon + 1, qName.chars + qName.length - colon - 1);
+    } else {
+        localName = qName;
+        if (isAttribute) {
+            uri = E57XmlString();
+            return;
+        }
+    }
+
+    if (prefix.equals("xmlns")) {
+        uri = E57XmlString(xmlnsUri, strlen(xmlnsUri));
+        return;
+    }
+    if (prefix.equals("xml")) {
+        uri = E57XmlString(xmlUri, strlen(xmlUri));
+        return;
+    }
+    for (size_t i = nameSpaces_.size(); i > 0; i--) {
+        const NameSpace& ns = nameSpaces_[i-1];
+        if (ns.prefix.length == prefix.length && memcmp(ns.prefix.chars, prefix.chars, prefix.length) == 0) {
+            uri = ns.uri;
+            return;
+        }
+    }
+    if (prefix.length > 0)
+        throw parseError(qName.chars, "undeclared namespace prefix: " + prefix.str());
+    uri = E57XmlString();
+}
+
+E57Exception E57XmlPullParser::parseError(const char* at, const ustring& message) const
+{
+    /// Only work out the line and column when there is an error
+    int64_t line = 1;
+    const char* lineStart = begin_;
+    for (const char* c = begin_; c < at; c++) {
+        if (*c == '\n') {
+            line++;
+            lineStart = c + 1;
+        }
+    }
+    return(E57_EXCEPTION2(E57_ERROR_XML_PARSER,
+                          "xmlLine=" + toString(line)
+                          + " xmlColumn=" + toString(at - lineStart + 1)
+                          + " parserMessage=" + message));
+}
+
+void E57XmlParser::parse(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength)
+{
+    /// Be careful if size_t is smaller than uint64_t
+    if (logicalLength > std::numeric_limits<size_t>::max())
+        throw E57_EXCEPTION2(E57_ERROR_XML_PARSER, "xmlLogicalLength=" + toString(logicalLength));
+
+    /// Read whole XML section into memory, the pull parser works in place on it
+    size_t length = static_cast<size_t>(logicalLength);
+    unique_ptr<char[]> xml(new char[length + 1]);
+    if (length > 0)
+        cf->readAt(logicalStart, xml.get(), length);
+
+    E57XmlPullParser reader(xml.get(), xml.get() + length);
+    for (;;) {
+        switch (reader.next()) {
+            case E57XmlPullParser::START_ELEMENT:
+                elementStart(reader.uri().str(), reader.localName().str(), reader.qName().str(), reader.attributes());
+                break;
+            case E57XmlPullParser::END_ELEMENT:
+                elementEnd(reader.uri().str(), reader.localName().str(), reader.qName().str());
+                break;
+            case E57XmlPullParser::CHARACTERS:
+                elementCharacters(reader.text().chars, reader.text().length);
+                break;
+            case E57XmlPullParser::END_DOCUMENT:
+                return;
+        }
+    }
+}
+#endif
@@ -27,23 +27,64 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <cstring>
 #include <stack>
+#include <vector>
 
+#ifndef E57_BUILTIN_XML_PARSER
 #include <xercesc/sax2/DefaultHandler.hpp>
 #include <xercesc/sax/InputSource.hpp>
 
 XERCES_CPP_NAMESPACE_USE
+#endif
 
 #include "Common.h"
 #include "CheckedFile.h"
 
 namespace e57 {
+   /// UTF-8 name or value from the XML section, not null terminated.
+   /// Points into memory owned by the parser, so only valid during the call it is passed to.
+   struct E57XmlString
+   {
+      const char* chars;
+      size_t      length;
+
+      E57XmlString() : chars(""), length(0) {}
+      E57XmlString(const char* c, size_t n) : chars(c), length(n) {}
+
+      ustring str() const {return(ustring(chars, length));}
+      bool    equals(const char* s) const {return(strlen(s) == length && (length == 0 || memcmp(chars, s, length) == 0));}
+   };
+
+   struct E57XmlAttribute
+   {
+      E57XmlString uri;
+      E57XmlString localName;
+      E57XmlString qName;
+      E57XmlString value;
+   };
+
+   typedef std::vector<E57XmlAttribute> E57XmlAttributes;
+
+#ifdef E57_BUILTIN_XML_PARSER
+   class E57XmlParser
+#else
    class E57XmlParser : public DefaultHandler
+#endif
    {
       public:
          E57XmlParser(std::shared_ptr<ImageFileImpl> imf);
          ~E57XmlParser();
 
+         /// Element events in UTF-8, shared by both parser backends, builds the node tree
+         void elementStart(const ustring& uri, const ustring& localName, const ustring& qName, const E57XmlAttributes& attributes);
+         void elementEnd(const ustring& uri, const ustring& localName, const ustring& qName);
+         void elementCharacters(const char* chars, size_t length);
+
+#ifdef E57_BUILTIN_XML_PARSER
+         /// Parse the XML section of the file with the built-in parser
+         void parse(CheckedFile* cf, uint64_t logicalStart, uint64_t logicalLength);
+#else
          /// SAX interface
          void startDocument();
          void endDocument();
@@ -58,12 +99,19 @@ namespace e57 {
          void warning(const SAXParseException& exc);
          void error(const SAXParseException& exc);
          void fatalError(const SAXParseException& exc);
+#endif
       private:
+#ifndef E57_BUILTIN_XML_PARSER
          ustring toUString(const XMLCh* const xml_str);
-         ustring lookupAttribute(const Attributes& attributes, const XMLCh* attribute_name);
-         bool    isAttributeDefined(const Attributes& attributes, const XMLCh* attribute_name);
+#endif
+         ustring lookupAttribute(const E57XmlAttributes& attributes, const char* attribute_name);
+         bool    isAttributeDefined(const E57XmlAttributes& attributes, const char* attribute_name);
+
+         template <class T, class... Args>
+         std::shared_ptr<T> newNode(Args&&... args);
 
          std::shared_ptr<ImageFileImpl> imf_;   /// Image file we are reading
+         NodeArena*       nodeArena_;           /// Where nodes are allocated, nullptr for the heap
 
          struct ParseInfo {
                /// All the fields need to remember while parsing the XML
@@ -92,6 +140,7 @@ namespace e57 {
          std::stack<ParseInfo>    stack_; /// Stores the current path in tree we are reading
    };
 
+#ifndef E57_BUILTIN_XML_PARSER
    class E57FileInputSource : public InputSource
    {
       public :
@@ -109,7 +158,7 @@ namespace e57 {
          uint64_t        logicalStart_;
          uint64_t        logicalLength_;
    };
-
+#endif
 }
 
 #endif
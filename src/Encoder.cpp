@@ -29,9 +29,126 @@
 #include "Encoder.h"
 #include "E57FoundationImpl.h"
 
+/// On x86-64 the range check of source values can use SSE4.1 or AVX2, chosen at run time by what the CPU has.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define E57_PACK_SIMD
+#define E57_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define E57_TARGET_AVX2  __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_M_X64) && defined(_MSC_VER)
+#define E57_PACK_SIMD
+#define E57_TARGET_SSE41
+#define E57_TARGET_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
 using namespace e57;
 using namespace std;
 
+/// Number of values BitpackIntegerEncoder checks at a time into a scratch array before packing them.
+#define E57_PACK_BLOCK_SIZE     256
+
+namespace
+{
+   /// Check that count values of a contiguous source array are in [minimum, maximum], and store value-minimum in raw.
+   /// Used only when maximum-minimum fits in 32 bits.  Returns false if any value is out of range, raw is then only partly filled.
+   typedef bool (*LoadFunction)(const char* src, size_t count, int64_t minimum, int64_t maximum, uint32_t* raw);
+
+   template <typename T>
+   bool loadPortable(const char* src, size_t count, int64_t minimum, int64_t maximum, uint32_t* raw)
+   {
+      const T* s = reinterpret_cast<const T*>(src);
+      bool inRange = true;
+      for (size_t i = 0; i < count; i++) {
+         const int64_t v = static_cast<int64_t>(s[i]);
+         inRange &= (minimum <= v) & (v <= maximum);
+         raw[i] = static_cast<uint32_t>(static_cast<uint64_t>(v) - static_cast<uint64_t>(minimum));
+      }
+      return(inRange);
+   }
+
+#ifdef E57_PACK_SIMD
+   /// Load lanes of 32 bit integers, widened from narrower source types
+   E57_TARGET_SSE41 inline __m128i widen4(const int8_t* p)   { int32_t w; memcpy(&w, p, sizeof(w)); return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(w)); }
+   E57_TARGET_SSE41 inline __m128i widen4(const uint8_t* p)  { int32_t w; memcpy(&w, p, sizeof(w)); return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(w)); }
+   E57_TARGET_SSE41 inline __m128i widen4(const int16_t* p)  { return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+   E57_TARGET_SSE41 inline __m128i widen4(const uint16_t* p) { return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+   E57_TARGET_SSE41 inline __m128i widen4(const int32_t* p)  { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+
+   E57_TARGET_AVX2 inline __m256i widen8(const int8_t* p)   { return _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+   E57_TARGET_AVX2 inline __m256i widen8(const uint8_t* p)  { return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+   E57_TARGET_AVX2 inline __m256i widen8(const int16_t* p)  { return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+   E57_TARGET_AVX2 inline __m256i widen8(const uint16_t* p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+   E57_TARGET_AVX2 inline __m256i widen8(const int32_t* p)  { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+
+   /// Values are widened to int32, so bounds are clamped to int32 and raw is formed modulo 2^32.
+   /// That is exact, because every value that passes the check is less than 2^32 above minimum.
+   /// Caller makes sure [minimum, maximum] overlaps the int32 range.
+   template <typename T>
+   E57_TARGET_SSE41 bool loadSse41(const char* src, size_t count, int64_t minimum, int64_t maximum, uint32_t* raw)
+   {
+      const T* s = reinterpret_cast<const T*>(src);
+      const __m128i lo   = _mm_set1_epi32(static_cast<int32_t>(max<int64_t>(minimum, E57_INT32_MIN)));
+      const __m128i hi   = _mm_set1_epi32(static_cast<int32_t>(min<int64_t>(maximum, E57_INT32_MAX)));
+      const __m128i base = _mm_set1_epi32(static_cast<int32_t>(static_cast<uint32_t>(minimum)));
+      __m128i outOfRange = _mm_setzero_si128();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4) {
+         const __m128i v = widen4(&s[i]);
+         outOfRange = _mm_or_si128(outOfRange, _mm_or_si128(_mm_cmpgt_epi32(lo, v), _mm_cmpgt_epi32(v, hi)));
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(&raw[i]), _mm_sub_epi32(v, base));
+      }
+      const bool inRange = _mm_testz_si128(outOfRange, outOfRange) != 0;
+      return(loadPortable<T>(reinterpret_cast<const char*>(&s[i]), count - i, minimum, maximum, &raw[i]) && inRange);
+   }
+
+   template <typename T>
+   E57_TARGET_AVX2 bool loadAvx2(const char* src, size_t count, int64_t minimum, int64_t maximum, uint32_t* raw)
+   {
+      const T* s = reinterpret_cast<const T*>(src);
+      const __m256i lo   = _mm256_set1_epi32(static_cast<int32_t>(max<int64_t>(minimum, E57_INT32_MIN)));
+      const __m256i hi   = _mm256_set1_epi32(static_cast<int32_t>(min<int64_t>(maximum, E57_INT32_MAX)));
+      const __m256i base = _mm256_set1_epi32(static_cast<int32_t>(static_cast<uint32_t>(minimum)));
+      __m256i outOfRange = _mm256_setzero_si256();
+      size_t i = 0;
+      for (; i + 8 <= count; i += 8) {
+         const __m256i v = widen8(&s[i]);
+         outOfRange = _mm256_or_si256(outOfRange, _mm256_or_si256(_mm256_cmpgt_epi32(lo, v), _mm256_cmpgt_epi32(v, hi)));
+         _mm256_storeu_si256(reinterpret_cast<__m256i*>(&raw[i]), _mm256_sub_epi32(v, base));
+      }
+      const bool inRange = _mm256_testz_si256(outOfRange, outOfRange) != 0;
+      return(loadPortable<T>(reinterpret_cast<const char*>(&s[i]), count - i, minimum, maximum, &raw[i]) && inRange);
+   }
+#endif
+
+   /// Pick fastest range check the CPU supports for source type T.  Only types that widen to int32 have vector versions.
+   template <typename T>
+   LoadFunction loadSelect()
+   {
+#ifdef E57_PACK_SIMD
+      if (cpuFeatures().avx2)
+         return loadAvx2<T>;
+      if (cpuFeatures().sse41)
+         return loadSse41<T>;
+#endif
+      return loadPortable<T>;
+   }
+
+   template <>
+   LoadFunction loadSelect<uint32_t>() { return loadPortable<uint32_t>; }
+
+   template <>
+   LoadFunction loadSelect<int64_t>() { return loadPortable<int64_t>; }
+
+   template <typename T>
+   LoadFunction loadFunction()
+   {
+      static const LoadFunction sLoad = loadSelect<T>();
+      return(sLoad);
+   }
+}
+
 
 shared_ptr<Encoder> Encoder::EncoderFactory(unsigned bytestreamNumber,
                                             shared_ptr<CompressedVectorNodeImpl> cVector,
@@ -188,12 +305,13 @@ BitpackEncoder::BitpackEncoder(unsigned bytestreamNumber, SourceDestBuffer& sbuf
      outBuffer_(outputMaxSize),
      outBufferFirst_(0),
      outBufferEnd_(0),
+     outBufferWrapEnd_(0),
      outBufferAlignmentSize_(alignmentSize),
      currentRecordIndex_(0)
 {
 }
 
-unsigned BitpackEncoder::sourceBufferNextIndex()
+size_t BitpackEncoder::sourceBufferNextIndex()
 {
    return(sourceBuffer_->nextIndex());
 }
@@ -203,9 +321,18 @@ uint64_t BitpackEncoder::currentRecordIndex()
    return(currentRecordIndex_);
 }
 
+unsigned BitpackEncoder::chunkRecordAlignment()
+{
+   /// Byte oriented encoders hold no partial words, so any record boundary will do.
+   return(1);
+}
+
 size_t BitpackEncoder::outputAvailable()
 {
-   return(outBufferEnd_ - outBufferFirst_);
+   if (outBufferWrapEnd_ > 0)
+      return(outBufferWrapEnd_ - outBufferFirst_ + outBufferEnd_);
+   else
+      return(outBufferEnd_ - outBufferFirst_);
 }
 
 void BitpackEncoder::outputRead(char* dest, const size_t byteCount)
@@ -218,29 +345,43 @@ void BitpackEncoder::outputRead(char* dest, const size_t byteCount)
    if (byteCount > outputAvailable())
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "byteCount=" + toString(byteCount) + " outputAvailable=" + toString(outputAvailable()));
 
-   /// Copy output bytes to caller
-   memcpy(dest, &outBuffer_[outBufferFirst_], byteCount);
+   /// Copy output bytes to caller, in two pieces if the output wraps around the end of outBuffer_
+   size_t remaining = byteCount;
+   while (remaining > 0) {
+      size_t runEnd = (outBufferWrapEnd_ > 0) ? outBufferWrapEnd_ : outBufferEnd_;
+      size_t n = min(remaining, runEnd - outBufferFirst_);
+      memcpy(dest, &outBuffer_[outBufferFirst_], n);
 
 #ifdef E57_MAX_VERBOSE
-   {
-      unsigned i;
-      for (i=0; i < byteCount && i < 20; i++)
-         cout << "  outBuffer[" << outBufferFirst_+i << "]=" << static_cast<unsigned>(static_cast<unsigned char>(outBuffer_[outBufferFirst_+i])) << endl; //???
-      if (i < byteCount)
-         cout << "  " << byteCount-1 << " bytes unprinted..." << endl;
-   }
+      {
+         unsigned i;
+         for (i=0; i < n && i < 20; i++)
+            cout << "  outBuffer[" << outBufferFirst_+i << "]=" << static_cast<unsigned>(static_cast<unsigned char>(outBuffer_[outBufferFirst_+i])) << endl; //???
+         if (i < n)
+            cout << "  " << n-i << " bytes unprinted..." << endl;
+      }
 #endif
 
-   /// Advance head pointer.
-   outBufferFirst_ += byteCount;
+      /// Advance head pointer.
+      outBufferFirst_ += n;
+      dest            += n;
+      remaining       -= n;
+
+      /// If have read up to the wrap, rest of output starts at beginning of outBuffer_
+      if (outBufferWrapEnd_ > 0 && outBufferFirst_ == outBufferWrapEnd_) {
+         outBufferFirst_   = 0;
+         outBufferWrapEnd_ = 0;
+      }
+   }
 
-   /// Don't slide remaining data down now, wait until do some more processing (that's when data needs to be aligned).
+   /// Nothing is moved, the space read is reused when the tail of the ring gets to it.
 }
 
 void BitpackEncoder::outputClear()
 {
    outBufferFirst_     = 0;
    outBufferEnd_       = 0;
+   outBufferWrapEnd_   = 0;
 }
 
 void BitpackEncoder::sourceBufferSetNew(std::vector<SourceDestBuffer>& sbufs)
@@ -261,50 +402,61 @@ size_t BitpackEncoder::outputGetMaxSize()
 void BitpackEncoder::outputSetMaxSize(unsigned byteCount)
 {
    /// Ignore if trying to shrink buffer (queue might get messed up).
-   if (byteCount > outBuffer_.size())
+   if (byteCount > outBuffer_.size()) {
       outBuffer_.resize(byteCount);
+
+      /// If output wraps around, unroll it, the wrapped part can't stay at the beginning of a bigger ring.
+      /// Keep outBufferEnd_ at a natural boundary.
+      if (outBufferWrapEnd_ > 0) {
+         size_t available = outputAvailable();
+         vector<char> unrolled(available);
+         outputRead(&unrolled[0], available);
+         size_t newFirst = (outBufferAlignmentSize_ - available % outBufferAlignmentSize_) % outBufferAlignmentSize_;
+         memcpy(&outBuffer_[newFirst], &unrolled[0], available);
+         outBufferFirst_ = newFirst;
+         outBufferEnd_   = newFirst + available;
+      }
+   }
 }
 
-void BitpackEncoder::outBufferShiftDown()
+void BitpackEncoder::outBufferPrepare()
 {
-   /// Move data down closer to beginning of outBuffer_.
-   /// But keep outBufferEnd_ as a multiple of outBufferAlignmentSize_.
+   /// Output isn't moved, outBufferEnd_ just goes back to the beginning of outBuffer_ when there is more room there.
+   /// outBufferEnd_ only advances by whole units written, or goes back to 0, so it stays a multiple of outBufferAlignmentSize_.
    /// This ensures that writes into buffer can occur on natural boundaries.
    /// Otherwise some CPUs will fault.
 
-   if (outBufferFirst_ == outBufferEnd_) {
+   if (outputAvailable() == 0) {
       /// Buffer is empty, reset indices to 0
-      outBufferFirst_ = 0;
-      outBufferEnd_   = 0;
+      outBufferFirst_   = 0;
+      outBufferEnd_     = 0;
+      outBufferWrapEnd_ = 0;
       return;
    }
 
-   /// Round newEnd up to nearest multiple of outBufferAlignmentSize_.
-   size_t newEnd = outputAvailable();
-   size_t remainder = newEnd % outBufferAlignmentSize_;
-   if (remainder > 0)
-      newEnd += outBufferAlignmentSize_ - remainder;
-   size_t newFirst = outBufferFirst_ - (outBufferEnd_ - newEnd);
-   size_t byteCount = outBufferEnd_ - outBufferFirst_;
-
-   /// Double check round up worked
-   if (newEnd % outBufferAlignmentSize_)
-      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "newEnd=" + toString(newEnd) + " outBufferAlignmentSize=" + toString(outBufferAlignmentSize_));
+   /// If already wrapped, can only add up to outBufferFirst_
+   if (outBufferWrapEnd_ > 0)
+      return;
 
-   /// Be paranoid before memory copy
-   if (newFirst+byteCount > outBuffer_.size()) {
-      throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
-                           "newFirst=" + toString(newFirst)
-                           + " byteCount=" + toString(byteCount)
-                           + " outBufferSize=" + toString(outBuffer_.size()));
+   /// Wrap around if the space read at the beginning is bigger than the space left at the end
+   if (outBufferFirst_ > outBuffer_.size() - outBufferEnd_) {
+      outBufferWrapEnd_ = outBufferEnd_;
+      outBufferEnd_     = 0;
    }
 
-   /// Move available data down closer to beginning of outBuffer_.  Overlapping regions ok with memmove().
-   memmove(&outBuffer_[newFirst], &outBuffer_[outBufferFirst_], byteCount);
+#ifdef E57_DEBUG
+   /// Double check end is on a natural boundary
+   if (outBufferEnd_ % outBufferAlignmentSize_)
+      throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "outBufferEnd=" + toString(outBufferEnd_) + " outBufferAlignmentSize=" + toString(outBufferAlignmentSize_));
+#endif
+}
 
-   /// Update indexes
-   outBufferFirst_ = newFirst;
-   outBufferEnd_  = newEnd;
+size_t BitpackEncoder::outBufferFree()
+{
+   if (outBufferWrapEnd_ > 0)
+      return(outBufferFirst_ - outBufferEnd_);
+   else
+      return(outBuffer_.size() - outBufferEnd_);
 }
 
 #ifdef E57_DEBUG
@@ -316,6 +468,7 @@ void BitpackEncoder::dump(int indent, std::ostream& os)
    os << space(indent) << "outBuffer.size:           " << outBuffer_.size() << endl;
    os << space(indent) << "outBufferFirst:           " << outBufferFirst_ << endl;
    os << space(indent) << "outBufferEnd:             " << outBufferEnd_ << endl;
+   os << space(indent) << "outBufferWrapEnd:         " << outBufferWrapEnd_ << endl;
    os << space(indent) << "outBufferAlignmentSize:   " << outBufferAlignmentSize_ << endl;
    os << space(indent) << "currentRecordIndex:       " << currentRecordIndex_ << endl;
    os << space(indent) << "outBuffer:" << endl;
@@ -341,9 +494,8 @@ uint64_t BitpackFloatEncoder::processRecords(size_t recordCount)
    cout << "  BitpackFloatEncoder::processRecords() called, recordCount=" << recordCount << endl; //???
 #endif
 
-   /// Before we add any more, try to shift current contents of outBuffer_ down to beginning of buffer.
-   /// This leaves outBufferEnd_ at a natural boundary.
-   outBufferShiftDown();
+   /// Before we add any more, make room at outBufferEnd_, which is left at a natural boundary.
+   outBufferPrepare();
 
    size_t typeSize = (precision_ == E57_SINGLE) ? sizeof(float) : sizeof(double);
 
@@ -354,7 +506,7 @@ uint64_t BitpackFloatEncoder::processRecords(size_t recordCount)
 #endif
 
    /// Figure out how many records will fit in output.
-   size_t maxOutputRecords = (outBuffer_.size() - outBufferEnd_) / typeSize;
+   size_t maxOutputRecords = outBufferFree() / typeSize;
 
    /// Can't process more records than will safely fit in output stream
    if (recordCount > maxOutputRecords)
@@ -364,26 +516,33 @@ uint64_t BitpackFloatEncoder::processRecords(size_t recordCount)
       /// Form the starting address for next available location in outBuffer
       float* outp = reinterpret_cast<float*>(&outBuffer_[outBufferEnd_]);
 
-      /// Copy floats from sourceBuffer_ to outBuffer_
+      /// Copy floats from sourceBuffer_ to outBuffer_ in one block
+      if (recordCount > 0)
+         sourceBuffer_->getNextBlock(outp, recordCount);
+#if defined(E57_BIGENDIAN) || defined(E57_MAX_VERBOSE)
+      /// Only needs a pass over the values if they have to be swabbed, or printed
       for (unsigned i=0; i < recordCount; i++) {
-         outp[i] = sourceBuffer_->getNextFloat();
 #ifdef E57_MAX_VERBOSE
          cout << "encoding float: " << outp[i] << endl;
 #endif
          SWAB(&outp[i]);  /// swab if neccesary
       }
+#endif
    } else {  /// E57_DOUBLE precision
       /// Form the starting address for next available location in outBuffer
       double* outp = reinterpret_cast<double*>(&outBuffer_[outBufferEnd_]);
 
-      /// Copy doubles from sourceBuffer_ to outBuffer_
+      /// Copy doubles from sourceBuffer_ to outBuffer_ in one block
+      if (recordCount > 0)
+         sourceBuffer_->getNextBlock(outp, recordCount);
+#if defined(E57_BIGENDIAN) || defined(E57_MAX_VERBOSE)
       for (unsigned i=0; i < recordCount; i++) {
-         outp[i] = sourceBuffer_->getNextDouble();
 #ifdef E57_MAX_VERBOSE
          cout << "encoding double: " << outp[i] << endl;
 #endif
          SWAB(&outp[i]);  /// swab if neccesary
       }
+#endif
    }
 
    /// Update end of outBuffer
@@ -435,11 +594,12 @@ uint64_t BitpackStringEncoder::processRecords(size_t recordCount)
    cout << "  BitpackStringEncoder::processRecords() called, recordCount=" << recordCount << endl; //???
 #endif
 
-   /// Before we add any more, try to shift current contents of outBuffer_ down to beginning of buffer.
-   outBufferShiftDown();
+   /// Before we add any more, make room at outBufferEnd_.
+   outBufferPrepare();
 
    /// Figure out how many bytes outBuffer can accept.
-   size_t bytesFree = outBuffer_.size() - outBufferEnd_;
+   size_t bytesFreeStart = outBufferFree();
+   size_t bytesFree = bytesFreeStart;
 
    /// Form the starting address for next available location in outBuffer
    char* outp = &outBuffer_[outBufferEnd_];
@@ -513,7 +673,7 @@ uint64_t BitpackStringEncoder::processRecords(size_t recordCount)
    }
 
    /// Update end of outBuffer
-   outBufferEnd_ = outBuffer_.size() - bytesFree;
+   outBufferEnd_ += bytesFreeStart - bytesFree;
 
    /// Update counts of records processed
    currentRecordIndex_ += recordsProcessed;
@@ -585,19 +745,18 @@ uint64_t BitpackIntegerEncoder<RegisterT>::processRecords(size_t recordCount)
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "bitsPerRecord=" + toString(bitsPerRecord_));
 #endif
 
-   /// Before we add any more, try to shift current contents of outBuffer_ down to beginning of buffer.
-   /// This leaves outBufferEnd_ at a natural boundary.
-   outBufferShiftDown();
+   /// Before we add any more, make room at outBufferEnd_, which is left at a natural boundary.
+   outBufferPrepare();
 
 #ifdef E57_DEBUG
    /// Verify that outBufferEnd_ is multiple of sizeof(RegisterT) (so transfers of RegisterT are aligned naturally in memory).
    if (outBufferEnd_ % sizeof(RegisterT))
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "outBufferEnd=" + toString(outBufferEnd_));
-   size_t transferMax = (outBuffer_.size() - outBufferEnd_) / sizeof(RegisterT);
+   size_t transferMax = outBufferFree() / sizeof(RegisterT);
 #endif
 
    /// Precalculate exact maximum number of records that will fit in output before overflow.
-   size_t outputWordCapacity = (outBuffer_.size() - outBufferEnd_) / sizeof(RegisterT);
+   size_t outputWordCapacity = outBufferFree() / sizeof(RegisterT);
    size_t maxOutputRecords = (outputWordCapacity*8*sizeof(RegisterT) + 8*sizeof(RegisterT) - registerBitsUsed_ - 1) / bitsPerRecord_;
 
    /// Number of transfers is the smaller of what was requested and what will fit.
@@ -606,19 +765,36 @@ uint64_t BitpackIntegerEncoder<RegisterT>::processRecords(size_t recordCount)
    cout << "  outputWordCapacity=" << outputWordCapacity << " maxOutputRecords=" << maxOutputRecords << " recordCount=" << recordCount << endl;
 #endif
 
+#ifndef E57_BIGENDIAN
+   /// Common case of integers from a plain array is checked and packed in blocks
+   if (processRecordsBlocks(recordCount)) {
+      currentRecordIndex_ += recordCount;
+      return(currentRecordIndex_);
+   }
+#endif
+
    /// Form the starting address for next available location in outBuffer
    RegisterT* outp = reinterpret_cast<RegisterT*>(&outBuffer_[outBufferEnd_]);
    unsigned outTransferred = 0;
 
+   /// Values are fetched from sourceBuffer_ a block at a time
+   int64_t block[E57_TRANSFER_BLOCK_SIZE];
+   size_t blockCount = 0;
+   size_t blockIndex = 0;
+
    /// Copy bits from sourceBuffer_ to outBuffer_
    for (unsigned i=0; i < recordCount; i++) {
-      int64_t rawValue;
+      if (blockIndex == blockCount) {
+         blockCount = min(recordCount - i, static_cast<size_t>(E57_TRANSFER_BLOCK_SIZE));
+         blockIndex = 0;
 
-      /// The parameter isScaledInteger_ determines which version of getNextInt64 gets called
-      if (isScaledInteger_)
-         rawValue = sourceBuffer_->getNextInt64(scale_, offset_);
-      else
-         rawValue = sourceBuffer_->getNextInt64();
+         /// The parameter isScaledInteger_ determines which version of getNextBlock gets called
+         if (isScaledInteger_)
+            sourceBuffer_->getNextBlock(block, blockCount, scale_, offset_);
+         else
+            sourceBuffer_->getNextBlock(block, blockCount);
+      }
+      int64_t rawValue = block[blockIndex++];
 
       /// Enforce min/max specification on value
       if (rawValue < minimum_ || maximum_ < rawValue) {
@@ -695,8 +871,8 @@ uint64_t BitpackIntegerEncoder<RegisterT>::processRecords(size_t recordCount)
    /// Update tail of output buffer
    outBufferEnd_ += outTransferred * sizeof(RegisterT);
 #ifdef E57_DEBUG
-   /// Double check end is ok
-   if (outBufferEnd_ > outBuffer_.size()) {
+   /// Double check end is ok, if output wraps it can't pass the head
+   if (outBufferEnd_ > ((outBufferWrapEnd_ > 0) ? outBufferFirst_ : outBuffer_.size())) {
       throw E57_EXCEPTION2(E57_ERROR_INTERNAL,
                            "outBufferEnd=" + toString(outBufferEnd_)
                            + " outBuffersize=" + toString(outBuffer_.size()));
@@ -709,6 +885,119 @@ uint64_t BitpackIntegerEncoder<RegisterT>::processRecords(size_t recordCount)
    return(currentRecordIndex_);
 }
 
+template <typename RegisterT>
+bool BitpackIntegerEncoder<RegisterT>::processRecordsBlocks(size_t recordCount)
+{
+   /// Returns false, having done nothing, if the values need a per value conversion.
+   /// Register is at most 32 bits here, bitsPerRecord_ can't be more.
+   if (sizeof(RegisterT) > sizeof(uint32_t) || (isScaledInteger_ && sourceBuffer_->doScaling()))
+      return(false);
+
+   LoadFunction load = nullptr;
+   size_t elementSize = 0;
+   switch (sourceBuffer_->memoryRepresentation()) {
+      case E57_INT8:
+         load = loadFunction<int8_t>();
+         elementSize = sizeof(int8_t);
+         break;
+      case E57_UINT8:
+         load = loadFunction<uint8_t>();
+         elementSize = sizeof(uint8_t);
+         break;
+      case E57_INT16:
+         load = loadFunction<int16_t>();
+         elementSize = sizeof(int16_t);
+         break;
+      case E57_UINT16:
+         load = loadFunction<uint16_t>();
+         elementSize = sizeof(uint16_t);
+         break;
+      case E57_INT32:
+         load = loadFunction<int32_t>();
+         elementSize = sizeof(int32_t);
+         break;
+      case E57_UINT32:
+         load = loadFunction<uint32_t>();
+         elementSize = sizeof(uint32_t);
+         break;
+      case E57_INT64:
+         load = loadFunction<int64_t>();
+         elementSize = sizeof(int64_t);
+         break;
+      default:
+         break;
+   }
+   if (load == nullptr || sourceBuffer_->stride() != elementSize)
+      return(false);
+
+   /// The vector range checks widen to int32, fall back if no int32 value could be in range
+   if (maximum_ < E57_INT32_MIN || E57_INT32_MAX < minimum_) {
+      switch (elementSize) {
+         case sizeof(int8_t):  load = (sourceBuffer_->memoryRepresentation() == E57_INT8)  ? loadPortable<int8_t>  : loadPortable<uint8_t>;  break;
+         case sizeof(int16_t): load = (sourceBuffer_->memoryRepresentation() == E57_INT16) ? loadPortable<int16_t> : loadPortable<uint16_t>; break;
+         case sizeof(int32_t): load = (sourceBuffer_->memoryRepresentation() == E57_INT32) ? loadPortable<int32_t> : loadPortable<uint32_t>; break;
+         default: break;
+      }
+   }
+
+   /// Pack through a 64 bit accumulator: whole 32 bit pieces go out as soon as they are complete.
+   /// 32 bits is a whole number of registers, and every byte written belongs to a register the scalar loop would also have written.
+   const unsigned registerBits = 8*sizeof(RegisterT);
+   char* outp = &outBuffer_[outBufferEnd_];
+   uint64_t accumulator = register_;
+   unsigned accumulatorBits = registerBitsUsed_;
+
+   const char* src = &sourceBuffer_->base_[sourceBuffer_->nextIndex_ * elementSize];
+   uint32_t raw[E57_PACK_BLOCK_SIZE];
+   for (size_t done = 0; done < recordCount; ) {
+      size_t count = min(recordCount - done, static_cast<size_t>(E57_PACK_BLOCK_SIZE));
+      if (!load(src, count, minimum_, maximum_, raw)) {
+         /// Find first bad value to report, in the same way as the per value loop
+         for (size_t i = 0; i < count; i++) {
+            sourceBuffer_->nextIndex_ = static_cast<size_t>(src - sourceBuffer_->base_) / elementSize + i;
+            int64_t rawValue = sourceBuffer_->getNextInt64();
+            if (rawValue < minimum_ || maximum_ < rawValue) {
+               throw E57_EXCEPTION2(E57_ERROR_VALUE_OUT_OF_BOUNDS,
+                                    "rawValue=" + toString(rawValue)
+                                    + " minimum=" + toString(minimum_)
+                                    + " maximum=" + toString(maximum_));
+            }
+         }
+         throw E57_EXCEPTION2(E57_ERROR_INTERNAL, "minimum=" + toString(minimum_) + " maximum=" + toString(maximum_));
+      }
+
+      for (size_t i = 0; i < count; i++) {
+         accumulator |= static_cast<uint64_t>(raw[i]) << accumulatorBits;
+         accumulatorBits += bitsPerRecord_;
+         if (accumulatorBits >= 32) {
+            uint32_t piece = static_cast<uint32_t>(accumulator);
+            memcpy(outp, &piece, sizeof(piece));
+            outp += sizeof(piece);
+            accumulator >>= 32;
+            accumulatorBits -= 32;
+         }
+      }
+      src  += count * elementSize;
+      done += count;
+   }
+
+   /// Move whole registers left in accumulator to output, the rest stays in register_
+   while (accumulatorBits >= registerBits) {
+      RegisterT word = static_cast<RegisterT>(accumulator);
+      memcpy(outp, &word, sizeof(word));
+      outp += sizeof(word);
+      accumulator = (accumulator >> (registerBits - 1)) >> 1;  /// two shifts so a 64 bit instance compiles without an overflowing shift
+      accumulatorBits -= registerBits;
+   }
+   register_         = static_cast<RegisterT>(accumulator);
+   registerBitsUsed_ = accumulatorBits;
+
+   outBufferEnd_ = static_cast<size_t>(outp - &outBuffer_[0]);
+   sourceBuffer_->nextIndex_ += recordCount;
+
+   return(true);
+}
+
 template <typename RegisterT>
 bool BitpackIntegerEncoder<RegisterT>::registerFlushToOutput()
 {
@@ -718,7 +1007,8 @@ bool BitpackIntegerEncoder<RegisterT>::registerFlushToOutput()
 #endif
    /// If have any used bits in register, transfer to output, padded in MSBits with zeros to RegisterT boundary
    if (registerBitsUsed_ > 0) {
-      if (outBufferEnd_ < outBuffer_.size() - sizeof(RegisterT)) {
+      outBufferPrepare();
+      if (outBufferFree() >= sizeof(RegisterT)) {
          RegisterT* outp = reinterpret_cast<RegisterT*>(&outBuffer_[outBufferEnd_]);
          *outp = register_;
          register_ = 0;
@@ -731,6 +1021,22 @@ bool BitpackIntegerEncoder<RegisterT>::registerFlushToOutput()
       return(true);
 }
 
+template <typename RegisterT>
+unsigned BitpackIntegerEncoder<RegisterT>::chunkRecordAlignment()
+{
+   /// The register is exactly empty after n records when n*bitsPerRecord_ is a multiple of the register width.
+   /// So n must be a multiple of registerBits/gcd(bitsPerRecord_, registerBits).
+   unsigned registerBits = 8*sizeof(RegisterT);
+   unsigned a = bitsPerRecord_;
+   unsigned b = registerBits;
+   while (b != 0) {
+      unsigned t = a % b;
+      a = b;
+      b = t;
+   }
+   return(registerBits / a);
+}
+
 template <typename RegisterT>
 float BitpackIntegerEncoder<RegisterT>::bitsPerRecord()
 {
@@ -770,11 +1076,17 @@ uint64_t ConstantIntegerEncoder::processRecords(size_t recordCount)
    dump(4);
 #endif
 
-   /// Check that all source values are == minimum_
-   for (unsigned i = 0; i < recordCount; i++) {
-      int64_t nextInt64 = sourceBuffer_->getNextInt64();
-      if (nextInt64 != minimum_)
-         throw E57_EXCEPTION2(E57_ERROR_VALUE_OUT_OF_BOUNDS, "nextInt64=" + toString(nextInt64) + " minimum=" + toString(minimum_));
+   /// Check that all source values are == minimum_, a block at a time
+   int64_t block[E57_TRANSFER_BLOCK_SIZE];
+   for (size_t done = 0; done < recordCount; ) {
+      size_t count = min(recordCount - done, static_cast<size_t>(E57_TRANSFER_BLOCK_SIZE));
+      sourceBuffer_->getNextBlock(block, count);
+      for (size_t i = 0; i < count; i++) {
+         int64_t nextInt64 = block[i];
+         if (nextInt64 != minimum_)
+            throw E57_EXCEPTION2(E57_ERROR_VALUE_OUT_OF_BOUNDS, "nextInt64=" + toString(nextInt64) + " minimum=" + toString(minimum_));
+      }
+      done += count;
    }
 
    /// Update counts of records processed
@@ -783,7 +1095,7 @@ uint64_t ConstantIntegerEncoder::processRecords(size_t recordCount)
    return(currentRecordIndex_);
 }
 
-unsigned ConstantIntegerEncoder::sourceBufferNextIndex()
+size_t ConstantIntegerEncoder::sourceBufferNextIndex()
 {
    return(sourceBuffer_->nextIndex());
 }
@@ -804,6 +1116,12 @@ bool ConstantIntegerEncoder::registerFlushToOutput()
    return(true);
 }
 
+unsigned ConstantIntegerEncoder::chunkRecordAlignment()
+{
+   /// We don't produce any output, so any record boundary will do
+   return(1);
+}
+
 size_t ConstantIntegerEncoder::outputAvailable()
 {
    /// We don't produce any output
@@ -42,10 +42,11 @@ namespace e57 {
          virtual             ~Encoder(){}
 
          virtual uint64_t    processRecords(size_t recordCount) = 0;
-         virtual unsigned    sourceBufferNextIndex() = 0;
+         virtual size_t      sourceBufferNextIndex() = 0;
          virtual uint64_t    currentRecordIndex() = 0;
          virtual float       bitsPerRecord() = 0;
          virtual bool        registerFlushToOutput() = 0;
+         virtual unsigned    chunkRecordAlignment() = 0;                      /// record multiple at which output is flushed with empty register
 
          virtual size_t      outputAvailable() = 0;                                /// number of bytes that can be read
          virtual void        outputRead(char* dest, const size_t byteCount) = 0;       /// get data from encoder
@@ -71,10 +72,11 @@ namespace e57 {
    {
       public:
          virtual uint64_t    processRecords(size_t recordCount) = 0;
-         virtual unsigned    sourceBufferNextIndex();
+         virtual size_t      sourceBufferNextIndex();
          virtual uint64_t    currentRecordIndex();
          virtual float       bitsPerRecord() = 0;
          virtual bool        registerFlushToOutput() = 0;
+         virtual unsigned    chunkRecordAlignment();
 
          virtual size_t      outputAvailable();                                /// number of bytes that can be read
          virtual void        outputRead(char* dest, const size_t byteCount);       /// get data from encoder
@@ -90,13 +92,17 @@ namespace e57 {
       protected:
          BitpackEncoder(unsigned bytestreamNumber, SourceDestBuffer& sbuf, unsigned outputMaxSize, unsigned alignmentSize);
 
-         void                outBufferShiftDown();
+         void                outBufferPrepare();                               /// make room at outBufferEnd_ before adding output
+         size_t              outBufferFree();                                  /// number of contiguous bytes that can be written at outBufferEnd_
 
          std::shared_ptr<SourceDestBufferImpl>  sourceBuffer_;
 
+         /// outBuffer_ is a ring: output is in [outBufferFirst_, outBufferEnd_), or if outBufferWrapEnd_ > 0,
+         /// in [outBufferFirst_, outBufferWrapEnd_) followed by [0, outBufferEnd_).
          std::vector<char>   outBuffer_;
          size_t              outBufferFirst_;
          size_t              outBufferEnd_;
+         size_t              outBufferWrapEnd_;
          size_t              outBufferAlignmentSize_;
 
          uint64_t            currentRecordIndex_;
@@ -150,12 +156,15 @@ namespace e57 {
 
          virtual uint64_t    processRecords(size_t recordCount);
          virtual bool        registerFlushToOutput();
+         virtual unsigned    chunkRecordAlignment();
          virtual float       bitsPerRecord();
 
 #ifdef E57_DEBUG
          virtual void        dump(int indent = 0, std::ostream& os = std::cout);
 #endif
       protected:
+         bool            processRecordsBlocks(size_t recordCount);
+
          bool            isScaledInteger_;
          int64_t         minimum_;
          int64_t         maximum_;
@@ -173,10 +182,11 @@ namespace e57 {
       public:
          ConstantIntegerEncoder(unsigned bytestreamNumber, SourceDestBuffer& sbuf, int64_t minimum);
          virtual uint64_t    processRecords(size_t recordCount);
-         virtual unsigned    sourceBufferNextIndex();
+         virtual size_t      sourceBufferNextIndex();
          virtual uint64_t    currentRecordIndex();
          virtual float       bitsPerRecord();
          virtual bool        registerFlushToOutput();
+         virtual unsigned    chunkRecordAlignment();
 
          virtual size_t      outputAvailable();                                /// number of bytes that can be read
          virtual void        outputRead(char* dest, const size_t byteCount);       /// get data from encoder
@@ -0,0 +1,47 @@
+#ifndef FLOAT_FORMAT_P_H
+#define FLOAT_FORMAT_P_H
+
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstddef>
+
+namespace e57 {
+
+   /// Longest string written by formatShortest, e.g. "-2.2250738585072014e-308"
+   static const size_t shortestStringSize = 32;
+
+   /// Write the shortest decimal string that reads back as the same value, the closest one if there are several.
+   /// Uses the Ryu algorithm (Ulf Adams, "Ryu: fast float-to-string conversion", PLDI 2018).
+   /// Result is in scientific notation without trailing zeros, and without exponent if it is zero.
+   /// E.g. 0.1 ==> "1e-01", 123456 ==> "1.23456e+05", 2 ==> "2"
+   /// Returns number of chars written to out (no terminating null).
+   size_t formatShortest(double value, char* out);
+   size_t formatShortest(float value, char* out);
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Reads the same file with and without ImageFileOptions::nodeArena, and checks both trees
+/// match the tree that was written, and that nodes read into an arena may outlive their ImageFile.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "E57Foundation.h"
+#include "TreeDump.h"
+
+using namespace e57;
+
+namespace {
+
+const int   SCAN_COUNT = 300;
+const int   POINT_COUNT = 10;
+
+void buildTree(ImageFile imf)
+{
+    StructureNode root = imf.root();
+    root.set("guid", StringNode(imf, "{12345678-ABCD} caf\xC3\xA9"));
+
+    VectorNode data3D(imf, true);
+    root.set("data3D", data3D);
+    for (int i = 0; i < SCAN_COUNT; i++) {
+        StructureNode scan(imf);
+        data3D.append(scan);
+        scan.set("name", StringNode(imf, "scan " + std::to_string(i)));
+        scan.set("index", IntegerNode(imf, i, 0, SCAN_COUNT));
+        scan.set("temperature", ScaledIntegerNode(imf, i, -1000, 1000, 0.01, 273.15));
+
+        StructureNode pose(imf);
+        scan.set("pose", pose);
+        StructureNode rotation(imf);
+        pose.set("rotation", rotation);
+        rotation.set("w", FloatNode(imf, 1.0));
+        rotation.set("x", FloatNode(imf, 0.0));
+        rotation.set("y", FloatNode(imf, 0.0));
+        rotation.set("z", FloatNode(imf, 0.0));
+        StructureNode translation(imf);
+        pose.set("translation", translation);
+        translation.set("x", FloatNode(imf, i * 0.1));
+        translation.set("y", FloatNode(imf, -i * 0.25f, E57_SINGLE));
+        translation.set("z", FloatNode(imf, 1e300 / (i + 1)));
+    }
+
+    /// One CompressedVector with data, to read back through arena nodes
+    StructureNode proto(imf);
+    proto.set("x", FloatNode(imf, 0.0, E57_SINGLE));
+    proto.set("i", IntegerNode(imf, 0, 0, 1023));
+    VectorNode codecs(imf, true);
+    CompressedVectorNode points(imf, proto, codecs);
+    StructureNode(data3D.get(0)).set("points", points);
+
+    std::vector<float>   x(POINT_COUNT);
+    std::vector<int32_t> i(POINT_COUNT);
+    for (int k = 0; k < POINT_COUNT; k++) {
+        x[k] = k * 0.5f;
+        i[k] = k * 100;
+    }
+    std::vector<SourceDestBuffer> sbufs;
+    sbufs.push_back(SourceDestBuffer(imf, "x", &x[0], POINT_COUNT, true));
+    sbufs.push_back(SourceDestBuffer(imf, "i", &i[0], POINT_COUNT, true));
+    CompressedVectorWriter writer = points.writer(sbufs);
+    writer.write(POINT_COUNT);
+    writer.close();
+
+    root.set("blob", BlobNode(imf, 100));
+}
+
+/// Returns the number of bad values
+unsigned checkPoints(ImageFile imf)
+{
+    CompressedVectorNode points(imf.root().get("/data3D/0/points"));
+
+    std::vector<float>   x(POINT_COUNT);
+    std::vector<int32_t> i(POINT_COUNT);
+    std::vector<SourceDestBuffer> dbufs;
+    dbufs.push_back(SourceDestBuffer(imf, "x", &x[0], POINT_COUNT, true));
+    dbufs.push_back(SourceDestBuffer(imf, "i", &i[0], POINT_COUNT, true));
+    CompressedVectorReader reader = points.reader(dbufs);
+    unsigned count = reader.read();
+    reader.close();
+
+    unsigned bad = (count == POINT_COUNT) ? 0 : 1;
+    for (unsigned k = 0; k < count; k++) {
+        if (x[k] != k * 0.5f || i[k] != static_cast<int32_t>(k * 100))
+            bad++;
+    }
+    return(bad);
+}
+
+} // end namespace
+
+int main()
+{
+    unsigned bad = 0;
+
+    try {
+        std::string written;
+        {
+            ImageFile imf("ArenaTest.e57", "w");
+            buildTree(imf);
+            written = treeDump(imf.root());
+            imf.close();
+        }
+
+        for (bool nodeArena : {false, true}) {
+            ImageFileOptions options;
+            options.nodeArena = nodeArena;
+            ImageFile imf("ArenaTest.e57", "r", options);
+            if (treeDump(imf.root()) != written) {
+                std::cerr << "tree read with nodeArena=" << nodeArena << " differs from the tree written" << std::endl;
+                bad++;
+            }
+            if (checkPoints(imf) != 0) {
+                std::cerr << "points read with nodeArena=" << nodeArena << " are wrong" << std::endl;
+                bad++;
+            }
+            imf.close();
+        }
+
+        /// Nodes read into an arena keep it alive after their ImageFile is closed and gone
+        std::vector<Node> kept;
+        {
+            ImageFileOptions options;
+            options.nodeArena = true;
+            ImageFile imf("ArenaTest.e57", "r", options);
+            kept.push_back(imf.root().get("/data3D/7/pose/translation"));
+            kept.push_back(imf.root().get("/data3D/0/points"));
+            kept.push_back(imf.root().get("/data3D"));
+            imf.close();
+        }
+        kept.clear();
+    } catch (E57Exception& ex) {
+        ex.report(__FILE__, __LINE__, __FUNCTION__);
+        return(1);
+    }
+
+    if (bad > 0) {
+        std::cerr << bad << " bad trees" << std::endl;
+        return(1);
+    }
+
+    return(0);
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Writes and reads back integer fields of every bit width from 1 to 64, scaled integer, float and string fields,
+/// through several memory representations and buffer sizes, and checks every value.
+/// ctest also runs it with E57_DISABLE_CPU_FEATURES set, so the portable versions of the SIMD code are checked too.
+/// The optional argument is the name of the file to write.
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "E57Foundation.h"
+
+using namespace e57;
+
+namespace {
+
+/// Not a multiple of any buffer size, and enough records for about a hundred data packets
+const int64_t   RECORD_COUNT = 10007;
+const unsigned  WRITE_BUFFER_SIZE = 1000;
+
+const double    SCALE = 0.001;
+const double    OFFSET = -7.5;
+
+enum Representation {REP_INT8, REP_UINT8, REP_INT16, REP_UINT16, REP_INT32, REP_UINT32, REP_INT64, REP_FLOAT, REP_DOUBLE};
+
+enum FieldKind {FIELD_INTEGER, FIELD_SCALED, FIELD_SINGLE, FIELD_DOUBLE, FIELD_STRING};
+
+struct Field {
+    ustring     name;
+    FieldKind   kind;
+    unsigned    bits;       /// Integer and scaled integer fields: bits per value
+    int64_t     minimum;
+    int64_t     maximum;
+};
+
+/// splitmix64, so the values can be computed again for checking
+uint64_t mix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return(x ^ (x >> 31));
+}
+
+uint64_t fieldSeed(const Field& f, int64_t r)
+{
+    uint64_t h = 0;
+    for (char c : f.name)
+        h = h * 131 + static_cast<unsigned char>(c);
+    return(mix(h ^ mix(static_cast<uint64_t>(r))));
+}
+
+/// Raw value of an integer or scaled integer field, random in its range, with runs of the minimum and maximum
+int64_t intValue(const Field& f, int64_t r)
+{
+    switch (r % 101) {
+        case 0: case 1: case 2: return(f.minimum);
+        case 3: case 4:         return(f.maximum);
+    }
+    const uint64_t bits = fieldSeed(f, r);
+    if (f.bits == 64)
+        return(static_cast<int64_t>(bits));
+    const uint64_t span = (1ULL << f.bits) - 1;
+    return(f.minimum + static_cast<int64_t>(bits & span));
+}
+
+double scaledValue(int64_t raw)
+{
+    return(raw * SCALE + OFFSET);
+}
+
+double floatValue(const Field& f, int64_t r)
+{
+    const uint64_t bits = fieldSeed(f, r);
+    switch (r % 53) {
+        case 0: return(0.0);
+        case 1: return(-0.0);
+        case 2: return(f.kind == FIELD_SINGLE ? 3.4028234663852886e38 : 1.7976931348623157e308);
+        case 3: return(f.kind == FIELD_SINGLE ? 1.401298464324817e-45 : 4.9406564584124654e-324);
+    }
+    /// Random mantissa and sign, exponent within a range both float and double hold
+    const double v = std::ldexp(static_cast<double>(bits >> 11) / 9007199254740992.0, static_cast<int>(bits % 120) - 60);
+    const double signedValue = (bits & 1024) ? -v : v;
+    return(f.kind == FIELD_SINGLE ? static_cast<double>(static_cast<float>(signedValue)) : signedValue);
+}
+
+/// Mostly short, a few long enough to span several data packets
+ustring stringValue(int64_t r)
+{
+    if (r % 1000 == 17)
+        return(ustring(70000 + r % 13, static_cast<char>('a' + r % 26)));
+    return(ustring(static_cast<size_t>(r % 11), static_cast<char>('A' + r % 26)));
+}
+
+std::vector<Field> makeFields()
+{
+    std::vector<Field> fields;
+
+    /// For every width an unsigned range starting at 0 and a signed one around 0, except 64 bits which is only signed
+    for (unsigned bits = 1; bits <= 64; bits++) {
+        const int64_t half = (bits == 64) ? E57_INT64_MIN : -(1LL << (bits - 1));
+        fields.push_back({"s" + std::to_string(bits), FIELD_INTEGER, bits, half, -(half + 1)});
+        if (bits < 64)
+            fields.push_back({"u" + std::to_string(bits), FIELD_INTEGER, bits, 0, static_cast<int64_t>((1ULL << bits) - 1)});
+    }
+
+    /// Scaled integers, including ranges too big for the vectorized conversion to be exact
+    const unsigned scaledBits[] = {1, 7, 8, 9, 16, 17, 24, 31, 32, 33, 40, 52, 53, 60};
+    for (unsigned bits : scaledBits) {
+        const int64_t half = -(1LL << (bits - 1));
+        fields.push_back({"scaled" + std::to_string(bits), FIELD_SCALED, bits, half, -(half + 1)});
+    }
+
+    fields.push_back({"single", FIELD_SINGLE, 0, 0, 0});
+    fields.push_back({"double", FIELD_DOUBLE, 0, 0, 0});
+    fields.push_back({"string", FIELD_STRING, 0, 0, 0});
+    return(fields);
+}
+
+/// The smallest integer type that holds the range of f
+Representation smallestRepresentation(const Field& f)
+{
+    if (f.minimum >= 0) {
+        if (f.maximum <= 0xFF)          return(REP_UINT8);
+        if (f.maximum <= 0xFFFF)        return(REP_UINT16);
+        if (f.maximum <= 0xFFFFFFFFLL)  return(REP_UINT32);
+        return(REP_INT64);
+    }
+    if (f.minimum >= -0x80 && f.maximum <= 0x7F)                return(REP_INT8);
+    if (f.minimum >= -0x8000 && f.maximum <= 0x7FFF)            return(REP_INT16);
+    if (f.minimum >= -0x80000000LL && f.maximum <= 0x7FFFFFFF)  return(REP_INT32);
+    return(REP_INT64);
+}
+
+/// A user buffer of one field, in one memory representation
+class Buffer {
+public:
+    virtual         ~Buffer() {}
+    virtual SourceDestBuffer sourceDest(ImageFile imf, const ustring& name, bool doConversion, bool doScaling) = 0;
+    virtual void    setInt(size_t i, int64_t value) = 0;
+    virtual void    setReal(size_t i, double value) = 0;
+    virtual int64_t getInt(size_t i) const = 0;
+    virtual double  getReal(size_t i) const = 0;
+};
+
+template <typename T>
+class TypedBuffer : public Buffer {
+public:
+    explicit        TypedBuffer(size_t capacity) : values_(capacity) {}
+    SourceDestBuffer sourceDest(ImageFile imf, const ustring& name, bool doConversion, bool doScaling) override
+                    {return(SourceDestBuffer(imf, name, &values_[0], values_.size(), doConversion, doScaling));}
+    void            setInt(size_t i, int64_t value) override   {values_[i] = static_cast<T>(value);}
+    void            setReal(size_t i, double value) override   {values_[i] = static_cast<T>(value);}
+    int64_t         getInt(size_t i) const override            {return(static_cast<int64_t>(values_[i]));}
+    double          getReal(size_t i) const override           {return(static_cast<double>(values_[i]));}
+private:
+    std::vector<T>  values_;
+};
+
+std::unique_ptr<Buffer> makeBuffer(Representation rep, size_t capacity)
+{
+    switch (rep) {
+        case REP_INT8:      return(std::unique_ptr<Buffer>(new TypedBuffer<int8_t>(capacity)));
+        case REP_UINT8:     return(std::unique_ptr<Buffer>(new TypedBuffer<uint8_t>(capacity)));
+        case REP_INT16:     return(std::unique_ptr<Buffer>(new TypedBuffer<int16_t>(capacity)));
+        case REP_UINT16:    return(std::unique_ptr<Buffer>(new TypedBuffer<uint16_t>(capacity)));
+        case REP_INT32:     return(std::unique_ptr<Buffer>(new TypedBuffer<int32_t>(capacity)));
+        case REP_UINT32:    return(std::unique_ptr<Buffer>(new TypedBuffer<uint32_t>(capacity)));
+        case REP_INT64:     return(std::unique_ptr<Buffer>(new TypedBuffer<int64_t>(capacity)));
+        case REP_FLOAT:     return(std::unique_ptr<Buffer>(new TypedBuffer<float>(capacity)));
+        case REP_DOUBLE:    return(std::unique_ptr<Buffer>(new TypedBuffer<double>(capacity)));
+    }
+    return(nullptr);
+}
+
+/// How one field is moved to or from memory
+struct Transfer {
+    Representation  rep;
+    bool            doScaling;
+};
+
+/// A set of user buffers for all the fields of the prototype
+class BufferSet {
+public:
+    BufferSet(ImageFile imf, const std::vector<Field>& fields, const std::vector<Transfer>& transfers, size_t capacity)
+        : fields_(fields), transfers_(transfers), strings_(capacity)
+    {
+        for (size_t k = 0; k < fields.size(); k++) {
+            if (fields[k].kind == FIELD_STRING) {
+                buffers_.push_back(nullptr);
+                sourceDest_.push_back(SourceDestBuffer(imf, fields[k].name, &strings_));
+            } else {
+                buffers_.push_back(makeBuffer(transfers[k].rep, capacity));
+                const bool doConversion = (fields[k].kind == FIELD_INTEGER || fields[k].kind == FIELD_SCALED) ==
+                                          (transfers[k].rep == REP_FLOAT || transfers[k].rep == REP_DOUBLE);
+                sourceDest_.push_back(buffers_[k]->sourceDest(imf, fields[k].name, doConversion, transfers[k].doScaling));
+            }
+        }
+    }
+
+    std::vector<SourceDestBuffer>& sourceDest() {return(sourceDest_);}
+
+    void fill(int64_t start, size_t count)
+    {
+        for (size_t k = 0; k < fields_.size(); k++) {
+            for (size_t i = 0; i < count; i++) {
+                const int64_t r = start + static_cast<int64_t>(i);
+                switch (fields_[k].kind) {
+                    case FIELD_INTEGER:
+                    case FIELD_SCALED:  buffers_[k]->setInt(i, intValue(fields_[k], r)); break;
+                    case FIELD_SINGLE:
+                    case FIELD_DOUBLE:  buffers_[k]->setReal(i, floatValue(fields_[k], r)); break;
+                    case FIELD_STRING:  strings_[i] = stringValue(r); break;
+                }
+            }
+        }
+    }
+
+    /// Returns the number of fields with a wrong value, printing the first wrong value of each
+    unsigned check(const ustring& what, int64_t start, size_t count) const
+    {
+        unsigned bad = 0;
+        for (size_t k = 0; k < fields_.size(); k++) {
+            for (size_t i = 0; i < count; i++) {
+                const int64_t r = start + static_cast<int64_t>(i);
+                if (!checkValue(k, i, r)) {
+                    std::cerr << what << ": wrong value of " << fields_[k].name << " in record " << r << std::endl;
+                    bad++;
+                    break;
+                }
+            }
+        }
+        return(bad);
+    }
+
+private:
+    bool checkValue(size_t k, size_t i, int64_t r) const
+    {
+        const Field& f = fields_[k];
+        const Representation rep = transfers_[k].rep;
+
+        if (f.kind == FIELD_STRING)
+            return(strings_[i] == stringValue(r));
+
+        if (f.kind == FIELD_SINGLE || f.kind == FIELD_DOUBLE) {
+            const double expected = floatValue(f, r);
+            if (rep == REP_FLOAT)
+                return(static_cast<float>(buffers_[k]->getReal(i)) == static_cast<float>(expected));
+            return(buffers_[k]->getReal(i) == expected && std::signbit(buffers_[k]->getReal(i)) == std::signbit(expected));
+        }
+
+        const int64_t raw = intValue(f, r);
+        if (rep != REP_FLOAT && rep != REP_DOUBLE)
+            return(buffers_[k]->getInt(i) == raw);
+
+        /// The vectorized conversions may round differently in the last place
+        const double expected = transfers_[k].doScaling ? scaledValue(raw) : static_cast<double>(raw);
+        const double tolerance = (rep == REP_FLOAT ? 1e-6 : 1e-14) * std::fmax(1.0, std::fabs(expected));
+        return(std::fabs(buffers_[k]->getReal(i) - expected) <= tolerance);
+    }
+
+    const std::vector<Field>&               fields_;
+    std::vector<Transfer>                   transfers_;
+    std::vector<std::unique_ptr<Buffer>>    buffers_;
+    std::vector<ustring>                    strings_;
+    std::vector<SourceDestBuffer>           sourceDest_;
+};
+
+/// The memory representations of a write or read.  SMALLEST writes each integer field from the smallest type that holds it,
+/// WIDE from int64_t, and REAL reads integer fields into double (scaled ones into float).
+enum Layout {LAYOUT_SMALLEST, LAYOUT_WIDE, LAYOUT_REAL};
+
+std::vector<Transfer> makeTransfers(const std::vector<Field>& fields, Layout layout, bool reading)
+{
+    std::vector<Transfer> transfers;
+    for (const Field& f : fields) {
+        Transfer t = {REP_DOUBLE, false};
+        switch (f.kind) {
+            case FIELD_INTEGER:
+                t.rep = (layout == LAYOUT_SMALLEST) ? smallestRepresentation(f) : (layout == LAYOUT_WIDE) ? REP_INT64 : REP_DOUBLE;
+                break;
+            case FIELD_SCALED:
+                /// Written as raw values, read back scaled
+                if (!reading || layout == LAYOUT_WIDE)
+                    t.rep = REP_INT64;
+                else {
+                    t.rep = (layout == LAYOUT_SMALLEST) ? REP_DOUBLE : REP_FLOAT;
+                    t.doScaling = true;
+                }
+                break;
+            case FIELD_SINGLE:
+                t.rep = (reading && layout == LAYOUT_WIDE) ? REP_DOUBLE : REP_FLOAT;
+                break;
+            case FIELD_DOUBLE:
+                t.rep = (reading && layout == LAYOUT_WIDE) ? REP_FLOAT : REP_DOUBLE;
+                break;
+            case FIELD_STRING:
+                break;
+        }
+        transfers.push_back(t);
+    }
+    return(transfers);
+}
+
+void writeVector(ImageFile imf, const ustring& name, const std::vector<Field>& fields, Layout layout)
+{
+    StructureNode proto(imf);
+    for (const Field& f : fields) {
+        switch (f.kind) {
+            case FIELD_INTEGER: proto.set(f.name, IntegerNode(imf, f.minimum, f.minimum, f.maximum)); break;
+            case FIELD_SCALED:  proto.set(f.name, ScaledIntegerNode(imf, f.minimum, f.minimum, f.maximum, SCALE, OFFSET)); break;
+            case FIELD_SINGLE:  proto.set(f.name, FloatNode(imf, 0.0, E57_SINGLE)); break;
+            case FIELD_DOUBLE:  proto.set(f.name, FloatNode(imf, 0.0, E57_DOUBLE)); break;
+            case FIELD_STRING:  proto.set(f.name, StringNode(imf, "")); break;
+        }
+    }
+
+    VectorNode codecs(imf, true);
+    CompressedVectorNode cv(imf, proto, codecs);
+    imf.root().set(name, cv);
+
+    BufferSet buffers(imf, fields, makeTransfers(fields, layout, false), WRITE_BUFFER_SIZE);
+    CompressedVectorWriter writer = cv.writer(buffers.sourceDest());
+    for (int64_t start = 0; start < RECORD_COUNT; start += WRITE_BUFFER_SIZE) {
+        const unsigned count = static_cast<unsigned>(std::min<int64_t>(WRITE_BUFFER_SIZE, RECORD_COUNT - start));
+        buffers.fill(start, count);
+        writer.write(count);
+    }
+    writer.close();
+}
+
+/// Returns the number of bad values found
+unsigned readVector(ImageFile imf, const ustring& name, const std::vector<Field>& fields, Layout layout, size_t bufferSize)
+{
+    const ustring what = name + " read with layout " + std::to_string(layout) + " in blocks of " + std::to_string(bufferSize);
+
+    CompressedVectorNode cv(imf.root().get(name));
+    BufferSet buffers(imf, fields, makeTransfers(fields, layout, true), bufferSize);
+    CompressedVectorReader reader = cv.reader(buffers.sourceDest());
+
+    unsigned bad = 0;
+    int64_t start = 0;
+    unsigned count;
+    while ((count = reader.read()) > 0 && bad == 0) {
+        bad += buffers.check(what, start, count);
+        start += count;
+    }
+    reader.close();
+
+    if (bad == 0 && start != RECORD_COUNT) {
+        std::cerr << what << ": read " << start << " records" << std::endl;
+        bad++;
+    }
+    return(bad);
+}
+
+} // end namespace
+
+int main(int argc, char** argv)
+{
+    const ustring fileName = (argc > 1) ? argv[1] : "BitpackTest.e57";
+    const std::vector<Field> fields = makeFields();
+    unsigned bad = 0;
+
+    try {
+        {
+            ImageFile imf(fileName, "w");
+            writeVector(imf, "smallest", fields, LAYOUT_SMALLEST);
+            writeVector(imf, "wide", fields, LAYOUT_WIDE);
+            bad += readVector(imf, "smallest", fields, LAYOUT_SMALLEST, 4096);
+            imf.close();
+        }
+
+        ImageFile imf(fileName, "r");
+        const size_t bufferSizes[] = {4096, 777, 1};
+        for (const char* name : {"smallest", "wide"}) {
+            for (Layout layout : {LAYOUT_SMALLEST, LAYOUT_WIDE, LAYOUT_REAL}) {
+                for (size_t bufferSize : bufferSizes) {
+                    /// Record at a time is slow, once is enough
+                    if (bufferSize == 1 && (layout != LAYOUT_SMALLEST || ustring(name) != "smallest"))
+                        continue;
+                    bad += readVector(imf, name, fields, layout, bufferSize);
+                }
+            }
+        }
+        imf.close();
+    } catch (E57Exception& ex) {
+        ex.report(__FILE__, __LINE__, __FUNCTION__);
+        return(1);
+    }
+
+    if (bad > 0) {
+        std::cerr << bad << " bad fields" << std::endl;
+        return(1);
+    }
+
+    return(0);
+}
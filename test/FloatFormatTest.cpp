@@ -0,0 +1,249 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Checks that formatShortest writes the shortest string that reads back as the same value, and the closest one of
+/// that length, for edge cases and random doubles and floats.  Then checks FloatNode values read back from a file
+/// are the same as the ones written.
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "E57Foundation.h"
+#include "FloatFormat.h"
+
+using namespace e57;
+
+namespace {
+
+const unsigned RANDOM_COUNT = 200000;
+
+template <typename T> T readBack(const char* s);
+template <> double readBack<double>(const char* s) {return(std::strtod(s, nullptr));}
+template <> float readBack<float>(const char* s)   {return(std::strtof(s, nullptr));}
+
+/// Same bits, so -0 and 0 differ
+template <typename T>
+bool sameBits(T a, T b)
+{
+    return(std::memcmp(&a, &b, sizeof(T)) == 0);
+}
+
+/// printf's "%.*e" of value with the given number of significant digits, in the form formatShortest uses
+template <typename T>
+std::string printfDigits(T value, int digitCount)
+{
+    char s[64];
+    std::snprintf(s, sizeof(s), "%.*e", digitCount - 1, static_cast<double>(value));
+    std::string result(s);
+    if (result.size() >= 4 && result.compare(result.size() - 4, 4, "e+00") == 0)
+        result.erase(result.size() - 4);
+    return(result);
+}
+
+/// Returns 1 if the formatting of value is wrong, 0 if it's right
+template <typename T>
+unsigned checkValue(T value, const char* expected = nullptr)
+{
+    char s[shortestStringSize + 1];
+    const size_t length = formatShortest(value, s);
+    s[length] = '\0';
+
+    if (expected != nullptr) {
+        if (std::strcmp(s, expected) != 0) {
+            std::cerr << "formatted " << expected << " as " << s << std::endl;
+            return(1);
+        }
+        return(0);
+    }
+
+    if (length >= shortestStringSize) {
+        std::cerr << s << " is too long" << std::endl;
+        return(1);
+    }
+
+    if (!sameBits(readBack<T>(s), value)) {
+        std::cerr << s << " doesn't read back as the value formatted" << std::endl;
+        return(1);
+    }
+
+    /// Count the significant digits
+    int digitCount = 0;
+    for (const char* c = s; *c != '\0' && *c != 'e'; c++)
+        digitCount += (*c >= '0' && *c <= '9');
+    if (value == 0)
+        return(0);
+
+    /// The correctly rounded string of the same length is the closest, it must be the one written if it reads back the same.
+    /// (Below a power of two it may not, as the values there are closer together.)  One digit less mustn't read back the same.
+    const std::string closest = printfDigits(value, digitCount);
+    if (closest != s && sameBits(readBack<T>(closest.c_str()), value)) {
+        std::cerr << s << " isn't the closest, printf gives " << closest << std::endl;
+        return(1);
+    }
+    if (digitCount > 1 && sameBits(readBack<T>(printfDigits(value, digitCount - 1).c_str()), value)) {
+        std::cerr << s << " isn't the shortest, " << printfDigits(value, digitCount - 1) << " reads back the same" << std::endl;
+        return(1);
+    }
+    return(0);
+}
+
+/// Powers of two and ten, the values next to them, and the largest, smallest and subnormal values
+template <typename T>
+unsigned checkEdges()
+{
+    unsigned bad = 0;
+    const T inf = std::numeric_limits<T>::infinity();
+    std::vector<T> values = {std::numeric_limits<T>::max(), std::numeric_limits<T>::min(),
+                             std::numeric_limits<T>::denorm_min(), std::numeric_limits<T>::epsilon()};
+
+    for (int e = std::numeric_limits<T>::min_exponent - std::numeric_limits<T>::digits; e <= std::numeric_limits<T>::max_exponent; e++)
+        values.push_back(std::ldexp(T(1), e - 1));
+    for (int e = std::numeric_limits<T>::min_exponent10 - 10; e <= std::numeric_limits<T>::max_exponent10; e++)
+        values.push_back(readBack<T>(("1e" + std::to_string(e)).c_str()));
+    for (int n = 1; n <= 1000; n++) {
+        values.push_back(static_cast<T>(n));
+        values.push_back(static_cast<T>(n) / 1000);
+    }
+
+    const size_t count = values.size();
+    for (size_t n = 0; n < count; n++) {
+        values.push_back(std::nextafter(values[n], inf));
+        values.push_back(std::nextafter(values[n], T(0)));
+    }
+
+    for (T value : values) {
+        if (std::isfinite(value)) {
+            bad += checkValue(value);
+            bad += checkValue(-value);
+        }
+    }
+    return(bad);
+}
+
+template <typename UInt, typename T>
+unsigned checkRandom(std::mt19937_64& random)
+{
+    unsigned bad = 0;
+    for (unsigned n = 0; n < RANDOM_COUNT && bad < 10; n++) {
+        const UInt bits = static_cast<UInt>(random());
+        T value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (std::isfinite(value))
+            bad += checkValue(value);
+    }
+    return(bad);
+}
+
+/// Returns the number of FloatNodes that read back different
+unsigned checkFloatNodes(const ustring& fileName, std::mt19937_64& random)
+{
+    const unsigned count = 2000;
+    std::vector<double> doubles(count);
+    std::vector<float>  floats(count);
+    for (unsigned n = 0; n < count; n++) {
+        doubles[n] = std::ldexp(static_cast<double>(random() >> 11), static_cast<int>(random() % 200) - 150);
+        floats[n] = static_cast<float>(std::ldexp(static_cast<double>(random() >> 40), static_cast<int>(random() % 100) - 70));
+    }
+    doubles[0] = DBL_MAX;
+    doubles[1] = -DBL_MIN;
+    floats[0] = FLT_MAX;
+    floats[1] = -FLT_MIN;
+    floats[2] = 0.1f;
+
+    {
+        ImageFile imf(fileName, "w");
+        for (unsigned n = 0; n < count; n++) {
+            imf.root().set("d" + std::to_string(n), FloatNode(imf, doubles[n], E57_DOUBLE, -DBL_MAX, DBL_MAX));
+            imf.root().set("f" + std::to_string(n), FloatNode(imf, floats[n], E57_SINGLE, -FLT_MAX, FLT_MAX));
+        }
+        imf.close();
+    }
+
+    unsigned bad = 0;
+    ImageFile imf(fileName, "r");
+    for (unsigned n = 0; n < count; n++) {
+        const double d = FloatNode(imf.root().get("d" + std::to_string(n))).value();
+        const double f = FloatNode(imf.root().get("f" + std::to_string(n))).value();
+        if (!sameBits(d, doubles[n]) || !sameBits(static_cast<float>(f), floats[n])) {
+            std::cerr << fileName << ": FloatNode " << n << " read back different" << std::endl;
+            bad++;
+        }
+    }
+    imf.close();
+    return(bad);
+}
+
+} // end namespace
+
+int main()
+{
+    unsigned bad = 0;
+
+    bad += checkValue(0.0, "0");
+    bad += checkValue(-0.0, "-0");
+    bad += checkValue(1.0, "1");
+    bad += checkValue(0.1, "1e-01");
+    bad += checkValue(123456.0, "1.23456e+05");
+    bad += checkValue(DBL_MAX, "1.7976931348623157e+308");
+    bad += checkValue(-DBL_MIN, "-2.2250738585072014e-308");
+    bad += checkValue(std::numeric_limits<double>::denorm_min(), "5e-324");
+    bad += checkValue(std::numeric_limits<double>::infinity(), "inf");
+    bad += checkValue(-std::numeric_limits<double>::infinity(), "-inf");
+    bad += checkValue(std::numeric_limits<double>::quiet_NaN(), "nan");
+    bad += checkValue(0.1f, "1e-01");
+    bad += checkValue(FLT_MAX, "3.4028235e+38");
+    bad += checkValue(std::numeric_limits<float>::denorm_min(), "1e-45");
+    bad += checkValue(16777216.0f, "1.6777216e+07");
+
+    bad += checkEdges<double>();
+    bad += checkEdges<float>();
+
+    std::mt19937_64 random(57);
+    bad += checkRandom<uint64_t, double>(random);
+    bad += checkRandom<uint32_t, float>(random);
+
+    try {
+        bad += checkFloatNodes("FloatFormatTest.e57", random);
+    } catch (E57Exception& ex) {
+        ex.report(__FILE__, __LINE__, __FUNCTION__);
+        return(1);
+    }
+
+    if (bad > 0) {
+        std::cerr << bad << " bad values" << std::endl;
+        return(1);
+    }
+
+    return(0);
+}
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Checks path lookups in StructureNode and VectorNode, with path name strings and with NodePath:
+/// the nodes found, and the error codes for missing and badly formed paths, which must stay the same
+/// as before children were indexed.
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "E57Foundation.h"
+
+using namespace e57;
+
+namespace {
+
+/// Structures with this many children are searched through a hash index of their names
+const int   BIG_STRUCTURE_CHILDREN = 40;
+const int   VECTOR_CHILDREN = 5;
+
+/// What get() does with a path, from the root of the tree built by buildTree().
+/// isDefined() must be true if get() succeeds, false if get() throws E57_ERROR_PATH_UNDEFINED, and throw the other errors.
+struct PathCase {
+    const char*     pathName;
+    ErrorCode       getError;       /// E57_SUCCESS if the path is found
+};
+
+const PathCase pathCases[] = {
+    {"/",           E57_SUCCESS},
+    {"st/c5/x",     E57_SUCCESS},
+    {"/st/c5/x",    E57_SUCCESS},
+    {"st/k0",       E57_SUCCESS},
+    {"st/k39",      E57_SUCCESS},
+    {"vec/0/v",     E57_SUCCESS},
+    {"/vec/4/v",    E57_SUCCESS},
+    {"st/missing",  E57_ERROR_PATH_UNDEFINED},
+    {"st/k40",      E57_ERROR_PATH_UNDEFINED},
+    {"st/f/x",      E57_ERROR_PATH_UNDEFINED},
+    {"vec/5",       E57_ERROR_PATH_UNDEFINED},
+    {"vec/03",      E57_ERROR_PATH_UNDEFINED},
+
+    /// A trailing '/' is a bad path name if it follows a Structure or Vector, but not a terminal node
+    {"st/c5/",      E57_ERROR_BAD_PATH_NAME},
+    {"/st/",        E57_ERROR_BAD_PATH_NAME},
+    {"vec/",        E57_ERROR_BAD_PATH_NAME},
+    {"vec/3/",      E57_ERROR_BAD_PATH_NAME},
+    {"st/f/",       E57_ERROR_PATH_UNDEFINED},
+    {"st/k39/",     E57_ERROR_PATH_UNDEFINED},
+    {"st/c5/x/",    E57_ERROR_PATH_UNDEFINED},
+
+    {"",            E57_ERROR_BAD_PATH_NAME},
+    {"//",          E57_ERROR_BAD_PATH_NAME},
+    {"st//c5",      E57_ERROR_BAD_PATH_NAME},
+    {"vec//3",      E57_ERROR_BAD_PATH_NAME},
+    {"vec/-1",      E57_ERROR_BAD_PATH_NAME},
+    {"st/1abc",     E57_ERROR_BAD_PATH_NAME},
+    {"nosuch:st",   E57_ERROR_BAD_PATH_NAME},
+};
+
+void buildTree(ImageFile imf)
+{
+    StructureNode root = imf.root();
+
+    StructureNode st(imf);
+    root.set("st", st);
+    StructureNode c5(imf);
+    st.set("c5", c5);
+    c5.set("x", IntegerNode(imf, 5));
+    st.set("f", FloatNode(imf, 1.0));
+    for (int i = 0; i < BIG_STRUCTURE_CHILDREN; i++)
+        st.set("k" + std::to_string(i), IntegerNode(imf, i));
+
+    VectorNode vec(imf, true);
+    root.set("vec", vec);
+    for (int i = 0; i < VECTOR_CHILDREN; i++) {
+        StructureNode element(imf);
+        element.set("v", IntegerNode(imf, i));
+        vec.append(element);
+    }
+}
+
+/// Returns the number of paths that didn't do what was expected
+unsigned checkPaths(ImageFile imf)
+{
+    unsigned bad = 0;
+    StructureNode root = imf.root();
+
+    for (const PathCase& c : pathCases) {
+        ErrorCode getError = E57_SUCCESS;
+        try {
+            root.get(c.pathName);
+        } catch (E57Exception& ex) {
+            getError = ex.errorCode();
+        }
+        if (getError != c.getError) {
+            std::cerr << "get(\"" << c.pathName << "\") gave error " << getError << ", expected " << c.getError << std::endl;
+            bad++;
+        }
+
+        ErrorCode isDefinedError = E57_SUCCESS;
+        bool isDefined = false;
+        try {
+            isDefined = root.isDefined(c.pathName);
+        } catch (E57Exception& ex) {
+            isDefinedError = ex.errorCode();
+        }
+        ErrorCode expectedError = (c.getError == E57_ERROR_PATH_UNDEFINED) ? E57_SUCCESS : c.getError;
+        if (isDefinedError != expectedError || (isDefinedError == E57_SUCCESS && isDefined != (c.getError == E57_SUCCESS))) {
+            std::cerr << "isDefined(\"" << c.pathName << "\") gave " << isDefined << " error " << isDefinedError << std::endl;
+            bad++;
+        }
+    }
+
+    /// The nodes found must be the right ones, by name in the indexed Structure and by index in the Vector
+    StructureNode st(root.get("st"));
+    for (int i = 0; i < BIG_STRUCTURE_CHILDREN; i++) {
+        IntegerNode k(st.get("k" + std::to_string(i)));
+        if (k.value() != i || k.elementName() != "k" + std::to_string(i)) {
+            std::cerr << "st/k" << i << " found the wrong node" << std::endl;
+            bad++;
+        }
+    }
+    VectorNode vec(root.get("vec"));
+    for (int i = 0; i < VECTOR_CHILDREN; i++) {
+        if (IntegerNode(vec.get(std::to_string(i) + "/v")).value() != i
+            || IntegerNode(StructureNode(vec.get(i)).get("v")).value() != i) {
+            std::cerr << "vec/" << i << " found the wrong node" << std::endl;
+            bad++;
+        }
+    }
+
+    return(bad);
+}
+
+/// Same cases as checkPaths, through NodePath. Bad path names throw when the NodePath is created,
+/// except for a trailing '/', which is only known to be bad when the lookup gets to it.
+unsigned checkNodePaths(ImageFile imf)
+{
+    unsigned bad = 0;
+    StructureNode root = imf.root();
+
+    for (const PathCase& c : pathCases) {
+        ErrorCode getError = E57_SUCCESS;
+        try {
+            NodePath path(imf, c.pathName);
+            root.get(path);
+            root.get(path);     /// Second use may come from the cache
+        } catch (E57Exception& ex) {
+            getError = ex.errorCode();
+        }
+        if (getError != c.getError) {
+            std::cerr << "get(NodePath(\"" << c.pathName << "\")) gave error " << getError << ", expected " << c.getError << std::endl;
+            bad++;
+        }
+    }
+
+    /// A relative path used from more start nodes than the cache holds, in turn and from several threads
+    NodePath v(imf, "v");
+    NodePath vec(imf, "/vec");
+    VectorNode vector(root.get("vec"));
+    std::vector<std::thread> threads;
+    std::vector<unsigned> threadBad(4, 0);
+    for (unsigned t = 0; t < threadBad.size(); t++) {
+        threads.emplace_back([&, t]() {
+            for (int r = 0; r < 1000; r++) {
+                int i = (r * 3 + t) % VECTOR_CHILDREN;
+                StructureNode element(vector.get(i));
+                if (IntegerNode(element.get(v)).value() != i || !(element.get(vec) == Node(vector)))
+                    threadBad[t]++;
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    for (unsigned b : threadBad)
+        bad += b;
+
+    return(bad);
+}
+
+/// The NodePath cache must not hide changes to the tree
+unsigned checkNodePathChanges(ImageFile imf)
+{
+    unsigned bad = 0;
+    StructureNode root = imf.root();
+    StructureNode c5(root.get("st/c5"));
+
+    /// A missing path isn't remembered, so it is found once it is set
+    NodePath y(imf, "y");
+    if (c5.isDefined(y)) {
+        std::cerr << "st/c5/y defined before it was set" << std::endl;
+        bad++;
+    }
+    c5.set("y", IntegerNode(imf, 6));
+    if (!c5.isDefined(y) || IntegerNode(c5.get(y)).value() != 6) {
+        std::cerr << "st/c5/y not found after it was set" << std::endl;
+        bad++;
+    }
+
+    /// An absolute path starts at the root of the tree the node is in, which changes when the tree is attached
+    NodePath st(imf, "/st");
+    StructureNode loose(imf);
+    StructureNode inner(imf);
+    loose.set("st", inner);
+    if (!(inner.get(st) == Node(inner))) {
+        std::cerr << "/st in an unattached tree didn't find that tree's st" << std::endl;
+        bad++;
+    }
+    root.set("loose", loose);
+    if (!(inner.get(st) == root.get("st"))) {
+        std::cerr << "/st after attaching the tree didn't find the root's st" << std::endl;
+        bad++;
+    }
+
+    return(bad);
+}
+
+} // end namespace
+
+int main()
+{
+    unsigned bad = 0;
+
+    try {
+        /// Trees built with the API, and read back from a file
+        {
+            ImageFile imf("PathTest.e57", "w");
+            buildTree(imf);
+            bad += checkPaths(imf);
+            bad += checkNodePaths(imf);
+            bad += checkNodePathChanges(imf);
+            imf.close();
+        }
+        {
+            ImageFile imf("PathTest.e57", "r");
+            bad += checkPaths(imf);
+            bad += checkNodePaths(imf);
+            imf.close();
+        }
+    } catch (E57Exception& ex) {
+        ex.report(__FILE__, __LINE__, __FUNCTION__);
+        return(1);
+    }
+
+    if (bad > 0) {
+        std::cerr << bad << " bad lookups" << std::endl;
+        return(1);
+    }
+
+    return(0);
+}
@@ -0,0 +1,321 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Reads one file in the ways the reader can be set up: with system calls and memory mapped, with packet caches of
+/// different sizes, with and without read ahead, with CompressedVectorReader::readAll on different numbers of threads,
+/// and with several readers on separate threads.  Then damages a data packet and checks the checksum error is thrown
+/// whichever thread finds it.  The optional argument is the name of the files to write, without extension.
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "E57Foundation.h"
+
+using namespace e57;
+
+namespace {
+
+/// Enough records for readAll to use a few threads, and for the vector to be several MB
+const int64_t   RECORD_COUNT = 200000;
+const int64_t   BLOB_SIZE = 3000000;
+
+/// In the data packets (which are written first) of the last slice readAll decodes on 3 threads
+const std::streamoff DAMAGE_OFFSET = 1200 * 1024 + 10;
+
+double  expectedX(int64_t r)    {return((r % 200000 - 100000) * 0.001);}
+float   expectedY(int64_t r)    {return(static_cast<float>(r) * 0.125f);}
+int32_t expectedI(int64_t r)    {return(static_cast<int32_t>((r * 7) % 1021));}
+ustring expectedS(int64_t r)    {return((r % 9 == 0) ? "s" + std::to_string(r) : ustring());}
+uint8_t expectedBlob(int64_t n) {return(static_cast<uint8_t>((n * 31) ^ (n >> 11)));}
+
+/// User buffers for all fields of the vector, or all but the strings
+struct Buffers {
+    std::vector<double>  x;
+    std::vector<float>   y;
+    std::vector<int32_t> i;
+    std::vector<ustring> s;
+    bool                 withStrings;
+
+    Buffers(size_t capacity, bool strings = true) : x(capacity), y(capacity), i(capacity), s(capacity), withStrings(strings) {}
+
+    std::vector<SourceDestBuffer> sourceDest(ImageFile imf)
+    {
+        std::vector<SourceDestBuffer> bufs;
+        bufs.push_back(SourceDestBuffer(imf, "x", &x[0], x.size(), true, true));
+        bufs.push_back(SourceDestBuffer(imf, "y", &y[0], y.size(), true));
+        bufs.push_back(SourceDestBuffer(imf, "i", &i[0], i.size(), true));
+        if (withStrings)
+            bufs.push_back(SourceDestBuffer(imf, "s", &s));
+        return(bufs);
+    }
+
+    void fill(int64_t start, size_t count)
+    {
+        for (size_t k = 0; k < count; k++) {
+            x[k] = expectedX(start + k);
+            y[k] = expectedY(start + k);
+            i[k] = expectedI(start + k);
+            s[k] = expectedS(start + k);
+        }
+    }
+
+    /// Returns true if the first count entries hold records [start, start + count)
+    bool check(int64_t start, size_t count) const
+    {
+        for (size_t k = 0; k < count; k++) {
+            const int64_t r = start + k;
+            if (x[k] != expectedX(r) || y[k] != expectedY(r) || i[k] != expectedI(r) || (withStrings && s[k] != expectedS(r)))
+                return(false);
+        }
+        return(true);
+    }
+};
+
+void writeFile(const ustring& fileName)
+{
+    ImageFile imf(fileName, "w");
+
+    StructureNode proto(imf);
+    proto.set("x", ScaledIntegerNode(imf, 0, -100000, 100000, 0.001, 0));
+    proto.set("y", FloatNode(imf, 0.0, E57_SINGLE));
+    proto.set("i", IntegerNode(imf, 0, 0, 1020));
+    proto.set("s", StringNode(imf, ""));
+
+    VectorNode codecs(imf, true);
+    CompressedVectorNode cv(imf, proto, codecs);
+    imf.root().set("points", cv);
+
+    const size_t bufferSize = 5000;
+    Buffers buffers(bufferSize);
+    std::vector<SourceDestBuffer> sbufs = buffers.sourceDest(imf);
+    CompressedVectorWriter writer = cv.writer(sbufs);
+    for (int64_t start = 0; start < RECORD_COUNT; start += bufferSize) {
+        const unsigned count = static_cast<unsigned>(std::min<int64_t>(bufferSize, RECORD_COUNT - start));
+        buffers.fill(start, count);
+        writer.write(count);
+    }
+    writer.close();
+
+    BlobNode blob(imf, BLOB_SIZE);
+    imf.root().set("blob", blob);
+    std::vector<uint8_t> bytes(BLOB_SIZE);
+    for (int64_t n = 0; n < BLOB_SIZE; n++)
+        bytes[n] = expectedBlob(n);
+    blob.write(&bytes[0], 0, BLOB_SIZE);
+
+    imf.close();
+}
+
+/// Reads the whole vector with read(), in blocks of an odd size.  Returns the number of bad values found.
+unsigned readSequential(ImageFile imf, const CompressedVectorReaderOptions& options, const ustring& what)
+{
+    CompressedVectorNode cv(imf.root().get("points"));
+    Buffers buffers(777);
+    std::vector<SourceDestBuffer> dbufs = buffers.sourceDest(imf);
+    CompressedVectorReader reader = cv.reader(dbufs, options);
+
+    int64_t start = 0;
+    unsigned count;
+    while ((count = reader.read()) > 0) {
+        if (!buffers.check(start, count)) {
+            std::cerr << what << ": wrong values in records from " << start << std::endl;
+            return(1);
+        }
+        start += count;
+    }
+    reader.close();
+
+    if (start != RECORD_COUNT) {
+        std::cerr << what << ": read " << start << " records" << std::endl;
+        return(1);
+    }
+    return(0);
+}
+
+/// Returns the number of bad values found
+unsigned readAll(ImageFile imf, const CompressedVectorReaderOptions& options, unsigned threadCount, bool strings,
+                 const ustring& what)
+{
+    CompressedVectorNode cv(imf.root().get("points"));
+    Buffers buffers(RECORD_COUNT, strings);
+    std::vector<SourceDestBuffer> dbufs = buffers.sourceDest(imf);
+
+    /// The reader's own buffers are a different, smaller set
+    Buffers readerBuffers(10, false);
+    std::vector<SourceDestBuffer> readerDbufs = readerBuffers.sourceDest(imf);
+    CompressedVectorReader reader = cv.reader(readerDbufs, options);
+
+    const uint64_t count = reader.readAll(dbufs, threadCount);
+    reader.close();
+
+    if (count != static_cast<uint64_t>(RECORD_COUNT) || !buffers.check(0, RECORD_COUNT)) {
+        std::cerr << what << ": readAll on " << threadCount << " threads" << (strings ? "" : " without strings") << " failed" << std::endl;
+        return(1);
+    }
+    return(0);
+}
+
+/// Returns the number of bad bytes found
+unsigned readBlob(ImageFile imf, const ustring& what)
+{
+    BlobNode blob(imf.root().get("blob"));
+    std::vector<uint8_t> bytes(BLOB_SIZE);
+
+    /// Within a page, across a page boundary, across many pages, and the whole blob
+    const int64_t pieces[][2] = {{10, 100}, {1000, 100}, {5000, 700000}, {BLOB_SIZE - 3, 3}, {0, BLOB_SIZE}};
+    for (const int64_t* piece : pieces) {
+        blob.read(&bytes[0], piece[0], static_cast<size_t>(piece[1]));
+        for (int64_t n = 0; n < piece[1]; n++) {
+            if (bytes[n] != expectedBlob(piece[0] + n)) {
+                std::cerr << what << ": wrong blob byte " << piece[0] + n << std::endl;
+                return(1);
+            }
+        }
+    }
+    return(0);
+}
+
+/// Returns the number of bad values found
+unsigned checkFile(const ustring& fileName, bool memoryMapped)
+{
+    const ustring what = fileName + (memoryMapped ? " mapped" : "");
+
+    ImageFileOptions fileOptions;
+    fileOptions.memoryMapped = memoryMapped;
+    ImageFile imf(fileName, "r", fileOptions);
+
+    unsigned bad = readBlob(imf, what);
+
+    std::vector<CompressedVectorReaderOptions> readerOptions(5);
+    readerOptions[1].cachePacketCount = 1;
+    readerOptions[2].cacheByteSize = 200000;
+    readerOptions[3].readAheadPacketCount = 4;
+    readerOptions[4].cachePacketCount = 1;
+    readerOptions[4].readAheadPacketCount = 1;
+
+    for (size_t n = 0; n < readerOptions.size(); n++) {
+        const ustring optionsWhat = what + " with reader options " + std::to_string(n);
+        bad += readSequential(imf, readerOptions[n], optionsWhat);
+        for (unsigned threadCount : {1, 2, 3, 0})
+            bad += readAll(imf, readerOptions[n], threadCount, true, optionsWhat);
+        bad += readAll(imf, readerOptions[n], 4, false, optionsWhat);
+    }
+
+    /// Several readers of the same ImageFile used at once
+    std::vector<unsigned> threadBad(4, 0);
+    std::vector<std::thread> threads;
+    for (size_t n = 0; n < threadBad.size(); n++) {
+        threads.push_back(std::thread([&, n] {
+            try {
+                threadBad[n] = readSequential(imf, readerOptions[n], what + " on thread " + std::to_string(n));
+            } catch (E57Exception& ex) {
+                ex.report(__FILE__, __LINE__, __FUNCTION__);
+                threadBad[n] = 1;
+            }
+        }));
+    }
+    for (std::thread& t : threads)
+        t.join();
+    for (unsigned b : threadBad)
+        bad += b;
+
+    imf.close();
+    return(bad);
+}
+
+/// Returns 1 if reading the damaged file doesn't throw E57_ERROR_BAD_CHECKSUM, and 0 if it does
+unsigned checkDamaged(const ustring& fileName, bool memoryMapped, unsigned readAheadPacketCount, unsigned threadCount)
+{
+    const ustring what = fileName + (memoryMapped ? " mapped" : "") + " read ahead " + std::to_string(readAheadPacketCount) +
+                         " on " + std::to_string(threadCount) + " threads";
+
+    ImageFileOptions fileOptions;
+    fileOptions.memoryMapped = memoryMapped;
+    ImageFile imf(fileName, "r", fileOptions);
+
+    CompressedVectorReaderOptions options;
+    options.readAheadPacketCount = readAheadPacketCount;
+    try {
+        if (threadCount == 1)
+            readSequential(imf, options, what);
+        else
+            readAll(imf, options, threadCount, true, what);
+    } catch (E57Exception& ex) {
+        if (ex.errorCode() == E57_ERROR_BAD_CHECKSUM)
+            return(0);
+        std::cerr << what << ": threw " << ex.what() << std::endl;
+        return(1);
+    }
+    std::cerr << what << ": no error thrown" << std::endl;
+    return(1);
+}
+
+void copyDamaged(const ustring& fileName, const ustring& damagedName)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    std::ofstream out(damagedName, std::ios::binary);
+    out << in.rdbuf();
+    out.seekp(DAMAGE_OFFSET);
+    out.put('\x5A');
+}
+
+} // end namespace
+
+int main(int argc, char** argv)
+{
+    const ustring name = (argc > 1) ? argv[1] : "ReaderTest";
+    const ustring fileName = name + ".e57";
+    const ustring damagedName = name + "-damaged.e57";
+    unsigned bad = 0;
+
+    try {
+        writeFile(fileName);
+        bad += checkFile(fileName, false);
+        bad += checkFile(fileName, true);
+
+        copyDamaged(fileName, damagedName);
+        for (bool memoryMapped : {false, true}) {
+            for (unsigned readAhead : {0, 4}) {
+                bad += checkDamaged(damagedName, memoryMapped, readAhead, 1);
+                bad += checkDamaged(damagedName, memoryMapped, readAhead, 3);
+            }
+        }
+    } catch (E57Exception& ex) {
+        ex.report(__FILE__, __LINE__, __FUNCTION__);
+        return(1);
+    }
+
+    if (bad > 0) {
+        std::cerr << bad << " bad reads" << std::endl;
+        return(1);
+    }
+
+    return(0);
+}
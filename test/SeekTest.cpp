@@ -0,0 +1,193 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Writes a CompressedVectorNode with and without index packets, then checks
+/// that CompressedVectorReader::seek() lands on the right record in both files,
+/// and that seeking leaves the user's buffers alone.
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "E57Foundation.h"
+
+using namespace e57;
+
+namespace {
+
+/// Enough records for a few hundred data packets, so the index has several chunks
+const int64_t   RECORD_COUNT = 200000;
+
+/// Field "i" counts 0..4095, so only the first 128 records of every 4096 fit the int8_t buffer
+const int64_t   I_PERIOD = 4096;
+const unsigned  READ_COUNT = 64;
+
+double  expectedX(int64_t r)    {return((r % 200000 - 100000) * 0.001);}
+float   expectedY(int64_t r)    {return(static_cast<float>(r) * 0.5f);}
+double  expectedZ(int64_t r)    {return(std::sin(static_cast<double>(r)));}
+int8_t  expectedI(int64_t r)    {return(static_cast<int8_t>(r % I_PERIOD));}
+ustring expectedS(int64_t r)    {return((r % 7 == 0) ? "s" + std::to_string(r) : ustring());}
+
+void writeFile(const ustring& fileName, bool writeIndex)
+{
+    ImageFile imf(fileName, "w");
+    StructureNode root = imf.root();
+
+    StructureNode proto(imf);
+    proto.set("x", ScaledIntegerNode(imf, 0, -100000, 100000, 0.001, 0));
+    proto.set("y", FloatNode(imf, 0.0, E57_SINGLE));
+    proto.set("z", FloatNode(imf, 0.0, E57_DOUBLE));
+    proto.set("i", IntegerNode(imf, 0, 0, I_PERIOD - 1));
+    proto.set("s", StringNode(imf, ""));
+
+    VectorNode codecs(imf, true);
+    CompressedVectorNode cv(imf, proto, codecs);
+    root.set("points", cv);
+
+    const unsigned bufferSize = 1000;
+    std::vector<double>  x(bufferSize), z(bufferSize);
+    std::vector<float>   y(bufferSize);
+    std::vector<int32_t> i(bufferSize);
+    std::vector<ustring> s(bufferSize);
+
+    std::vector<SourceDestBuffer> sbufs;
+    sbufs.push_back(SourceDestBuffer(imf, "x", &x[0], bufferSize, true, true));
+    sbufs.push_back(SourceDestBuffer(imf, "y", &y[0], bufferSize, true));
+    sbufs.push_back(SourceDestBuffer(imf, "z", &z[0], bufferSize, true));
+    sbufs.push_back(SourceDestBuffer(imf, "i", &i[0], bufferSize, true));
+    sbufs.push_back(SourceDestBuffer(imf, "s", &s));
+
+    CompressedVectorWriterOptions options;
+    options.writeIndex = writeIndex;
+    CompressedVectorWriter writer = cv.writer(sbufs, options);
+
+    for (int64_t start = 0; start < RECORD_COUNT; start += bufferSize) {
+        unsigned count = static_cast<unsigned>(std::min<int64_t>(bufferSize, RECORD_COUNT - start));
+        for (unsigned k = 0; k < count; k++) {
+            x[k] = expectedX(start + k);
+            y[k] = expectedY(start + k);
+            z[k] = expectedZ(start + k);
+            i[k] = static_cast<int32_t>((start + k) % I_PERIOD);
+            s[k] = expectedS(start + k);
+        }
+        writer.write(count);
+    }
+    writer.close();
+    imf.close();
+}
+
+/// Returns the number of bad values found
+unsigned checkSeeks(const ustring& fileName)
+{
+    unsigned bad = 0;
+
+    ImageFile imf(fileName, "r");
+    CompressedVectorNode cv(imf.root().get("points"));
+
+    std::vector<double>  x(READ_COUNT), z(READ_COUNT);
+    std::vector<float>   y(READ_COUNT);
+    std::vector<int8_t>  i(READ_COUNT);
+    std::vector<ustring> s(READ_COUNT);
+
+    std::vector<SourceDestBuffer> dbufs;
+    dbufs.push_back(SourceDestBuffer(imf, "x", &x[0], READ_COUNT, true, true));
+    dbufs.push_back(SourceDestBuffer(imf, "y", &y[0], READ_COUNT, true));
+    dbufs.push_back(SourceDestBuffer(imf, "z", &z[0], READ_COUNT, true));
+    dbufs.push_back(SourceDestBuffer(imf, "i", &i[0], READ_COUNT, true));
+    dbufs.push_back(SourceDestBuffer(imf, "s", &s));
+
+    CompressedVectorReader reader = cv.reader(dbufs);
+
+    /// Forwards, backwards, the same place twice, and into the last chunk.
+    /// The records skipped over have "i" values the int8_t buffer can't hold.
+    const int64_t seeks[] = {40 * I_PERIOD, 0, 3 * I_PERIOD + 10, 47 * I_PERIOD + 1, 3 * I_PERIOD + 10, 48 * I_PERIOD};
+
+    for (int64_t start : seeks) {
+        std::fill(x.begin(), x.end(), -1.0);
+        std::fill(y.begin(), y.end(), -1.0f);
+        std::fill(z.begin(), z.end(), -1.0);
+        std::fill(i.begin(), i.end(), -1);
+        std::fill(s.begin(), s.end(), ustring("untouched"));
+
+        reader.seek(start);
+
+        for (unsigned k = 0; k < READ_COUNT; k++) {
+            if (x[k] != -1.0 || y[k] != -1.0f || z[k] != -1.0 || i[k] != -1 || s[k] != "untouched") {
+                std::cerr << fileName << ": seek(" << start << ") changed buffer entry " << k << std::endl;
+                bad++;
+                break;
+            }
+        }
+
+        unsigned count = reader.read();
+        if (count != READ_COUNT) {
+            std::cerr << fileName << ": read " << count << " records after seek(" << start << ")" << std::endl;
+            bad++;
+            continue;
+        }
+
+        for (unsigned k = 0; k < count; k++) {
+            int64_t r = start + k;
+            if (std::fabs(x[k] - expectedX(r)) > 1e-9 || y[k] != expectedY(r) || z[k] != expectedZ(r) ||
+                i[k] != expectedI(r) || s[k] != expectedS(r)) {
+                std::cerr << fileName << ": wrong values in record " << r << " after seek(" << start << ")" << std::endl;
+                bad++;
+                break;
+            }
+        }
+    }
+
+    reader.close();
+    imf.close();
+
+    return(bad);
+}
+
+} // end namespace
+
+int main()
+{
+    unsigned bad = 0;
+
+    try {
+        writeFile("SeekTest-index.e57", true);
+        writeFile("SeekTest-noindex.e57", false);
+
+        bad += checkSeeks("SeekTest-index.e57");
+        bad += checkSeeks("SeekTest-noindex.e57");
+    } catch (E57Exception& ex) {
+        ex.report(__FILE__, __LINE__, __FUNCTION__);
+        return(1);
+    }
+
+    if (bad > 0) {
+        std::cerr << bad << " bad seeks" << std::endl;
+        return(1);
+    }
+
+    return(0);
+}
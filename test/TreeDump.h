@@ -0,0 +1,104 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TREEDUMP_H_INCLUDED
+#define TREEDUMP_H_INCLUDED
+
+/// Writes a node tree as text, one line per node with its element name, type and values,
+/// so that trees read back in different ways can be compared as strings.
+
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "E57Foundation.h"
+
+inline void treeDump(const e57::Node& node, std::ostream& os, int indent = 0)
+{
+    using namespace e57;
+
+    os << std::string(indent, ' ') << node.elementName() << " ";
+    switch (node.type()) {
+        case E57_STRUCTURE: {
+            StructureNode s(node);
+            os << "Structure " << s.childCount() << "\n";
+            for (int64_t i = 0; i < s.childCount(); i++)
+                treeDump(s.get(i), os, indent + 2);
+        } break;
+        case E57_VECTOR: {
+            VectorNode v(node);
+            os << "Vector " << v.childCount() << " " << v.allowHeteroChildren() << "\n";
+            for (int64_t i = 0; i < v.childCount(); i++)
+                treeDump(v.get(i), os, indent + 2);
+        } break;
+        case E57_COMPRESSED_VECTOR: {
+            CompressedVectorNode cv(node);
+            os << "CompressedVector " << cv.childCount() << "\n";
+            treeDump(cv.prototype(), os, indent + 2);
+            treeDump(cv.codecs(), os, indent + 2);
+        } break;
+        case E57_INTEGER: {
+            IntegerNode i(node);
+            os << "Integer " << i.value() << " " << i.minimum() << " " << i.maximum() << "\n";
+        } break;
+        case E57_SCALED_INTEGER: {
+            ScaledIntegerNode si(node);
+            os << "ScaledInteger " << si.rawValue() << " " << si.minimum() << " " << si.maximum()
+               << std::setprecision(17) << " " << si.scale() << " " << si.offset() << "\n";
+        } break;
+        case E57_FLOAT: {
+            FloatNode f(node);
+            os << "Float " << std::setprecision(17) << f.value() << " " << f.precision() << " " << f.minimum() << " " << f.maximum() << "\n";
+        } break;
+        case E57_STRING:
+            os << "String \"" << StringNode(node).value() << "\"\n";
+            break;
+        case E57_BLOB:
+            os << "Blob " << BlobNode(node).byteCount() << "\n";
+            break;
+    }
+}
+
+inline std::string treeDump(const e57::Node& node)
+{
+    std::ostringstream os;
+    treeDump(node, os);
+    return(os.str());
+}
+
+/// Dump of the whole tree of imf, with the extensions it declares.
+/// A file read back also declares the default namespace, which isn't an extension when writing.
+inline std::string treeDump(e57::ImageFile imf)
+{
+    std::ostringstream os;
+    for (size_t i = 0; i < imf.extensionsCount(); i++)
+        os << "extension " << imf.extensionsPrefix(i) << " " << imf.extensionsUri(i) << "\n";
+    treeDump(imf.root(), os);
+    return(os.str());
+}
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Writes the same CompressedVectorNode with different CompressedVectorWriterOptions::encoderThreadCount and
+/// backgroundWrite settings, and checks the files are byte for byte the same and read back right.
+/// Also checks that errors in an encoder thread, and (on POSIX systems) write errors in the background writer,
+/// are thrown by the writer.
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#include <sys/resource.h>
+#define WRITER_TEST_FILE_SIZE_LIMIT
+#endif
+
+#include "E57Foundation.h"
+
+using namespace e57;
+
+namespace {
+
+const int64_t   RECORD_COUNT = 60000;
+
+/// The sizes of the successive write() calls, repeated
+const unsigned  WRITE_SIZES[] = {1000, 1, 4096, 333};
+const unsigned  BUFFER_SIZE = 4096;
+
+double  expectedX(int64_t r)    {return((r % 200000 - 100000) * 0.001);}
+float   expectedY(int64_t r)    {return(static_cast<float>(r) * 0.25f);}
+double  expectedZ(int64_t r)    {return(std::cos(static_cast<double>(r)));}
+int32_t expectedI(int64_t r)    {return(static_cast<int32_t>(r % 1021));}
+ustring expectedS(int64_t r)    {return((r % 5 == 0) ? "s" + std::to_string(r) : ustring());}
+
+/// The user buffers of the writer
+struct Buffers {
+    std::vector<double>  x, z;
+    std::vector<float>   y;
+    std::vector<int32_t> i;
+    std::vector<ustring> s;
+
+    Buffers() : x(BUFFER_SIZE), z(BUFFER_SIZE), y(BUFFER_SIZE), i(BUFFER_SIZE), s(BUFFER_SIZE) {}
+
+    std::vector<SourceDestBuffer> sourceDest(ImageFile imf)
+    {
+        std::vector<SourceDestBuffer> sbufs;
+        sbufs.push_back(SourceDestBuffer(imf, "x", &x[0], BUFFER_SIZE, true, true));
+        sbufs.push_back(SourceDestBuffer(imf, "y", &y[0], BUFFER_SIZE, true));
+        sbufs.push_back(SourceDestBuffer(imf, "z", &z[0], BUFFER_SIZE, true));
+        sbufs.push_back(SourceDestBuffer(imf, "i", &i[0], BUFFER_SIZE, true));
+        sbufs.push_back(SourceDestBuffer(imf, "s", &s));
+        return(sbufs);
+    }
+
+    void fill(int64_t start, unsigned count)
+    {
+        for (unsigned k = 0; k < count; k++) {
+            x[k] = expectedX(start + k);
+            y[k] = expectedY(start + k);
+            z[k] = expectedZ(start + k);
+            i[k] = expectedI(start + k);
+            s[k] = expectedS(start + k);
+        }
+    }
+};
+
+CompressedVectorNode createVector(ImageFile imf)
+{
+    StructureNode proto(imf);
+    proto.set("x", ScaledIntegerNode(imf, 0, -100000, 100000, 0.001, 0));
+    proto.set("y", FloatNode(imf, 0.0, E57_SINGLE));
+    proto.set("z", FloatNode(imf, 0.0, E57_DOUBLE));
+    proto.set("i", IntegerNode(imf, 0, 0, 1020));
+    proto.set("s", StringNode(imf, ""));
+
+    VectorNode codecs(imf, true);
+    CompressedVectorNode cv(imf, proto, codecs);
+    imf.root().set("points", cv);
+    return(cv);
+}
+
+/// Writes the records of [0, recordCount), with record badRecord (if not negative) out of the range of field "i"
+void writeRecords(ImageFile imf, const CompressedVectorWriterOptions& options, int64_t recordCount, int64_t badRecord = -1)
+{
+    CompressedVectorNode cv = createVector(imf);
+    Buffers buffers;
+    std::vector<SourceDestBuffer> sbufs = buffers.sourceDest(imf);
+    CompressedVectorWriter writer = cv.writer(sbufs, options);
+
+    int64_t start = 0;
+    for (unsigned n = 0; start < recordCount; n++) {
+        const unsigned count = static_cast<unsigned>(std::min<int64_t>(WRITE_SIZES[n % 4], recordCount - start));
+        buffers.fill(start, count);
+        if (start <= badRecord && badRecord < start + count)
+            buffers.i[badRecord - start] = 5000;
+        writer.write(count);
+        start += count;
+    }
+    writer.close();
+}
+
+std::string fileContents(const ustring& fileName)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    return(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+}
+
+/// Returns the number of bad values found
+unsigned checkRecords(const ustring& fileName)
+{
+    ImageFile imf(fileName, "r");
+    CompressedVectorNode cv(imf.root().get("points"));
+
+    Buffers buffers;
+    std::vector<SourceDestBuffer> dbufs = buffers.sourceDest(imf);
+    CompressedVectorReader reader = cv.reader(dbufs);
+
+    unsigned bad = 0;
+    int64_t start = 0;
+    unsigned count;
+    while (bad == 0 && (count = reader.read()) > 0) {
+        for (unsigned k = 0; k < count; k++) {
+            const int64_t r = start + k;
+            if (buffers.x[k] != expectedX(r) || buffers.y[k] != expectedY(r) || buffers.z[k] != expectedZ(r) ||
+                buffers.i[k] != expectedI(r) || buffers.s[k] != expectedS(r)) {
+                std::cerr << fileName << ": wrong values in record " << r << std::endl;
+                bad++;
+                break;
+            }
+        }
+        start += count;
+    }
+    reader.close();
+    imf.close();
+
+    if (bad == 0 && start != RECORD_COUNT) {
+        std::cerr << fileName << ": read " << start << " records" << std::endl;
+        bad++;
+    }
+    return(bad);
+}
+
+/// Returns 1 if writing with the given options doesn't throw errorCode, and 0 if it does.
+/// The file is cancelled (deleted) after the error.
+unsigned checkWriteError(const ustring& what, const ustring& fileName, const CompressedVectorWriterOptions& options,
+                         int64_t badRecord, ErrorCode errorCode)
+{
+    ImageFile imf(fileName, "w");
+    try {
+        writeRecords(imf, options, RECORD_COUNT, badRecord);
+    } catch (E57Exception& ex) {
+        imf.cancel();
+        if (ex.errorCode() == errorCode)
+            return(0);
+        std::cerr << what << ": threw " << ex.what() << " " << ex.errorCode() << std::endl;
+        return(1);
+    }
+    imf.cancel();
+    std::cerr << what << ": no error thrown" << std::endl;
+    return(1);
+}
+
+} // end namespace
+
+int main()
+{
+    unsigned bad = 0;
+
+    try {
+        /// The reference file is written on the calling thread only
+        const ustring referenceName = "WriterTest.e57";
+        {
+            ImageFile imf(referenceName, "w");
+            writeRecords(imf, CompressedVectorWriterOptions(), RECORD_COUNT);
+            imf.close();
+        }
+        bad += checkRecords(referenceName);
+        const std::string reference = fileContents(referenceName);
+
+        for (bool backgroundWrite : {false, true}) {
+            for (unsigned threadCount : {0, 1, 2, 3, 8}) {
+                const ustring fileName = "WriterTest-" + std::to_string(threadCount) + (backgroundWrite ? "-background" : "") + ".e57";
+
+                CompressedVectorWriterOptions options;
+                options.encoderThreadCount = threadCount;
+                options.backgroundWrite = backgroundWrite;
+
+                ImageFile imf(fileName, "w");
+                writeRecords(imf, options, RECORD_COUNT);
+                imf.close();
+
+                if (fileContents(fileName) != reference) {
+                    std::cerr << fileName << ": differs from " << referenceName << std::endl;
+                    bad++;
+                }
+
+                /// A value out of range, found by whichever thread encodes its bytestream
+                bad += checkWriteError(fileName + " with a bad value", "WriterTest-error.e57", options, RECORD_COUNT / 2,
+                                       E57_ERROR_VALUE_OUT_OF_BOUNDS);
+            }
+        }
+
+#ifdef WRITER_TEST_FILE_SIZE_LIMIT
+        /// A file size limit makes the data packet writes fail part way through the vector.
+        /// The write error has to come out of write() or close(), whichever thread made it.
+        signal(SIGXFSZ, SIG_IGN);
+        struct rlimit oldLimit;
+        getrlimit(RLIMIT_FSIZE, &oldLimit);
+        for (bool backgroundWrite : {false, true}) {
+            CompressedVectorWriterOptions options;
+            options.encoderThreadCount = 2;
+            options.backgroundWrite = backgroundWrite;
+
+            struct rlimit limit = oldLimit;
+            limit.rlim_cur = 256 * 1024;
+            setrlimit(RLIMIT_FSIZE, &limit);
+            bad += checkWriteError(ustring("write error") + (backgroundWrite ? " in background" : ""), "WriterTest-error.e57",
+                                   options, -1, E57_ERROR_WRITE_FAILED);
+            setrlimit(RLIMIT_FSIZE, &oldLimit);
+        }
+#endif
+    } catch (E57Exception& ex) {
+        ex.report(__FILE__, __LINE__, __FUNCTION__);
+        return(1);
+    }
+
+    if (bad > 0) {
+        std::cerr << bad << " bad files" << std::endl;
+        return(1);
+    }
+
+    return(0);
+}
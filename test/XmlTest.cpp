@@ -0,0 +1,265 @@
+/*
+ * Copyright 2009 - 2010 Kevin Ackley (kackley@gwi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/// Checks the XML section is read back as the tree that was written, then edits the XML section of a file (fixing the
+/// page checksums) to check the parser accepts well formed XML written differently than this library writes it,
+/// and rejects XML that isn't well formed.  Works with either XML parser (see E57_BUILTIN_XML_PARSER).
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "E57Foundation.h"
+#include "TreeDump.h"
+
+using namespace e57;
+
+namespace {
+
+/// Layout of CheckedFile pages: each ends in the CRC-32C of the rest, stored most significant byte first
+const size_t PHYSICAL_PAGE_SIZE = 1024;
+const size_t LOGICAL_PAGE_SIZE = 1020;
+
+/// Offsets in the file header of the physical offset and logical length of the XML section, little endian
+const size_t XML_PHYSICAL_OFFSET_FIELD = 24;
+const size_t XML_LOGICAL_LENGTH_FIELD = 32;
+
+/// The "probe" element is replaced in the tests, it is written long enough to hold the replacements
+const ustring PROBE_VALUE(400, 'Q');
+
+uint32_t crc32c(const char* buf, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t n = 0; n < size; n++) {
+        crc ^= static_cast<uint8_t>(buf[n]);
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+    }
+    return(~crc);
+}
+
+uint64_t littleEndian(const std::string& bytes, size_t offset)
+{
+    uint64_t value = 0;
+    for (size_t n = 8; n-- > 0; )
+        value = (value << 8) | static_cast<uint8_t>(bytes.at(offset + n));
+    return(value);
+}
+
+std::string readLogical(const ustring& fileName)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    const std::string physical((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string logical;
+    for (size_t page = 0; page < physical.size(); page += PHYSICAL_PAGE_SIZE)
+        logical.append(physical, page, LOGICAL_PAGE_SIZE);
+    return(logical);
+}
+
+void writeLogical(const ustring& fileName, const std::string& logical)
+{
+    std::string physical;
+    for (size_t page = 0; page < logical.size(); page += LOGICAL_PAGE_SIZE) {
+        const std::string data = logical.substr(page, LOGICAL_PAGE_SIZE);
+        const uint32_t crc = crc32c(data.data(), data.size());
+        physical += data;
+        for (int shift = 24; shift >= 0; shift -= 8)
+            physical += static_cast<char>(crc >> shift);
+    }
+    std::ofstream out(fileName, std::ios::binary);
+    out << physical;
+}
+
+/// Strings that need escaping, and characters outside ASCII
+void buildTree(ImageFile imf)
+{
+    StructureNode root = imf.root();
+    root.set("before", StringNode(imf, "a]]>b <&> ]]]]> \"'"));
+    root.set("unicode", StringNode(imf, "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"));
+    root.set("spaces", StringNode(imf, "  x\ty\n  "));
+    root.set("probe", StringNode(imf, PROBE_VALUE));
+
+    StructureNode s(imf);
+    s.set("i", IntegerNode(imf, -42, -100, 100));
+    s.set("d", FloatNode(imf, 0.1));
+    s.set("f", FloatNode(imf, 0.1f, E57_SINGLE));
+    s.set("scaled", ScaledIntegerNode(imf, 7, 0, 1000, 0.25, -1.5));
+    VectorNode v(imf, true);
+    v.append(StringNode(imf, "first"));
+    v.append(IntegerNode(imf, 2));
+    s.set("v", v);
+    root.set("after", s);
+}
+
+struct XmlCase {
+    const char* replacement;    /// Replaces the whole probe element
+    const char* probeValue;     /// Value of probe if it reads, or nullptr if no probe is expected
+    ErrorCode   openError;      /// Error expected when opening, or E57_SUCCESS
+};
+
+const XmlCase CASES[] = {
+    /// Well formed, but not as written here
+    {"<probe type=\"String\">plain text</probe>",                               "plain text",   E57_SUCCESS},
+    {"<probe type='String'>single quotes</probe>",                              "single quotes", E57_SUCCESS},
+    {"<probe  type = \"String\" >spaces</probe >",                              "spaces",       E57_SUCCESS},
+    {"<probe type=\"String\">a&lt;&amp;&gt;&quot;&apos;&#65;&#x42;&#xe9;</probe>", "a<&>\"'AB\xC3\xA9", E57_SUCCESS},
+    {"<probe type=\"String\"><![CDATA[a]]]]><![CDATA[>b]]></probe>",           "a]]>b",        E57_SUCCESS},
+    {"<probe type=\"String\">x<!-- comment -->y<?pi data?>z</probe>",          "xyz",          E57_SUCCESS},
+    {"<!-- comment --><?pi data?><probe type=\"String\">after</probe>",        "after",        E57_SUCCESS},
+    {"<probe type=\"String\">\xE2\x82\xAC \xF0\x9F\x98\x80</probe>",           "\xE2\x82\xAC \xF0\x9F\x98\x80", E57_SUCCESS},
+    {"<probe type=\"String\"></probe>",                                         "",             E57_SUCCESS},
+    {"<probe type=\"String\"/>",                                                "",             E57_SUCCESS},
+
+    /// Not well formed
+    {"<probe type=\"String\">x</probx>",                                        nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">x</probe><extra type=\"Structure\">",             nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">x</probe></e57Root>",                             nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=String>x</probe>",                                            nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\" type=\"String\">x</probe>",                       nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">a < b</probe>",                                    nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">&undefined;</probe>",                             nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">&#0;</probe>",                                     nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">&#xD800;</probe>",                                 nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">&amp</probe>",                                     nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">\x01</probe>",                                     nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">\xC3\x28</probe>",                                 nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">\xC0\xAF</probe>",                                 nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">\xED\xA0\x80</probe>",                             nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">\xF4\x90\x80\x80</probe>",                         nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\"><![CDATA[x</probe>",                               nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\">x<!-- comment</probe>",                            nullptr,        E57_ERROR_XML_PARSER},
+    {"<probe type=\"String\" <>x</probe>",                                      nullptr,        E57_ERROR_XML_PARSER},
+    {"<!DOCTYPE probe><probe type=\"String\">x</probe>",                        nullptr,        E57_ERROR_XML_PARSER},
+    {"<undeclared:probe type=\"String\">x</undeclared:probe>",                  nullptr,        E57_ERROR_XML_PARSER},
+
+    /// Well formed, but not an E57 tree
+    /// Not closed either, but the next element being the child of a String is found first
+    {"<probe type=\"String\">x",                                                nullptr,        E57_ERROR_BAD_XML_FORMAT},
+    {"<probe>x</probe>",                                                        nullptr,        E57_ERROR_BAD_XML_FORMAT},
+    {"<probe type=\"Strong\">x</probe>",                                        nullptr,        E57_ERROR_BAD_XML_FORMAT},
+    {"<probe type=\"Float\" precision=\"half\">1</probe>",                      nullptr,        E57_ERROR_BAD_XML_FORMAT},
+};
+
+/// Returns 1 if the edited file doesn't read as the case expects, 0 if it does
+unsigned checkCase(const std::string& original, size_t probeStart, size_t probeLength, const XmlCase& c, const ustring& fileName)
+{
+    const std::string replacement(c.replacement);
+    if (replacement.size() > probeLength) {
+        std::cerr << c.replacement << ": longer than the probe element" << std::endl;
+        return(1);
+    }
+
+    /// Pad with whitespace between elements, which the parsers ignore
+    std::string logical = original;
+    logical.replace(probeStart, probeLength, replacement + std::string(probeLength - replacement.size(), ' '));
+    writeLogical(fileName, logical);
+
+    try {
+        ImageFile imf(fileName, "r");
+        if (c.openError != E57_SUCCESS) {
+            std::cerr << c.replacement << ": no error thrown" << std::endl;
+            return(1);
+        }
+
+        StructureNode root = imf.root();
+        const ustring value = StringNode(root.get("probe")).value();
+        if (value != c.probeValue) {
+            std::cerr << c.replacement << ": read \"" << value << "\"" << std::endl;
+            return(1);
+        }
+        if (root.childCount() != 5 || IntegerNode(root.get("after/i")).value() != -42) {
+            std::cerr << c.replacement << ": the rest of the tree changed" << std::endl;
+            return(1);
+        }
+        imf.close();
+    } catch (E57Exception& ex) {
+        if (ex.errorCode() == c.openError)
+            return(0);
+        std::cerr << c.replacement << ": threw " << ex.what() << " " << ex.context() << std::endl;
+        return(1);
+    }
+    return(0);
+}
+
+} // end namespace
+
+int main()
+{
+    unsigned bad = 0;
+
+    try {
+        const ustring fileName = "XmlTest.e57";
+        std::string written;
+        {
+            ImageFile imf(fileName, "w");
+            buildTree(imf);
+            written = treeDump(imf.root());
+            imf.close();
+        }
+
+        /// The tree read back is the one written, whether or not validation is asked for
+        for (bool validateXml : {true, false}) {
+            ImageFileOptions options;
+            options.validateXml = validateXml;
+            ImageFile imf(fileName, "r", options);
+            if (treeDump(imf.root()) != written) {
+                std::cerr << fileName << ": read back a different tree" << std::endl;
+                std::cerr << "written:\n" << written << "read:\n" << treeDump(imf.root());
+                bad++;
+            }
+            imf.close();
+        }
+
+        /// Find the probe element in the XML section.  The rest of the last page may hold old copies of it.
+        const std::string original = readLogical(fileName);
+        const uint64_t xmlPhysicalOffset = littleEndian(original, XML_PHYSICAL_OFFSET_FIELD);
+        const size_t xmlStart = static_cast<size_t>(xmlPhysicalOffset / PHYSICAL_PAGE_SIZE * LOGICAL_PAGE_SIZE + xmlPhysicalOffset % PHYSICAL_PAGE_SIZE);
+        const std::string xml = original.substr(xmlStart, static_cast<size_t>(littleEndian(original, XML_LOGICAL_LENGTH_FIELD)));
+        const size_t probeStart = xmlStart + xml.find("<probe ");
+        const size_t probeEnd = xmlStart + xml.find("</probe>");
+        if (xml.find("<probe ") == std::string::npos || xml.find("</probe>") == std::string::npos) {
+            std::cerr << fileName << ": probe element not found" << std::endl;
+            return(1);
+        }
+        const size_t probeLength = probeEnd + 8 - probeStart;
+
+        for (const XmlCase& c : CASES)
+            bad += checkCase(original, probeStart, probeLength, c, "XmlTest-edited.e57");
+    } catch (E57Exception& ex) {
+        ex.report(__FILE__, __LINE__, __FUNCTION__);
+        return(1);
+    }
+
+    if (bad > 0) {
+        std::cerr << bad << " bad cases" << std::endl;
+        return(1);
+    }
+
+    return(0);
+}